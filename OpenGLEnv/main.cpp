@@ -10,9 +10,23 @@
 
 #include <iostream>
 #include <memory>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
 
 #include "game.h"
 #include "resource_manager.h"
+#include "replay.h"
+#include "benchmark.h"
+#include "collision_benchmark.h"
+#include "simulation_benchmark.h"
+#include "render_benchmark.h"
+#include "headless_context.h"
+#include "profiler.h"
+#include "gpu_profiler.h"
+#include "vfs.h"
 
 #define GRID_COLUMNS 40
 #define GRID_ROWS 40
@@ -32,6 +46,7 @@ string string_format(const string& format, Args ... args){
 void error_callback(int error, const char* description);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
 // The Width of the screen
 const GLuint SCREEN_WIDTH = 600;
@@ -40,19 +55,182 @@ const GLuint SCREEN_HEIGHT = 600;
 
 Game SnakeName(SCREEN_WIDTH, SCREEN_HEIGHT);
 
+// 按 F12 时把性能分析记录写到这个文件，--trace FILE 指定，退出时也会写一次
+const char *TracePath = "snake_trace.json";
+std::atomic<bool> TraceRequested(false);
+
+// 资源包，--pak FILE 指定，文件不存在时读散放的资源文件
+const char *ArchivePath = "assets.pak";
+
 void board() {
     
 }
 
+// 无窗口回放，按最快速度执行并校验状态
+int run_replay(const char *path)
+{
+    ReplayPlayer player;
+    if (!player.Open(path))
+        return 1;
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GLboolean passed = player.Play(SnakeName);
+    GLdouble seconds = std::chrono::duration<GLdouble>(std::chrono::steady_clock::now() - start).count();
+    
+    printf("replay %s: %u ticks in %.3f s (%.0f ticks/s), %u hash checks\n", path, player.TickCount, seconds, player.TickCount / (seconds > 0.0 ? seconds : 1.0), player.HashChecks);
+    if (player.MismatchTick >= 0)
+        printf("replay %s: state hash mismatch at tick %d\n", path, player.MismatchTick);
+    else if (!passed)
+        printf("replay %s: corrupted replay file\n", path);
+    return passed ? 0 : 1;
+}
+
+// 无窗口基准测试，jsonPath 不为空时把结果写成 JSON
+int run_benchmark(const char *filter, const char *jsonPath, double minSeconds)
+{
+    BenchmarkSuite suite(minSeconds, filter ? filter : "");
+    BenchmarkSuite::PrintHeader();
+    GLboolean passed = RunCollisionBenchmarks(suite);
+    SimulationBenchmark::SnakeMove(suite);
+    SimulationBenchmark::SnakeGrowth(suite);
+    SimulationBenchmark::FoodsRespawn(suite);
+    SimulationBenchmark::InstanceBuild(suite);
+    SimulationBenchmark::Arena(suite, SnakeName.Config.Threads);
+    
+    if (!passed)
+        printf("benchmark: SIMD collision kernels do not match the scalar version\n");
+    if (jsonPath && !suite.WriteJson(jsonPath))
+        return 1;
+    return passed ? 0 : 1;
+}
+
+// 无窗口渲染基准测试，在 EGL pbuffer（macOS 上是隐藏窗口）上渲染固定的场景
+int run_render_benchmark(const char *filter, const char *jsonPath, double minSeconds)
+{
+    if (!HeadlessContext::Create(SCREEN_WIDTH, SCREEN_HEIGHT))
+        return 1;
+    printf("renderer: %s\n", HeadlessContext::Description().c_str());
+    
+    BenchmarkSuite suite(minSeconds, filter ? filter : "");
+    BenchmarkSuite::PrintHeader();
+    RenderBenchmark::Run(suite, SCREEN_WIDTH, SCREEN_HEIGHT);
+    HeadlessContext::Destroy();
+    
+    if (jsonPath && !suite.WriteJson(jsonPath))
+        return 1;
+    return 0;
+}
+
+// 把资源文件打成资源包
+int run_pack(const char *path, const std::vector<std::string> &files)
+{
+    if (!Archive::Write(path, files))
+        return 1;
+    Archive archive;
+    if (!archive.Open(path))
+        return 1;
+    
+    uint64_t size = 0, stored = 0;
+    for (GLuint i = 0; i < archive.EntryCount(); i++) {
+        const ArchiveEntry &entry = archive.Entry(i);
+        printf("%-32s %9u -> %9u %s\n", archive.EntryName(i).c_str(), entry.Size, entry.StoredSize, entry.Method == ARCHIVE_DEFLATE ? "deflate" : "stored");
+        size += entry.Size;
+        stored += entry.StoredSize;
+    }
+    printf("pack %s: %u entries, %llu -> %llu bytes\n", path, archive.EntryCount(), (unsigned long long)size, (unsigned long long)stored);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
+    // 命令行参数：--arena 大地图竞技场，--bots N 指定 AI 蛇数量，--threads N 指定更新线程数量
+    // --seed N 指定随机数种子，--record FILE 录制输入，--replay FILE 无窗口回放并校验
+    // --benchmark 无窗口基准测试，--benchmark-filter NAME 只执行名字里包含 NAME 的测试，
+    // --benchmark-json FILE 把结果写成 JSON，--benchmark-time SECONDS 每项测试至少执行的时间
+    // --benchmark-render 无窗口渲染基准测试（同样支持上面三个参数）
+    // --trace FILE 性能分析记录的输出文件，游戏中按 F12 导出，退出时也会导出
+    // --pak FILE 指定资源包，--pack FILE ASSET... 把后面所有的资源文件打成资源包后退出
+    // --aa MODE 抗锯齿方式：none、msaa2、msaa4（默认）、msaa8、fxaa
+    // --frame-budget MS 动态分辨率的每帧预算（默认 16.7），0 关闭动态分辨率；--render-scale S 固定的渲染比例
+    const char *recordPath = nullptr;
+    const char *replayPath = nullptr;
+    bool benchmark = false;
+    bool renderBenchmark = false;
+    bool traceOnExit = false;
+    const char *benchmarkFilter = nullptr;
+    const char *benchmarkJson = nullptr;
+    double benchmarkTime = 0.2;
+    const char *packPath = nullptr;
+    std::vector<std::string> packFiles;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--arena") == 0) {
+            SnakeName.Config = ArenaConfig::LargeArena();
+        } else if (strcmp(argv[i], "--bots") == 0 && i + 1 < argc) {
+            SnakeName.Config.BotCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            SnakeName.Config.Threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            SnakeName.Seed = static_cast<GLuint>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            benchmark = true;
+        } else if (strcmp(argv[i], "--benchmark-render") == 0) {
+            renderBenchmark = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            TracePath = argv[++i];
+            traceOnExit = true;
+        } else if (strcmp(argv[i], "--benchmark-filter") == 0 && i + 1 < argc) {
+            benchmarkFilter = argv[++i];
+        } else if (strcmp(argv[i], "--benchmark-json") == 0 && i + 1 < argc) {
+            benchmarkJson = argv[++i];
+        } else if (strcmp(argv[i], "--benchmark-time") == 0 && i + 1 < argc) {
+            benchmarkTime = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--pak") == 0 && i + 1 < argc) {
+            ArchivePath = argv[++i];
+        } else if (strcmp(argv[i], "--aa") == 0 && i + 1 < argc) {
+            if (!PostProcessor::ParseAntiAliasing(argv[++i], SnakeName.AA))
+                std::cout << "Unknown anti-aliasing mode " << argv[i] << ", using " << PostProcessor::AntiAliasingName(SnakeName.AA) << std::endl;
+        } else if (strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc) {
+            GLfloat budget = static_cast<GLfloat>(atof(argv[++i]));
+            if (budget > 0.0f)
+                SnakeName.RenderScale.TargetMilliseconds = budget;
+            else
+                SnakeName.RenderScale.SetFixed(1.0f);
+        } else if (strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) {
+            SnakeName.RenderScale.SetFixed(static_cast<GLfloat>(atof(argv[++i])));
+        } else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc) {
+            packPath = argv[++i];
+            packFiles.assign(argv + i + 1, argv + argc);
+            break;
+        }
+    }
+    
+    if (packPath)
+        return run_pack(packPath, packFiles);
+    // 挂载资源包后所有资源都从这一个文件里读
+    VFS::Mount(ArchivePath);
+    
+    if (benchmark)
+        return run_benchmark(benchmarkFilter, benchmarkJson, benchmarkTime);
+    if (renderBenchmark)
+        return run_render_benchmark(benchmarkFilter, benchmarkJson, benchmarkTime);
+    
+    if (replayPath)
+        return run_replay(replayPath);
+    
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+    // 窗口可以缩放，游戏的逻辑尺寸不变，画面按比例放大并留黑边
+    glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
+    // 没有后期特效时场景直接画在默认帧缓冲上，MSAA 的采样数由抗锯齿方式决定，FXAA 和 none 不要多重采样
+    glfwWindowHint(GLFW_SAMPLES, PostProcessor::Samples(SnakeName.AA));
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -73,6 +251,7 @@ int main(int argc, char *argv[])
     glfwSetErrorCallback(error_callback);
     glfwSetKeyCallback(window, key_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -86,7 +265,11 @@ int main(int argc, char *argv[])
     glfwSwapInterval(1);
     
     // OpenGL configuration
-    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    // HiDPI 屏幕上帧缓冲的像素比窗口大，视口按帧缓冲的尺寸算
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    SnakeName.Resize(framebufferWidth, framebufferHeight);
+    glViewport(SnakeName.Viewport.x, SnakeName.Viewport.y, SnakeName.Viewport.z, SnakeName.Viewport.w);
     glEnable(GL_CULL_FACE);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -96,53 +279,100 @@ int main(int argc, char *argv[])
     // DeltaTime variables
     GLuint frameCount = 0;
     GLfloat t0 = glfwGetTime(), t1, fps = 0.0f;// 用于计算 FPS
-    GLfloat deltaTime = 0.0f; // deltaTime 帧间隔
-    GLfloat lastFrame = 0.0f;
-    GLfloat frameRate = 1.0/60.0;// 限制在 1秒钟 60 帧
     
     // Initialize game
     SnakeName.Init();
     
+    // 录制
+    ReplayRecorder recorder;
+    if (recordPath)
+    {
+        ReplayHeader header;
+        header.Seed = SnakeName.Seed;
+        header.Width = SnakeName.Width;
+        header.Height = SnakeName.Height;
+        header.Config = SnakeName.Config;
+        if (recorder.Open(recordPath, header))
+            SnakeName.Recorder = &recorder;
+    }
+    
+    // 模拟线程：以固定的频率处理输入和更新游戏状态，每次更新后发布渲染快照
+    // 渲染线程（主线程）只负责渲染最新的快照，交换缓冲时卡住也不会让模拟少更新
+    std::atomic<bool> running(true);
+    PROFILE_THREAD("Main");
+    std::thread simulation([&running]() {
+        PROFILE_THREAD("Simulation");
+        const GLdouble tickRate = 1.0 / 60.0;// 1 秒钟更新 60 次
+        const GLdouble maxLag = 0.25;// 落后太多（比如断点调试）就不追了，避免一次补太多帧
+        GLdouble nextTick = glfwGetTime();
+        while (running)
+        {
+            GLdouble now = glfwGetTime();
+            if (now < nextTick)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<GLdouble>(nextTick - now));
+                continue;
+            }
+            
+            // 管理用户点击按键，处理到这次更新的时间点为止的输入
+            SnakeName.ProcessInput(tickRate, nextTick, now);
+            
+            // 更新游戏状态
+            SnakeName.Update(tickRate);
+            
+            nextTick += tickRate;
+            if (now - nextTick > maxLag)
+            {
+                nextTick = now;
+            }
+        }
+    });
+    
     while (!glfwWindowShouldClose(window))
     {
-        // Calculate delta time - per-frame time logic 计算每一帧的绘制时间
-        GLfloat currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        
         // 轮询和处理事件
         glfwPollEvents();
         
-        if (deltaTime >= frameRate)
-        {
-            // 管理用户点击按键
-            SnakeName.ProcessInput(deltaTime);
-
-            // 更新游戏状态
-            SnakeName.Update(deltaTime);
-
-            // 渲染
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            SnakeName.Render();
-            
-            t1 = glfwGetTime();
-            if ((t1 - t0) >= 1.0 || frameCount == 0) {// 用于计算 1 秒钟多少帧
-                fps = (GLdouble)frameCount / (t1 - t0);
-                glfwSetWindowTitle(window, string_format("贪吃蛇 FPS：%.1f", fps).c_str());
+        // 渲染
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        SnakeName.Render();
+        
+        t1 = glfwGetTime();
+        if ((t1 - t0) >= 1.0 || frameCount == 0) {// 用于计算 1 秒钟多少帧
+            fps = (GLdouble)frameCount / (t1 - t0);
+            // 输入延迟：从按键到被模拟线程处理的时间
+            GLdouble latencyMean, latencyMax;
+            SnakeName.Input.Stats.Collect(latencyMean, latencyMax);
+            glfwSetWindowTitle(window, string_format("贪吃蛇 FPS：%.1f 输入延迟：%.1fms（最大 %.1fms）", fps, latencyMean, latencyMax).c_str());
 
-                t0 = t1;
-                frameCount = 0;
-            }
-            frameCount++;
+            t0 = t1;
+            frameCount = 0;
+        }
+        frameCount++;
 
-            // 交换前后台缓冲
+        // 交换前后台缓冲，开启了垂直同步，会等到屏幕刷新
+        {
+            PROFILE_SCOPE("SwapBuffers");
             glfwSwapBuffers(window);
-
-            lastFrame = currentFrame;
+        }
+        
+        if (TraceRequested.exchange(false))
+        {
+            Profiler::WriteChromeTrace(TracePath);
+            printf("trace written to %s\n", TracePath);
         }
     }
     
+    running = false;
+    simulation.join();
+    recorder.Close(SnakeName.Tick);
+    if (traceOnExit)
+        Profiler::WriteChromeTrace(TracePath);
+    
     // Delete all resources as loaded using the resource manager
     ResourceManager::Clear();
+    GPUProfiler::Release();
+    VFS::Unmount();
     
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -150,45 +380,59 @@ int main(int argc, char *argv[])
     return 0;
 }
 
-void error_callback(int error, const char* description)
+void error_callback(int /*error*/, const char* description)
 {
     fprintf(stderr, "Error: %s\n", description);
 }
 
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
+void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mode*/)
 {
     // When a user presses the escape key, we set the WindowShouldClose property to true, closing the application
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)// ESC 杀掉进程
         glfwSetWindowShouldClose(window, GL_TRUE);
-    if (key >= 0 && key < 1024)
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS)// F12 导出性能分析记录
+        TraceRequested = true;
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS)// F3 显示/隐藏性能面板，回调和渲染都在主线程
+        SnakeName.ShowPerfHud = !SnakeName.ShowPerfHud;
+    if (key >= 0 && key < 1024 && (action == GLFW_PRESS || action == GLFW_RELEASE))
     {
-        if (action == GLFW_PRESS)// 按下某个按键
-        {
-            SnakeName.Keys[key] = GL_TRUE;
-        }
-        else if (action == GLFW_RELEASE)// 释放某个按键
-        {
-            SnakeName.Keys[key] = GL_FALSE;
-            SnakeName.KeysProcessed[key] = GL_FALSE;
-        }
+        // 按键事件放进输入队列，由模拟线程处理
+        InputEvent event;
+        event.Time = glfwGetTime();
+        event.Type = INPUT_KEY;
+        event.Action = action == GLFW_PRESS ? INPUT_PRESS : INPUT_RELEASE;
+        event.Code = key;
+        SnakeName.Input.Push(event);
     }
 }
 
-void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+void mouse_button_callback(GLFWwindow* window, int button, int action, int /*mods*/)
 {
     if (button >=0 && button < 8) {
-        
+        InputEvent event;
+        event.Time = glfwGetTime();
+        event.Type = INPUT_MOUSE_BUTTON;
+        event.Action = action == GLFW_PRESS ? INPUT_PRESS : INPUT_RELEASE;
+        event.Code = button;
         if (action == GLFW_PRESS)// 按下了某个鼠标按键
         {
-            SnakeName.MouseKeys[button] = GL_TRUE;
             GLdouble xpos, ypos;
             // 获取鼠标点击的位置
             glfwGetCursorPos(window, &xpos, &ypos);
-            SnakeName.MousePositions[button] = glm::vec2(xpos, ypos);
-        } else if (action == GLFW_RELEASE)// 释放某个鼠标按键
-        {
-            SnakeName.MouseKeys[button] = GL_FALSE;
+            // 光标是窗口坐标，先换算成帧缓冲像素（HiDPI），再去掉黑边换算成游戏的逻辑坐标，录制的也是逻辑坐标
+            int windowWidth, windowHeight, framebufferWidth, framebufferHeight;
+            glfwGetWindowSize(window, &windowWidth, &windowHeight);
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            glm::vec2 pixelRatio(windowWidth > 0 ? framebufferWidth / static_cast<GLfloat>(windowWidth) : 1.0f, windowHeight > 0 ? framebufferHeight / static_cast<GLfloat>(windowHeight) : 1.0f);
+            event.Position = SnakeName.FramebufferToView(glm::vec2(xpos, ypos) * pixelRatio);
         }
+        SnakeName.Input.Push(event);
     }
     
 }
+
+void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height)
+{
+    // 回调在 glfwPollEvents 里执行，和渲染在同一个线程
+    SnakeName.Resize(width, height);
+}
@@ -0,0 +1,76 @@
+//
+//  benchmark.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/27.
+//
+
+#include "benchmark.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "collision_kernels.h"
+
+BenchmarkSuite::BenchmarkSuite(GLdouble minSeconds, const std::string &filter) : MinSeconds(minSeconds), Filter(filter)
+{
+
+}
+
+GLboolean BenchmarkSuite::Enabled(const std::string &name) const
+{
+    return this->Filter.empty() || name.find(this->Filter) != std::string::npos;
+}
+
+void BenchmarkSuite::Record(const std::string &name, GLuint size, GLuint iterations, GLdouble seconds, const AllocationStats &before, const AllocationStats &after, const std::vector<BenchmarkCounter> &counters)
+{
+    BenchmarkResult result;
+    result.Name = name;
+    result.Size = size;
+    result.Iterations = iterations;
+    result.NanosecondsPerOp = seconds * 1e9 / iterations;
+    result.AllocationsPerOp = static_cast<GLdouble>(after.Count - before.Count) / iterations;
+    result.BytesPerOp = static_cast<GLdouble>(after.Bytes - before.Bytes) / iterations;
+    result.Counters = counters;
+    this->Results.push_back(result);
+    // 边测边打印，耗时长的测试也能看到进度
+    printf("%-32s %9u %10u %12.1f ns/op %8.2f allocs/op %10.0f B/op", result.Name.c_str(), result.Size, result.Iterations, result.NanosecondsPerOp, result.AllocationsPerOp, result.BytesPerOp);
+    for (const BenchmarkCounter &counter : result.Counters) {
+        printf(" %s=%.1f", counter.Name.c_str(), counter.Value);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+void BenchmarkSuite::PrintHeader()
+{
+    printf("%-32s %9s %10s %18s %18s %15s\n", "benchmark", "size", "iterations", "time", "allocations", "bytes");
+}
+
+GLboolean BenchmarkSuite::WriteJson(const std::string &path) const
+{
+    std::ofstream stream(path, std::ios::trunc);
+    if (!stream.is_open()) {
+        std::cout << "ERROR::BENCHMARK: Failed to open " << path << std::endl;
+        return GL_FALSE;
+    }
+    // 测试名只有字母、数字、点和下划线，不需要转义
+    stream << "{\n  \"isa\": \"" << CollisionKernelsISA() << "\",\n  \"min_seconds\": " << this->MinSeconds << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < this->Results.size(); i++) {
+        const BenchmarkResult &result = this->Results[i];
+        stream << "    {\"name\": \"" << result.Name << "\", \"size\": " << result.Size << ", \"iterations\": " << result.Iterations
+            << ", \"ns_per_op\": " << result.NanosecondsPerOp << ", \"allocs_per_op\": " << result.AllocationsPerOp
+            << ", \"bytes_per_op\": " << result.BytesPerOp;
+        if (!result.Counters.empty()) {
+            stream << ", \"counters\": {";
+            for (size_t j = 0; j < result.Counters.size(); j++) {
+                stream << (j > 0 ? ", " : "") << "\"" << result.Counters[j].Name << "\": " << result.Counters[j].Value;
+            }
+            stream << "}";
+        }
+        stream << "}" << (i + 1 < this->Results.size() ? ",\n" : "\n");
+    }
+    stream << "  ]\n}\n";
+    return GL_TRUE;
+}
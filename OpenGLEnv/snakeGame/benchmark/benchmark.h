@@ -0,0 +1,87 @@
+//
+//  benchmark.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/27.
+//
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "allocation_stats.h"
+
+// 基准测试的附加计数，例如渲染测试每帧的 GPU 耗时、绘制调用次数
+struct BenchmarkCounter {
+    std::string Name;// 计数名，例如 "draw_calls"
+    GLdouble    Value;// 每次操作的平均值
+};
+
+// 一项基准测试的结果
+struct BenchmarkResult {
+    std::string Name;// 测试名，例如 "snake.move_body1"
+    GLuint      Size;// 规模（蛇长度、食物数量、点数等）
+    GLuint      Iterations;// 计时的执行次数
+    GLdouble    NanosecondsPerOp;// 每次操作的耗时
+    GLdouble    AllocationsPerOp;// 每次操作的内存分配次数
+    GLdouble    BytesPerOp;// 每次操作分配的字节数
+    std::vector<BenchmarkCounter> Counters;// 附加计数
+};
+
+// 基准测试集，不需要窗口和 OpenGL 上下文（渲染测试除外）
+// 每项测试先执行一次预热，然后成倍增加执行次数，直到总耗时超过 MinSeconds，
+// 结果按每次操作的耗时和内存分配统计，最后打印成表格或者写成 JSON 方便跟踪趋势。
+class BenchmarkSuite
+{
+public:
+    GLdouble    MinSeconds;// 每项测试至少执行的时间
+    std::string Filter;// 只执行名字里包含这个字符串的测试，空表示全部执行
+    std::vector<BenchmarkResult> Results;
+
+    BenchmarkSuite(GLdouble minSeconds = 0.2, const std::string &filter = "");
+
+    // 是否需要执行这项测试，准备数据比较耗时的测试先判断一下
+    GLboolean Enabled(const std::string &name) const;
+
+    // 执行一项测试，每调用一次 op 算一次操作
+    template <typename Op>
+    void Run(const std::string &name, GLuint size, Op op)
+    {
+        if (!this->Enabled(name)) {
+            return;
+        }
+        // 预热：第一次执行会分配缓冲区、填充缓存，不计入结果
+        op();
+        GLuint iterations = 1;
+        GLuint total = 0;
+        GLdouble seconds = 0.0;
+        AllocationStats before = AllocationStats::Now();
+        while (seconds < this->MinSeconds) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (GLuint i = 0; i < iterations; i++) {
+                op();
+            }
+            seconds += std::chrono::duration<GLdouble>(std::chrono::steady_clock::now() - start).count();
+            total += iterations;
+            iterations *= 2;
+        }
+        AllocationStats after = AllocationStats::Now();
+        this->Record(name, size, total, seconds, before, after);
+    }
+    
+    // 记录一项自己计时的测试（比如按帧计时的渲染测试），counters 是每次操作的附加计数
+    void Record(const std::string &name, GLuint size, GLuint iterations, GLdouble seconds, const AllocationStats &before, const AllocationStats &after, const std::vector<BenchmarkCounter> &counters = std::vector<BenchmarkCounter>());
+
+    // 打印结果表格的表头，每项测试完成时打印一行结果
+    static void PrintHeader();
+    // 把结果写成 JSON
+    GLboolean WriteJson(const std::string &path) const;
+};
+
+#endif /* benchmark_h */
@@ -0,0 +1,104 @@
+//
+//  collision_benchmark.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/26.
+//
+
+#include "collision_benchmark.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "benchmark.h"
+#include "collision_kernels.h"
+#include "random_stream.h"
+
+// 基准测试用的一批点，Reset 把点恢复到初始位置
+struct BenchmarkPoints {
+    std::vector<GLfloat> InitialX, InitialY;
+    std::vector<GLfloat> X, Y, Radius;
+    std::vector<GLubyte> Hits;
+    PointBatch Batch;
+
+    BenchmarkPoints(GLuint count, RandomStream &random)
+        : InitialX(count), InitialY(count), X(count), Y(count), Radius(count), Hits(count)
+    {
+        // 点撒在 512 x 512 的范围里，和扫掠线段、磁吸范围的大小相当，命中和没命中的都有
+        random.FillFloat(this->InitialX.data(), count, 0.0f, 512.0f);
+        random.FillFloat(this->InitialY.data(), count, 0.0f, 512.0f);
+        random.FillFloat(this->Radius.data(), count, 6.0f, 18.0f);
+        this->Batch.X = this->X.data();
+        this->Batch.Y = this->Y.data();
+        this->Batch.Radius = this->Radius.data();
+        this->Batch.Count = count;
+        this->Reset();
+    }
+
+    void Reset()
+    {
+        this->X = this->InitialX;
+        this->Y = this->InitialY;
+    }
+};
+
+static GLboolean SameResults(const BenchmarkPoints &a, const BenchmarkPoints &b)
+{
+    size_t floats = a.X.size() * sizeof(GLfloat);
+    return memcmp(a.X.data(), b.X.data(), floats) == 0 &&
+        memcmp(a.Y.data(), b.Y.data(), floats) == 0 &&
+        memcmp(a.Hits.data(), b.Hits.data(), a.Hits.size()) == 0;
+}
+
+GLboolean RunCollisionBenchmarks(BenchmarkSuite &suite, GLuint count)
+{
+    RandomStream random(1, 0);
+    BenchmarkPoints scalar(count, random);
+    random.Seed(1, 0);
+    BenchmarkPoints simd(count, random);
+
+    SweptCircle shape;
+    shape.From = glm::vec2(200.0f, 240.0f);
+    shape.To = glm::vec2(320.0f, 280.0f);
+    shape.Radius = 12.0f;
+    const GLfloat pullRange = 200.0f;
+    GLfloat pullStep = 4.0f;
+
+    // 1. 校验标量版本和 SIMD 版本的结果逐位相同（包括不是 SIMD 宽度整数倍的点数）
+    GLboolean passed = GL_TRUE;
+    for (GLuint tail = 0; tail < 9 && tail < count; tail++) {
+        scalar.Batch.Count = simd.Batch.Count = count - tail;
+        scalar.Reset();
+        simd.Reset();
+        PullAndSweepScalar(shape, pullRange, pullStep, scalar.Batch, scalar.Hits.data());
+        PullAndSweep(shape, pullRange, pullStep, simd.Batch, simd.Hits.data());
+        passed = passed && SameResults(scalar, simd);
+        GLuint scalarCount = SweepTestScalar(shape, scalar.Batch, scalar.Hits.data());
+        GLuint simdCount = SweepTest(shape, simd.Batch, simd.Hits.data());
+        passed = passed && scalarCount == simdCount && SameResults(scalar, simd);
+    }
+    scalar.Batch.Count = simd.Batch.Count = count;
+    scalar.Reset();
+    simd.Reset();
+    if (!passed) {
+        printf("collision kernels (%s): scalar and SIMD results differ\n", CollisionKernelsISA());
+    }
+
+    // 2. 分别计时，磁吸方向每次反过来，点在原地附近来回移动，每次操作的工作量不变
+    suite.Run("collision.pull_sweep_scalar", count, [&]() {
+        pullStep = -pullStep;
+        PullAndSweepScalar(shape, pullRange, pullStep, scalar.Batch, scalar.Hits.data());
+    });
+    suite.Run("collision.pull_sweep_simd", count, [&]() {
+        pullStep = -pullStep;
+        PullAndSweep(shape, pullRange, pullStep, simd.Batch, simd.Hits.data());
+    });
+    suite.Run("collision.sweep_test_scalar", count, [&]() {
+        SweepTestScalar(shape, scalar.Batch, scalar.Hits.data());
+    });
+    suite.Run("collision.sweep_test_simd", count, [&]() {
+        SweepTest(shape, simd.Batch, simd.Hits.data());
+    });
+    return passed;
+}
@@ -0,0 +1,20 @@
+//
+//  collision_benchmark.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/26.
+//
+
+#ifndef COLLISION_BENCHMARK_H
+#define COLLISION_BENCHMARK_H
+
+#include <glad/glad.h>
+
+class BenchmarkSuite;
+
+// 批量碰撞检测的基准测试
+// 同一批随机点分别用标量版本和 SIMD 版本检测，先校验两者的结果完全相同，再分别计时，每次操作处理 count 个点。
+// 结果不一致时返回 false
+GLboolean RunCollisionBenchmarks(BenchmarkSuite &suite, GLuint count = 4096);
+
+#endif /* collision_benchmark_h */
@@ -0,0 +1,136 @@
+//
+//  headless_context.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/28.
+//
+
+#include "headless_context.h"
+
+#include <iostream>
+
+#ifdef __APPLE__
+#include <GLFW/glfw3.h>
+
+static GLFWwindow *Window = nullptr;
+
+GLboolean HeadlessContext::Create(GLuint width, GLuint height)
+{
+    if (!glfwInit()) {
+        std::cout << "ERROR::HEADLESS_CONTEXT: Failed to initialize GLFW" << std::endl;
+        return GL_FALSE;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    // 和游戏窗口一样，默认帧缓冲带 4 倍多重采样，没有特效时场景直接画在上面
+    glfwWindowHint(GLFW_SAMPLES, 4);
+    Window = glfwCreateWindow(width, height, "benchmark", nullptr, nullptr);
+    if (!Window) {
+        std::cout << "ERROR::HEADLESS_CONTEXT: Failed to create hidden window" << std::endl;
+        glfwTerminate();
+        return GL_FALSE;
+    }
+    glfwMakeContextCurrent(Window);
+    // 基准测试不等垂直同步
+    glfwSwapInterval(0);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "ERROR::HEADLESS_CONTEXT: Failed to initialize GLAD" << std::endl;
+        Destroy();
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+
+void HeadlessContext::Destroy()
+{
+    if (Window) {
+        glfwDestroyWindow(Window);
+        Window = nullptr;
+    }
+    glfwTerminate();
+}
+
+#else
+#include <EGL/egl.h>
+
+static EGLDisplay Display = EGL_NO_DISPLAY;
+static EGLSurface Surface = EGL_NO_SURFACE;
+static EGLContext Context = EGL_NO_CONTEXT;
+
+GLboolean HeadlessContext::Create(GLuint width, GLuint height)
+{
+    // 没有 X11 / Wayland 时设置 EGL_PLATFORM=surfaceless，Mesa 会用 llvmpipe 软件渲染
+    Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, nullptr, nullptr)) {
+        std::cout << "ERROR::HEADLESS_CONTEXT: Failed to initialize EGL display" << std::endl;
+        return GL_FALSE;
+    }
+    // 和游戏窗口一样，默认帧缓冲带 4 倍多重采样，没有特效时场景直接画在上面；没有这样的配置就用单采样的
+    EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SAMPLE_BUFFERS, 1, EGL_SAMPLES, 4,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(Display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        configAttributes[12] = EGL_NONE;
+        eglChooseConfig(Display, configAttributes, &config, 1, &configCount);
+    }
+    if (configCount == 0) {
+        std::cout << "ERROR::HEADLESS_CONTEXT: No EGL config with pbuffer and OpenGL support" << std::endl;
+        Destroy();
+        return GL_FALSE;
+    }
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, static_cast<EGLint>(width), EGL_HEIGHT, static_cast<EGLint>(height), EGL_NONE };
+    Surface = eglCreatePbufferSurface(Display, config, surfaceAttributes);
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    Context = eglCreateContext(Display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (Surface == EGL_NO_SURFACE || Context == EGL_NO_CONTEXT || !eglMakeCurrent(Display, Surface, Surface, Context)) {
+        std::cout << "ERROR::HEADLESS_CONTEXT: Failed to create OpenGL 3.3 core context" << std::endl;
+        Destroy();
+        return GL_FALSE;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cout << "ERROR::HEADLESS_CONTEXT: Failed to initialize GLAD" << std::endl;
+        Destroy();
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+
+void HeadlessContext::Destroy()
+{
+    if (Display == EGL_NO_DISPLAY) {
+        return;
+    }
+    eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (Context != EGL_NO_CONTEXT)
+        eglDestroyContext(Display, Context);
+    if (Surface != EGL_NO_SURFACE)
+        eglDestroySurface(Display, Surface);
+    eglTerminate(Display);
+    Display = EGL_NO_DISPLAY;
+    Surface = EGL_NO_SURFACE;
+    Context = EGL_NO_CONTEXT;
+}
+
+#endif
+
+std::string HeadlessContext::Description()
+{
+    const GLubyte *renderer = glGetString(GL_RENDERER);
+    const GLubyte *version = glGetString(GL_VERSION);
+    return std::string(renderer ? reinterpret_cast<const char *>(renderer) : "unknown") + ", " + (version ? reinterpret_cast<const char *>(version) : "unknown");
+}
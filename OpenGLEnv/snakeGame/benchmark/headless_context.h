@@ -0,0 +1,31 @@
+//
+//  headless_context.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/28.
+//
+
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <string>
+
+#include <glad/glad.h>
+
+// 没有窗口的 OpenGL 3.3 core 上下文，渲染基准测试用
+// macOS 上用隐藏的 GLFW 窗口；其他平台用 EGL pbuffer，没有显示器和 GPU 的机器（Mesa llvmpipe）也能创建。
+// 渲染目标是 pbuffer 或者隐藏窗口的默认帧缓冲，不会显示出来。
+class HeadlessContext
+{
+public:
+    // 创建上下文并设为当前上下文，加载 OpenGL 函数，失败返回 false
+    static GLboolean Create(GLuint width, GLuint height);
+    // 销毁上下文
+    static void Destroy();
+    // GL_RENDERER 和 GL_VERSION，例如 "llvmpipe (LLVM 12.0.0, 256 bits), 3.3 (Core Profile) Mesa 21.2.6"
+    static std::string Description();
+private:
+    HeadlessContext() { }
+};
+
+#endif /* headless_context_h */
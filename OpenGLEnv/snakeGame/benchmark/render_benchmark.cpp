@@ -0,0 +1,301 @@
+//
+//  render_benchmark.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/28.
+//
+
+#include "render_benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "benchmark.h"
+#include "render_stats.h"
+#include "resource_manager.h"
+#include "game_object.h"
+#include "foods_manager.h"
+#include "sprite_renderer.h"
+#include "sprite_batch_renderer.h"
+#include "sprite_batch_gpu_renderer.h"
+#include "particle_generator.h"
+#include "post_processor.h"
+#include "text_renderer.h"
+
+// 蛇的节点数，和竞技场里一条很长的蛇差不多
+static const GLuint SNAKE_NODES = 2000;
+// 食物数量
+static const GLuint FOOD_COUNT = 6000;
+// 粒子数量，和游戏里的粒子发射器一样
+static const GLuint PARTICLE_COUNT = 500;
+// 每个场景至少测量的帧数
+static const GLuint MIN_FRAMES = 10;
+
+// 按帧测量一个场景，scene 里只做绘制
+template <typename Scene>
+static void MeasureScene(BenchmarkSuite &suite, const std::string &name, GLuint size, GLuint query, Scene scene)
+{
+    if (!suite.Enabled(name)) {
+        return;
+    }
+    // 预热：第一帧会编译着色器变体、分配缓冲区，不计入结果
+    glClear(GL_COLOR_BUFFER_BIT);
+    scene();
+    glFinish();
+    
+    GLuint frames = 0;
+    GLdouble cpuSeconds = 0.0, wallSeconds = 0.0;
+    GLuint64 gpuNanoseconds = 0;
+    uint64_t drawCalls = 0, instances = 0, uploadBytes = 0;
+    AllocationStats before = AllocationStats::Now();
+    while (frames < MIN_FRAMES || wallSeconds < suite.MinSeconds) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        RenderStats::Reset();
+        
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        scene();
+        std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+        glEndQuery(GL_TIME_ELAPSED);
+        // 等 GPU 画完再读查询结果，否则下一帧的提交会和这一帧的渲染重叠
+        glFinish();
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        
+        cpuSeconds += std::chrono::duration<GLdouble>(submitted - start).count();
+        wallSeconds += std::chrono::duration<GLdouble>(std::chrono::steady_clock::now() - start).count();
+        gpuNanoseconds += elapsed;
+        drawCalls += RenderStats::DrawCalls;
+        instances += RenderStats::Instances;
+        uploadBytes += RenderStats::UploadedBytes();
+        frames++;
+    }
+    AllocationStats after = AllocationStats::Now();
+    
+    std::vector<BenchmarkCounter> counters;
+    counters.push_back({ "gpu_ns", static_cast<GLdouble>(gpuNanoseconds) / frames });
+    counters.push_back({ "draw_calls", static_cast<GLdouble>(drawCalls) / frames });
+    counters.push_back({ "instances", static_cast<GLdouble>(instances) / frames });
+    counters.push_back({ "upload_bytes", static_cast<GLdouble>(uploadBytes) / frames });
+    suite.Record(name, size, frames, cpuSeconds, before, after, counters);
+}
+
+// 盘成螺旋的蛇，所有节点都在画面里，和游戏里一样前后节点互相重叠
+static std::vector<GameObject> SpiralSnake(GLuint count, glm::vec2 center, Texture2D head, Texture2D body)
+{
+    std::vector<GameObject> nodes;
+    nodes.reserve(count);
+    glm::vec2 nodeSize(24.0f);
+    GLfloat angle = 0.0f;
+    for (GLuint i = 0; i < count; i++) {
+        // 半径随角度增长，相邻节点相隔约半个节点
+        GLfloat radius = 20.0f + 4.0f * angle;
+        glm::vec2 direction(glm::cos(angle), glm::sin(angle));
+        GameObject node(center + direction * radius - nodeSize / 2.0f, nodeSize, i == 0 ? head : body);
+        node.RotationQuat = glm::angleAxis(angle + glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        nodes.push_back(node);
+        angle += 12.0f / radius;
+    }
+    return nodes;
+}
+
+void RenderBenchmark::Run(BenchmarkSuite &suite, GLuint width, GLuint height)
+{
+    /// 加载着色器和纹理，名字和 Game::InitRenderer 一样
+    ResourceManager::LoadShader("sprite.vs", "sprite.fs", nullptr, "sprite");
+    ResourceManager::LoadShader("sprite_batch_renderer.vs", "sprite_batch_renderer.fs", nullptr, "sprite_batch");
+    ResourceManager::LoadShader("sprite_batch_gpu_renderer.vs", "sprite_batch_gpu_renderer.fs", nullptr, "sprite_batch_gpu");
+    ResourceManager::LoadShader("particle.vs", "particle.fs", nullptr, "particle");
+    ResourceManager::LoadShaderVariants("post_processing.vs", "post_processing.fs", PostProcessor::EffectFeatures(), "postprocessing");
+    ResourceManager::LoadEmptyTexture();
+    Texture2D head = ResourceManager::LoadTexture("skin_head_0.png", GL_TRUE, "skin_head_0");
+    Texture2D body = ResourceManager::LoadTexture("skin_body_0.png", GL_TRUE, "skin_body_0");
+    std::vector<Texture2D> foodSprites;
+    for (GLuint i = 0; i < 14; i++) {
+        std::stringstream file, name;
+        file << "food_" << i << ".png";
+        name << "food_" << i;
+        foodSprites.push_back(ResourceManager::LoadTexture(file.str().c_str(), GL_TRUE, name.str()));
+    }
+    
+    glm::mat4 projection = glm::ortho(0.0f, static_cast<GLfloat>(width), static_cast<GLfloat>(height), 0.0f, -1.0f, 1.0f);
+    const GLchar *shaders[] = { "sprite", "sprite_batch", "sprite_batch_gpu", "particle" };
+    for (const GLchar *shaderName : shaders) {
+        Shader shader = ResourceManager::GetShader(shaderName);
+        shader.Use();
+        shader.SetMatrix4("projection", projection);
+    }
+    Shader spriteShader = ResourceManager::GetShader("sprite");
+    spriteShader.SetInteger("image", 0, GL_TRUE);
+    Shader spriteBatchShader = ResourceManager::GetShader("sprite_batch");
+    Shader spriteBatchGPUShader = ResourceManager::GetShader("sprite_batch_gpu");
+    
+    // 和 main.cpp 里的 OpenGL 配置一样
+    glViewport(0, 0, width, height);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    
+    SpriteRenderer *spriteRenderer = new SpriteRenderer(spriteShader);
+    SpriteBatchRenderer *batchRenderer = new SpriteBatchRenderer(spriteBatchShader);
+    SpriteBatchGPURenderer *batchGPURenderer = new SpriteBatchGPURenderer(spriteBatchGPUShader);
+    ParticleGenerator *particles = new ParticleGenerator(ResourceManager::GetShader("particle"), ResourceManager::GetEmptyTexture(), PARTICLE_COUNT);
+    PostProcessor *effects = new PostProcessor(ResourceManager::GetShaderVariants("postprocessing"), width, height);
+    TextRenderer *text = new TextRenderer(width, height);
+    text->Load("OCRAEXT.TTF", 24);
+    
+    GLuint query;
+    glGenQueries(1, &query);
+    
+    /// 蛇：同样的节点分别用逐个绘制、CPU 计算矩阵的批量绘制和 GPU 计算矩阵的批量绘制
+    glm::vec2 center(width / 2.0f, height / 2.0f);
+    std::vector<GameObject> nodes = SpiralSnake(SNAKE_NODES, center, head, body);
+    MeasureScene(suite, "render.sprite", SNAKE_NODES, query, [&]() {
+        for (GLint i = SNAKE_NODES - 1; i >= 0; i--) {
+            nodes[i].Draw(*spriteRenderer);
+        }
+    });
+    MeasureScene(suite, "render.sprite_batch", SNAKE_NODES, query, [&]() {
+        batchRenderer->DrawSprites(nodes);
+    });
+    MeasureScene(suite, "render.sprite_batch_gpu", SNAKE_NODES, query, [&]() {
+        batchGPURenderer->DrawSprites(nodes);
+    });
+    
+    /// 食物：和 Game::Render 一样逐个绘制，全部在视野里
+    if (suite.Enabled("render.foods")) {
+        FoodsManager foods(glm::vec2(0.0f), glm::vec2(width, height), foodSprites);
+        foods.GenerateSpriteFoods(FOOD_COUNT, glm::vec2(24.0f));
+        MeasureScene(suite, "render.foods", FOOD_COUNT, query, [&]() {
+            foods.Draw(*spriteRenderer, glm::vec2(0.0f), glm::vec2(width, height));
+        });
+    }
+    
+    /// 粒子：所有粒子都是活的，排成网格
+    std::vector<Particle> liveParticles(PARTICLE_COUNT);
+    for (GLuint i = 0; i < PARTICLE_COUNT; i++) {
+        liveParticles[i].Position = glm::vec2((i % 25) * width / 25.0f, (i / 25) * height / 20.0f);
+        liveParticles[i].Color = glm::vec4(1.0f, 0.6f, 0.2f, 0.8f);
+        liveParticles[i].Life = 1.0f;
+    }
+    MeasureScene(suite, "render.particles", PARTICLE_COUNT, query, [&]() {
+        particles->Draw(liveParticles);
+    });
+    
+    /// 文本：游戏里菜单和分数的几行字
+    const std::string lines[] = { "Lives:3", "Score:2000", "Press SPACE to start", "Press W/S/A/D to control direction", "Press + to speed up" };
+    GLuint characters = 0;
+    for (const std::string &line : lines) {
+        characters += static_cast<GLuint>(line.size());
+    }
+    MeasureScene(suite, "render.text", characters, query, [&]() {
+        GLfloat y = 5.0f;
+        for (const std::string &line : lines) {
+            text->RenderText(line, 5.0f, y, 1.0f);
+            y += 40.0f;
+        }
+    });
+    
+    /// 后处理：没有特效时清空多重采样帧缓冲、直接解析到默认帧缓冲
+    MeasureScene(suite, "render.postprocess", width * height, query, [&]() {
+        effects->BeginRender();
+        effects->EndRender();
+        effects->Render(0.0f);
+    });
+    
+    /// 后处理：有特效（shake 的模糊变体）时解析到纹理、画全屏四边形
+    effects->Shake = GL_TRUE;
+    MeasureScene(suite, "render.postprocess.shake", width * height, query, [&]() {
+        effects->BeginRender();
+        effects->EndRender();
+        effects->Render(0.0f);
+    });
+    effects->Shake = GL_FALSE;
+    
+    /// 动态分辨率：同样的蛇按不同的渲染比例画，比例小于 1 时画到缩小的离屏帧缓冲、放大到默认帧缓冲
+    const GLfloat scales[] = { 1.0f, 0.75f, 0.5f };
+    for (GLfloat scale : scales) {
+        char name[32];
+        snprintf(name, sizeof(name), "render.scale.%.2f", scale);
+        effects->RenderScale = scale;
+        MeasureScene(suite, name, SNAKE_NODES, query, [&]() {
+            effects->BeginRender();
+            batchGPURenderer->DrawSprites(nodes);
+            effects->EndRender();
+            effects->Render(0.0f);
+        });
+    }
+    effects->RenderScale = 1.0f;
+    
+    /// 抗锯齿：同样一帧（GPU 批量绘制的蛇）在每种抗锯齿方式下的代价，包括解析或者 FXAA 的全屏 pass。
+    /// 上下文的默认帧缓冲采样数是固定的，这里用一个单采样的帧缓冲代替窗口：
+    /// MSAA 画到同样采样数的多重采样缓冲再解析过去（窗口交换缓冲时驱动做的也是这件事），none 直接画在上面，
+    /// FXAA 和游戏里一样经过 PostProcessor 画到单采样纹理，再用 FXAA 变体画过去
+    GLuint presentFBO, presentRBO;
+    glGenFramebuffers(1, &presentFBO);
+    glGenRenderbuffers(1, &presentRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, presentRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, presentFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, presentRBO);
+    GLint maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    PostProcessor *fxaa = new PostProcessor(ResourceManager::GetShaderVariants("postprocessing"), width, height, AA_FXAA);
+    const AntiAliasing modes[] = { AA_NONE, AA_MSAA_2, AA_MSAA_4, AA_MSAA_8, AA_FXAA };
+    for (AntiAliasing mode : modes) {
+        std::string name = std::string("render.aa.") + PostProcessor::AntiAliasingName(mode);
+        if (!suite.Enabled(name)) {
+            continue;
+        }
+        GLuint samples = std::min(PostProcessor::Samples(mode), static_cast<GLuint>(maxSamples));
+        GLuint sceneFBO = 0, sceneRBO = 0;
+        if (samples > 1) {
+            glGenFramebuffers(1, &sceneFBO);
+            glGenRenderbuffers(1, &sceneRBO);
+            glBindRenderbuffer(GL_RENDERBUFFER, sceneRBO);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGB8, width, height);
+            glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneRBO);
+        }
+        MeasureScene(suite, name, width * height, query, [&]() {
+            if (mode == AA_FXAA) {
+                fxaa->BeginRender();
+                batchGPURenderer->DrawSprites(nodes);
+                fxaa->EndRender();
+                glBindFramebuffer(GL_FRAMEBUFFER, presentFBO);
+                fxaa->Render(0.0f);
+                return;
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, samples > 1 ? sceneFBO : presentFBO);
+            glClear(GL_COLOR_BUFFER_BIT);
+            batchGPURenderer->DrawSprites(nodes);
+            if (samples > 1) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, presentFBO);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            }
+        });
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteRenderbuffers(1, &sceneRBO);
+        glDeleteFramebuffers(1, &sceneFBO);
+    }
+    delete fxaa;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &presentRBO);
+    glDeleteFramebuffers(1, &presentFBO);
+    
+    glDeleteQueries(1, &query);
+    delete text;
+    delete effects;
+    delete particles;
+    delete batchGPURenderer;
+    delete batchRenderer;
+    delete spriteRenderer;
+    ResourceManager::Clear();
+}
@@ -0,0 +1,26 @@
+//
+//  render_benchmark.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/28.
+//
+
+#ifndef RENDER_BENCHMARK_H
+#define RENDER_BENCHMARK_H
+
+#include <glad/glad.h>
+
+class BenchmarkSuite;
+
+// 渲染基准测试，需要当前线程有 OpenGL 3.3 上下文（见 HeadlessContext）
+// 每个场景按帧测量：CPU 提交耗时（调用 render 到返回）、GPU 耗时（GL_TIME_ELAPSED 查询），
+// 以及每帧的绘制调用次数、实例数和上传到 GPU 的字节数（RenderStats）。
+// 每帧结束后 glFinish 等 GPU 完成，所以帧与帧之间不重叠，GPU 耗时就是这个场景自己的耗时。
+class RenderBenchmark
+{
+public:
+    // 加载着色器和纹理，执行所有渲染场景，width、height 是渲染目标大小
+    static void Run(BenchmarkSuite &suite, GLuint width, GLuint height);
+};
+
+#endif /* render_benchmark_h */
@@ -0,0 +1,153 @@
+//
+//  simulation_benchmark.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/27.
+//
+
+#include "simulation_benchmark.h"
+
+#include <vector>
+
+#include "benchmark.h"
+#include "game.h"
+#include "foods_manager.h"
+#include "occupancy_grid.h"
+#include "snake_object.h"
+#include "sprite_batch_gpu_renderer.h"
+
+// 固定 60 帧每秒的更新间隔
+static const GLfloat BENCHMARK_DT = 1.0f / 60.0f;
+
+// 蛇的纹理只用来区分头、身体和尾巴，不需要真的加载
+static std::vector<Texture2D> BenchmarkSprites()
+{
+    std::vector<Texture2D> sprites(3);
+    for (GLuint i = 0; i < sprites.size(); i++) {
+        sprites[i].ID = i + 1;
+    }
+    return sprites;
+}
+
+static SnakeObject *CreateSnake(GLuint length)
+{
+    SnakeObject *snake = new SnakeObject(glm::vec2(0.0f), glm::vec2(24.0f), length, BenchmarkSprites(), 90, glm::vec2(0.0f, -150.0f));
+    snake->Pause = GL_FALSE;
+    return snake;
+}
+
+// 每次移动前稍微转一点方向，身体是弯曲的，和游戏里一样
+static void Steer(SnakeObject &snake, GLfloat &angle)
+{
+    angle += 0.05f;
+    snake.Turn(glm::vec2(glm::cos(angle), glm::sin(angle)));
+}
+
+void SimulationBenchmark::SnakeMove(BenchmarkSuite &suite)
+{
+    const GLuint lengths[] = { 10, 100, 1000, 10000, 100000, 1000000 };
+    for (GLuint length : lengths) {
+        if (!suite.Enabled("snake.move_body")) {
+            return;
+        }
+        SnakeObject *snake = CreateSnake(length);
+        GLfloat angle = 0.0f;
+        suite.Run("snake.move_body1", length, [&]() {
+            Steer(*snake, angle);
+            snake->MoveBody1(BENCHMARK_DT);
+        });
+        suite.Run("snake.move_body2", length, [&]() {
+            Steer(*snake, angle);
+            snake->MoveBody2(BENCHMARK_DT);
+        });
+        delete snake;
+    }
+}
+
+void SimulationBenchmark::SnakeGrowth(BenchmarkSuite &suite)
+{
+    // 每次操作从空数组开始长到 length 个节点，节点数组扩容的分配次数也统计在内
+    const GLuint lengths[] = { 100, 10000, 1000000 };
+    for (GLuint length : lengths) {
+        if (!suite.Enabled("snake.add_tail_node")) {
+            return;
+        }
+        SnakeObject *snake = CreateSnake(1);
+        suite.Run("snake.add_tail_node", length, [&]() {
+            std::vector<GameObject>().swap(snake->Nodes);
+            for (GLuint i = 0; i < length; i++) {
+                snake->AddTailNode();
+            }
+        });
+        delete snake;
+    }
+}
+
+void SimulationBenchmark::FoodsRespawn(BenchmarkSuite &suite)
+{
+    // 竞技场大小的地图，每次有四分之一的食物被吃掉，然后全部重新生成
+    const GLuint foodCounts[] = { 6000, 60000 };
+    glm::vec2 mapSize(24000.0f);
+    for (GLuint foodCount : foodCounts) {
+        if (!suite.Enabled("foods.update_respawn")) {
+            return;
+        }
+        OccupancyGrid occupancy(glm::vec2(0.0f), mapSize, 24.0f);
+        FoodsManager foods(glm::vec2(0.0f), mapSize, BenchmarkSprites());
+        foods.Occupancy = &occupancy;
+        foods.GenerateSpriteFoods(foodCount, glm::vec2(24.0f));
+        GLuint offset = 0;
+        suite.Run("foods.update_respawn", foodCount, [&]() {
+            for (GLuint i = offset; i < foods.Foods.size(); i += 4) {
+                foods.Foods[i].Destroyed = GL_TRUE;
+            }
+            offset = (offset + 1) % 4;
+            foods.Update(BENCHMARK_DT);
+        });
+    }
+}
+
+void SimulationBenchmark::InstanceBuild(BenchmarkSuite &suite)
+{
+    const GLuint counts[] = { 100, 10000, 1000000 };
+    for (GLuint count : counts) {
+        if (!suite.Enabled("render.build_instances")) {
+            return;
+        }
+        SnakeObject *snake = CreateSnake(count);
+        std::vector<SpriteInstanceData> instances(count);
+        GLuint textureIDs[8];
+        suite.Run("render.build_instances", count, [&]() {
+            SpriteBatchGPURenderer::BuildInstances(snake->Nodes.data(), count, instances.data(), textureIDs);
+        });
+        delete snake;
+    }
+}
+
+void SimulationBenchmark::Arena(BenchmarkSuite &suite, GLuint threads)
+{
+    // 食物密度从低到高，每一档用新的竞技场
+    const GLuint foodCounts[] = { 1500, 6000, 24000 };
+    for (GLuint foodCount : foodCounts) {
+        if (!suite.Enabled("game.")) {
+            return;
+        }
+        Game *game = new Game(600, 600);
+        game->Config = ArenaConfig::LargeArena();
+        game->Config.Threads = threads;
+        game->Config.FoodCount = foodCount;
+        game->Init(GL_TRUE);
+        // 先跑一秒，让 AI 蛇散开、吃掉一些食物
+        for (GLuint i = 0; i < 60; i++) {
+            game->Update(BENCHMARK_DT);
+        }
+        // 重复检测同一帧的状态，被吃掉的食物要等下一次更新才会重新生成
+        suite.Run("game.do_collisions", foodCount, [&]() {
+            game->DoCollisions(BENCHMARK_DT);
+        });
+        suite.Run("game.update", foodCount, [&]() {
+            game->Update(BENCHMARK_DT);
+        });
+        delete game;
+    }
+}
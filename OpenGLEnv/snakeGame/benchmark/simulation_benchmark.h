@@ -0,0 +1,32 @@
+//
+//  simulation_benchmark.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/27.
+//
+
+#ifndef SIMULATION_BENCHMARK_H
+#define SIMULATION_BENCHMARK_H
+
+#include <glad/glad.h>
+
+class BenchmarkSuite;
+
+// 模拟热点的基准测试，不需要窗口和 OpenGL 上下文
+// 是 SnakeObject 和 Game 的友元，可以直接测量私有的移动和碰撞检测函数
+class SimulationBenchmark
+{
+public:
+    // 蛇身移动（MoveBody1、MoveBody2），长度从 10 到 100 万
+    static void SnakeMove(BenchmarkSuite &suite);
+    // 蛇变长（AddTailNode），包括节点数组扩容
+    static void SnakeGrowth(BenchmarkSuite &suite);
+    // 大量食物被吃掉后重新生成（FoodsManager::Update）
+    static void FoodsRespawn(BenchmarkSuite &suite);
+    // 实例数据填充（SpriteBatchGPURenderer::BuildInstances）
+    static void InstanceBuild(BenchmarkSuite &suite);
+    // 竞技场里不同食物密度下的碰撞检测（Game::DoCollisions）和完整的一次更新，threads 是更新线程数
+    static void Arena(BenchmarkSuite &suite, GLuint threads);
+};
+
+#endif /* simulation_benchmark_h */
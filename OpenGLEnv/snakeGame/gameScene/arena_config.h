@@ -0,0 +1,36 @@
+//
+//  arena_config.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/12.
+//
+
+#ifndef ARENA_CONFIG_H
+#define ARENA_CONFIG_H
+
+#include <glad/glad.h>
+
+// 竞技场配置，需要在 Game::Init 之前设置
+struct ArenaConfig {
+    GLuint  MapScale;// 地图大小是窗口大小的几倍
+    GLuint  FoodCount;// 食物数量
+    GLuint  BotCount;// AI 蛇数量
+    GLuint  PlayerLength;// 玩家蛇出生长度
+    GLuint  BotLength;// AI 蛇出生长度
+    GLuint  Threads;// 更新用的线程数量（包括主线程），0 表示按 CPU 核心数自动决定
+
+    // 默认是经典模式：一条玩家蛇，没有 AI 蛇
+    ArenaConfig() : MapScale(4), FoodCount(300), BotCount(0), PlayerLength(50), BotLength(20), Threads(0) { }
+
+    // 大地图竞技场：500 条 AI 蛇
+    static ArenaConfig LargeArena()
+    {
+        ArenaConfig config;
+        config.MapScale = 40;
+        config.FoodCount = 6000;
+        config.BotCount = 500;
+        return config;
+    }
+};
+
+#endif /* arena_config_h */
@@ -7,11 +7,16 @@
 
 #include "game.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "resource_manager.h"
+#include "asset_loader.h"
 #include "sprite_renderer.h"
 #include "sprite_batch_renderer.h"
 #include "sprite_batch_gpu_renderer.h"
@@ -19,7 +24,18 @@
 #include "particle_generator.h"
 #include "post_processor.h"
 #include "text_renderer.h"
+#include "perf_hud.h"
+#include "render_stats.h"
 #include "camera_2d.h"
+#include "job_system.h"
+#include "replay.h"
+#include "spatial_grid.h"
+#include "occupancy_grid.h"
+#include "collision_kernels.h"
+#include "profiler.h"
+#include "gpu_profiler.h"
+#include "frame_arena.h"
+#include "allocation_stats.h"
 
 #include "snake_object.h"
 #include "foods_manager.h"
@@ -44,68 +60,202 @@ ParticleGenerator   *Particles;
 // 后处理-特效
 PostProcessor       *Effects;
 GLfloat             ShakeTime = 0.0f;
+GLboolean           ChaosEffect = GL_FALSE;
 
 // 文本
 TextRenderer        *Text;
 
+// 性能面板
+PerfHud             *Hud;
+
 // 摄像机
 Camera2D            *Camera;
 
+// 异步资源加载，纹理在工作线程里解码，每帧上传几张
+AssetLoader         *Loader;
+const GLuint        TEXTURE_UPLOADS_PER_FRAME = 4;
+
 /// 精灵
-// 蛇
-SnakeObject         *Snake;
 // 初始化蛇的速率和方向
 const GLfloat       INITIAL_SNAKE_VELOCITY = 150;
 const glm::vec2     INITIAL_SNAKE_DIRECTION(0.0f, -1.0f);// 默认向上
+// 蛇皮肤的头、身体、尾巴纹理，在 Init 里（GL 线程）取好；模拟线程生成 AI 蛇时只读这里，
+// 不访问渲染线程还在写入的 ResourceManager::Textures
+const GLuint        SNAKE_SKIN_COUNT = 6;
+std::vector<Texture2D> SkinSprites[SNAKE_SKIN_COUNT];
 
 // 食物管理
 const GLfloat       INITIAL_FOOD_MAGNET_VELOCITY = 200;// 食物磁吸速率
+const GLfloat       INITIAL_FOOD_MAGNET_RANGE = 50;// 食物磁吸范围
 FoodsManager        *FoodsMgr;
 
-void LoadTextures(GLuint count, std::string filePrefix);
+// 任务调度
+JobSystem           *Jobs;
+SpatialGrid         HeadGrid;// 蛇头的空间索引，用于按食物查找附近的蛇
+std::vector<glm::vec2> HeadCenters;// 重建蛇头索引用的蛇头中心点
+std::vector<glm::vec2> PreviousCenters;// 蛇头移动前的中心点
+OccupancyGrid       Occupancy;// 地图格子的占用情况，生成食物和 AI 蛇时用来找空闲格子
+
+// 蛇身节点的空间索引，用于蛇头和所有蛇身（包括自己）的碰撞检测
+struct SegmentRef {
+    GLuint  Snake;
+    GLuint  Node;
+};
+SpatialGrid         SegmentGrid;
+std::vector<SegmentRef> SegmentRefs;// 索引里每个元素对应的蛇和节点
+std::vector<glm::vec2> SegmentCenters;// 重建蛇身索引用的节点中心点
+const GLuint        SNAKE_NECK_NODES = 4;// 检测自身碰撞时跳过的脖子节点数，转弯时它们离蛇头很近
+
+// 食物被蛇吃掉的记录，并行检测后按蛇的顺序统一处理
+struct EatEvent {
+    GLuint  Snake;
+    GLuint  Food;
+};
+
+void LoadTextures(AssetLoader &loader, GLuint count, std::string filePrefix);
 std::vector<Texture2D> GetSkinTextures(std::string headPrefix, std::string bodyPrefix, std::string tailPrefix, GLuint number);
 std::vector<Texture2D> GetTextures(GLuint count, std::string filePrefix);
 
 Game::Game(GLuint width, GLuint height)
-    : State(GAME_MENU), Keys(), Width(width), Height(height), Lives(3)
+    : KeysPressedTick(), KeysReleasePending(), MouseKeysPressedTick(), MouseKeysReleasePending(), LastRenderStart(0), State(GAME_MENU), Keys(), KeysProcessed(), MouseKeys(), Tick(0), Seed(1), Headless(GL_FALSE), ShowPerfHud(GL_FALSE), AA(AA_MSAA_4), Recorder(nullptr), Width(width), Height(height), FramebufferWidth(width), FramebufferHeight(height), Viewport(0, 0, width, height), Lives(3), Player(nullptr)
 {
-    glm::vec2 mapOrigin = glm::vec2(0, 0);
-    GLuint mapScale = 4;
-    GLfloat mapWidth = this->Width * mapScale;
-    GLfloat mapHeight = this->Height * mapScale;
-    
-    this->MapOrigin = mapOrigin;
-    this->MapWidth = mapWidth;
-    this->MapHeight = mapHeight;
-    this->GridSize = 24.0;
-    GRID_ROWS = this->MapWidth / 24.0;
-    GRID_COLS = this->MapHeight / 24.0;
+    this->SetupMap();
 }
 
 Game::~Game()
 {
+    // 渲染和模拟对象是全局的，释放后置空，同一个进程里可以先后创建多个游戏（基准测试）
     delete SpriteRender;
+    SpriteRender = nullptr;
+    delete SpriteBatchRender;
+    SpriteBatchRender = nullptr;
+    delete SpriteBatchGPURender;
+    SpriteBatchGPURender = nullptr;
     delete LineRender;
+    LineRender = nullptr;
     delete Particles;
+    Particles = nullptr;
     delete Effects;
+    Effects = nullptr;
     delete Text;
+    Text = nullptr;
+    delete Hud;
+    Hud = nullptr;
     delete Camera;
-    delete Snake;
+    Camera = nullptr;
+    while (!this->Snakes.empty()) {
+        this->DespawnSnake(static_cast<GLuint>(this->Snakes.size() - 1));
+    }
     delete FoodsMgr;
+    FoodsMgr = nullptr;
+    // 加载器要等还在解码的任务，在任务系统之前释放
+    delete Loader;
+    Loader = nullptr;
+    delete Jobs;
+    Jobs = nullptr;
 }
 
-void Game::Init()
+void Game::SetupMap()
 {
+    glm::vec2 mapOrigin = glm::vec2(0, 0);
+    GLuint mapScale = this->Config.MapScale;
+    GLfloat mapWidth = this->Width * mapScale;
+    GLfloat mapHeight = this->Height * mapScale;
+    
+    this->MapOrigin = mapOrigin;
+    this->MapWidth = mapWidth;
+    this->MapHeight = mapHeight;
+    this->GridSize = 24.0;
+    GRID_ROWS = this->MapWidth / 24.0;
+    GRID_COLS = this->MapHeight / 24.0;
+}
+
+void Game::Init(GLboolean headless)
+{
+    MemoryTagScope tag(MEMORY_TAG_SIMULATION);
+    this->Headless = headless;
+    // 配置可能在构造之后被修改，重新计算地图大小
+    this->SetupMap();
+    // 所有随机数流都从这个种子开始，相同的种子和输入得到相同的游戏过程
+    this->Random.Seed(this->Seed, RANDOM_STREAM_GAME);
+    this->BotRandom.Seed(this->Seed, RANDOM_STREAM_BOTS);
+    
+    /// 创建任务调度器
+    Jobs = new JobSystem(this->Config.Threads);
+    HeadGrid = SpatialGrid(this->MapOrigin, glm::vec2(this->MapWidth, this->MapHeight), 96.0f);
+    SegmentGrid = SpatialGrid(this->MapOrigin, glm::vec2(this->MapWidth, this->MapHeight), 96.0f);
+    Occupancy = OccupancyGrid(this->MapOrigin, glm::vec2(this->MapWidth, this->MapHeight), this->GridSize);
+    
     /// 安装摄像机
     Camera = new Camera2D(this->Width, this->Height);
     
+    /// 加载渲染资源，只做模拟时不需要
+    if (!this->Headless) {
+        this->InitRenderer();
+    }
+    
+    // 加载一个空的纹理
+    ResourceManager::LoadEmptyTexture();
+    // 创建粒子发射器，渲染数据在第一次绘制时创建
+    Particles = new ParticleGenerator(
+        ResourceManager::GetShader("particle"),
+        ResourceManager::GetTexture("particle"),
+        500
+    );
+    Particles->Seed(this->Seed);
+    
+    
+    /// 创建精灵
+    // 蛇
+    for (GLuint i = 0; i < SNAKE_SKIN_COUNT; i++) {
+        SkinSprites[i] = GetSkinTextures("skin_head", "skin_body", "skin_tail", i);
+    }
+    // 由于加载的蛇头和身体纹理方向是向上的的，为了让蛇纹理方向与蛇移动方向一致，需要旋转蛇的节点，所以需要顺时针旋转 90 度
+    this->Player = new SnakeObject(glm::vec2(this->MapOrigin.x + this->MapWidth / 2.0, this->MapOrigin.y + this->MapHeight / 2.0), glm::vec2(24, 24), this->Config.PlayerLength, SkinSprites[4], 90, INITIAL_SNAKE_DIRECTION * INITIAL_SNAKE_VELOCITY, glm::vec4(0.0f, 1.0f, -1.0f, 1.0f));
+    this->Player->Controller = new PlayerController(this->Keys, this->MouseKeys, this->MousePositions);
+    this->Snakes.push_back(this->Player);
+    this->SyncOccupancy(*this->Player);
+    
+    // 食物
+    std::vector<Texture2D> foodSprites = GetTextures(14, "food");
+    FoodsMgr = new FoodsManager(this->MapOrigin, glm::vec2(this->MapWidth, this->MapHeight), foodSprites);
+    FoodsMgr->Random.Seed(this->Seed, RANDOM_STREAM_FOODS);
+    FoodsMgr->Occupancy = &Occupancy;
+    FoodsMgr->GenerateSpriteFoods(this->Config.FoodCount, glm::vec2(24, 24));
+    
+    // AI 蛇
+    for (GLuint i = 0; i < this->Config.BotCount; i++) {
+        this->SpawnBot();
+    }
+    
+    // 第一帧渲染快照
+    this->UpdateCamera();
+    if (!this->Headless) {
+        this->PublishSnapshot();
+    }
+}
+
+void Game::InitRenderer()
+{
+    MemoryTagScope tag(MEMORY_TAG_RENDER);
+    /// 加载纹理
+    // 先把解码交给工作线程，主线程接着编译着色器；纹理对象已经创建好了，精灵可以直接用，上传在 Render 里完成
+    Loader = new AssetLoader(*Jobs);
+    // 蛇纹理
+    LoadTextures(*Loader, 6, "skin_head");
+    LoadTextures(*Loader, 6, "skin_body");
+    LoadTextures(*Loader, 6, "skin_tail");
+    // 加载食物
+    LoadTextures(*Loader, 14, "food");
+    
     /// 加载着色器
     ResourceManager::LoadShader("sprite.vs", "sprite.fs", nullptr, "sprite");
     ResourceManager::LoadShader("sprite_batch_renderer.vs", "sprite_batch_renderer.fs", nullptr, "sprite_batch");
     ResourceManager::LoadShader("sprite_batch_gpu_renderer.vs", "sprite_batch_gpu_renderer.fs", nullptr, "sprite_batch_gpu");
     ResourceManager::LoadShader("line.vs", "line.fs", nullptr, "line");
     ResourceManager::LoadShader("particle.vs", "particle.fs", nullptr, "particle");
-    ResourceManager::LoadShader("post_processing.vs", "post_processing.fs", nullptr, "postprocessing");
+    ResourceManager::LoadShaderVariants("post_processing.vs", "post_processing.fs", PostProcessor::EffectFeatures(), "postprocessing");
+    ResourceManager::LoadShader("hud.vs", "hud.fs", nullptr, "hud");
     
     /// 配置着色器
     Shader spriteShader = ResourceManager::GetShader("sprite");
@@ -120,16 +270,6 @@ void Game::Init()
     
     
     
-    /// 加载纹理
-    // 加载一个空的纹理
-    ResourceManager::LoadEmptyTexture();
-    // 蛇纹理
-    LoadTextures(6, "skin_head");
-    LoadTextures(6, "skin_body");
-    LoadTextures(6, "skin_tail");
-    // 加载食物
-    LoadTextures(14, "food");
-    
     /// 创建渲染对象
     // 创建精灵渲染对象
     SpriteRender = new SpriteRenderer(spriteShader);
@@ -137,104 +277,64 @@ void Game::Init()
     SpriteBatchGPURender = new SpriteBatchGPURenderer(spriteBatchGPUShader);
     // 创建线段渲染对象
     LineRender = new LineRenderer(lineShader);
-    // 创建粒子发射器渲染对象
-    Particles = new ParticleGenerator(
-        ResourceManager::GetShader("particle"),
-        ResourceManager::GetTexture("particle"),
-        500
-    );
     // 创建特效处理渲染对象
-    Effects = new PostProcessor(ResourceManager::GetShader("postprocessing"), this->Width, this->Height);
+    Effects = new PostProcessor(ResourceManager::GetShaderVariants("postprocessing"), this->Width, this->Height, this->AA);
     // 创建文本渲染对象
     Text = new TextRenderer(this->Width, this->Height);
     Text->Load("OCRAEXT.TTF", 24);
-    
-    
-    /// 创建精灵
-    // 蛇
-    std::vector<Texture2D> snakeSprites = GetSkinTextures("skin_head", "skin_body", "skin_tail", 4);
-    // 由于加载的蛇头和身体纹理方向是向上的的，为了让蛇纹理方向与蛇移动方向一致，需要旋转蛇的节点，所以需要顺时针旋转 90 度
-    Snake = new SnakeObject(glm::vec2(this->MapOrigin.x + this->MapWidth / 2.0, this->MapOrigin.y + this->MapHeight / 2.0), glm::vec2(24, 24), 50, snakeSprites, 90, INITIAL_SNAKE_DIRECTION * INITIAL_SNAKE_VELOCITY, glm::vec4(0.0f, 1.0f, -1.0f, 1.0f));
-    
-    // 食物
-    std::vector<Texture2D> foodSprites = GetTextures(14, "food");
-    FoodsMgr = new FoodsManager(this->MapOrigin, glm::vec2(this->MapWidth, this->MapHeight), foodSprites);
-    FoodsMgr->GenerateSpriteFoods(300, glm::vec2(24, 24));
+    // 创建性能面板
+    Hud = new PerfHud(ResourceManager::GetShader("hud"), this->Width, this->Height);
+    // Init 之前可能已经设置了帧缓冲尺寸
+    this->Resize(this->FramebufferWidth, this->FramebufferHeight);
 }
 
-void Game::ProcessInput(float dt)
+void Game::Resize(GLuint framebufferWidth, GLuint framebufferHeight)
 {
+    // 最小化时帧缓冲是 0×0，保留原来的区域
+    if (framebufferWidth == 0 || framebufferHeight == 0) {
+        return;
+    }
+    this->FramebufferWidth = framebufferWidth;
+    this->FramebufferHeight = framebufferHeight;
+    // 逻辑画面按比例放大到能放下的最大尺寸，居中
+    GLfloat scale = glm::min(framebufferWidth / static_cast<GLfloat>(this->Width), framebufferHeight / static_cast<GLfloat>(this->Height));
+    GLint width = glm::max(1, static_cast<GLint>(this->Width * scale + 0.5f));
+    GLint height = glm::max(1, static_cast<GLint>(this->Height * scale + 0.5f));
+    this->Viewport = glm::ivec4((static_cast<GLint>(framebufferWidth) - width) / 2, (static_cast<GLint>(framebufferHeight) - height) / 2, width, height);
+    if (Effects) {
+        Effects->Resize(this->Viewport.x, this->Viewport.y, this->Viewport.z, this->Viewport.w);
+    }
+    if (Text) {
+        Text->SetPixelRatio(width / static_cast<GLfloat>(this->Width));
+    }
+}
+
+glm::vec2 Game::FramebufferToView(glm::vec2 position) const
+{
+    // 视口的 y 从下往上，position 的 y 从上往下
+    GLfloat top = static_cast<GLfloat>(this->FramebufferHeight) - (this->Viewport.y + this->Viewport.w);
+    return glm::vec2((position.x - this->Viewport.x) * this->Width / this->Viewport.z, (position.y - top) * this->Height / this->Viewport.w);
+}
+
+void Game::ProcessInput(float dt, GLdouble tickTime, GLdouble now)
+{
+    PROFILE_SCOPE("Game::ProcessInput");
+    // 只处理这次更新之前发生的输入，按键变化会落在它发生的那一次更新上
+    this->Input.Consume(tickTime, now, [this](const InputEvent &event) {
+        if (this->Recorder) {
+            this->Recorder->RecordInput(this->Tick, event);
+        }
+        this->ApplyInput(event);
+    });
+    
     if (this->State == GAME_ACTIVE)// 游戏中
     {
-       /**
-        速度=方向 * 速度大小
-        */
-        /// 处理键盘按键
-        if (this->Keys[GLFW_KEY_A])// 按了 A，表示左移
-        {
-            glm::vec2 left(-1, 0);
-            left = glm::normalize(left);
-            glm::vec2 snakeDirection = glm::normalize(Snake->Velocity);
-            
-            if (glm::dot(left, snakeDirection) >= 0) {// 向量点乘的值大于等于 0，说明这两个向量的夹角是小于等于 90 度的
-                Snake->Velocity = left * INITIAL_SNAKE_VELOCITY;
-            }
-        }
-        if (this->Keys[GLFW_KEY_D])// 按了 D，表示右移
-        {
-            glm::vec2 right(1, 0);
-            right = glm::normalize(right);
-            glm::vec2 snakeDirection = glm::normalize(Snake->Velocity);
-            
-            if (glm::dot(right, snakeDirection) >= 0) {//  向量点乘的值大于等于 0，说明这两个向量的夹角是小于等于 90 度的
-                Snake->Velocity = right * INITIAL_SNAKE_VELOCITY;
-            }
-        }
-        if (this->Keys[GLFW_KEY_W])// 按了 W，表示上移
-        {
-            // 因为 y 轴正方向朝下，所以 y = -1，表示向上
-            glm::vec2 up(0, -1);
-            up = glm::normalize(up);
-            glm::vec2 snakeDirection = glm::normalize(Snake->Velocity);
-            
-            if (glm::dot(up, snakeDirection) >= 0) {//  向量点乘的值大于等于 0，说明这两个向量的夹角是小于等于 90 度的
-                Snake->Velocity = up * INITIAL_SNAKE_VELOCITY;
-            }
-        }
-        if (this->Keys[GLFW_KEY_S])// 按了 S，表示下移
-        {
-            glm::vec2 down(0, 1);
-            down = glm::normalize(down);
-            glm::vec2 snakeDirection = glm::normalize(Snake->Velocity);
-            
-            if (glm::dot(down, snakeDirection) >= 0) {//  向量点乘的值大于等于 0，说明这两个向量的夹角是小于等于 90 度的
-                Snake->Velocity = down * INITIAL_SNAKE_VELOCITY;
-            }
-        }
-        
-        /// 处理鼠标按键
-        if (this->MouseKeys[GLFW_MOUSE_BUTTON_LEFT])// 按了 左键，表示朝鼠标方向移动
-        {
-            glm::vec2 mousePos = this->MousePositions[GLFW_MOUSE_BUTTON_LEFT];
-            // 点相减等于蛇到鼠标位置的方向向量，就是得到了目标位置
-            glm::vec2 targetDirection = glm::normalize(mousePos - Snake->Position);
-            glm::vec2 snakeDirection = glm::normalize(Snake->Velocity);
-            
-            if (glm::dot(targetDirection, snakeDirection) >= 0) {//  向量点乘的值大于等于 0，说明这两个向量的夹角是小于等于 90 度的
-                Snake->Velocity = targetDirection * INITIAL_SNAKE_VELOCITY;
-            }
-        }
-        
-        if (this->Keys[GLFW_KEY_EQUAL])// 按了 = 表示加速
-        {
-            Snake->SpeedUp = GL_TRUE;
-        } else {
-            Snake->SpeedUp = GL_FALSE;
-        }
+        // 玩家的输入由玩家控制器处理
+        this->Player->Controller->Control(*this->Player, this->GetArenaView(), dt);
         
         if (this->Keys[GLFW_KEY_ENTER] && !this->KeysProcessed[GLFW_KEY_ENTER])// 按下回车键表示游戏继续
         {
-            Snake->Pause = GL_FALSE;
+            this->Player->Pause = GL_FALSE;
             this->KeysProcessed[GLFW_KEY_ENTER] = GL_TRUE;
         }
     }
@@ -244,7 +344,9 @@ void Game::ProcessInput(float dt)
         if (this->Keys[GLFW_KEY_SPACE] && !this->KeysProcessed[GLFW_KEY_SPACE]) // 按下空格表示游戏开始
         {
             this->State = GAME_ACTIVE;
-            Snake->Pause = GL_FALSE;
+            for (SnakeObject *snake : this->Snakes) {
+                snake->Pause = GL_FALSE;
+            }
             this->KeysProcessed[GLFW_KEY_SPACE] = GL_TRUE;
         }
     }
@@ -254,15 +356,95 @@ void Game::ProcessInput(float dt)
         if (this->Keys[GLFW_KEY_ENTER])
         {
             this->KeysProcessed[GLFW_KEY_ENTER] = GL_TRUE;
-            Effects->Chaos = GL_FALSE;
+            ChaosEffect = GL_FALSE;
             this->State = GAME_MENU;
         }
     }
+    
+    this->ApplyPendingReleases();
+}
+
+void Game::ApplyInput(const InputEvent &event)
+{
+    if (event.Type == INPUT_KEY && event.Code >= 0 && event.Code < 1024)
+    {
+        if (event.Action == INPUT_PRESS)// 按下某个按键
+        {
+            this->Keys[event.Code] = GL_TRUE;
+            this->KeysPressedTick[event.Code] = this->Tick;
+            this->KeysReleasePending[event.Code] = GL_FALSE;
+        }
+        else if (this->KeysPressedTick[event.Code] == this->Tick)// 这次更新里刚按下，等处理完输入再释放
+        {
+            this->KeysReleasePending[event.Code] = GL_TRUE;
+        }
+        else// 释放某个按键
+        {
+            this->Keys[event.Code] = GL_FALSE;
+            this->KeysProcessed[event.Code] = GL_FALSE;
+        }
+    }
+    
+    if (event.Type == INPUT_MOUSE_BUTTON && event.Code >= 0 && event.Code < 8)
+    {
+        if (event.Action == INPUT_PRESS)// 按下了某个鼠标按键
+        {
+            this->MouseKeys[event.Code] = GL_TRUE;
+            this->MousePositions[event.Code] = event.Position;
+            this->MouseKeysPressedTick[event.Code] = this->Tick;
+            this->MouseKeysReleasePending[event.Code] = GL_FALSE;
+        }
+        else if (this->MouseKeysPressedTick[event.Code] == this->Tick)
+        {
+            this->MouseKeysReleasePending[event.Code] = GL_TRUE;
+        }
+        else// 释放某个鼠标按键
+        {
+            this->MouseKeys[event.Code] = GL_FALSE;
+        }
+    }
+}
+
+void Game::ApplyPendingReleases()
+{
+    for (GLuint key = 0; key < 1024; key++) {
+        if (this->KeysReleasePending[key]) {
+            this->KeysReleasePending[key] = GL_FALSE;
+            this->Keys[key] = GL_FALSE;
+            this->KeysProcessed[key] = GL_FALSE;
+        }
+    }
+    for (GLuint button = 0; button < 8; button++) {
+        if (this->MouseKeysReleasePending[button]) {
+            this->MouseKeysReleasePending[button] = GL_FALSE;
+            this->MouseKeys[button] = GL_FALSE;
+        }
+    }
 }
 
 void Game::Update(float dt)
 {
-    Snake->Move(dt);
+    PROFILE_SCOPE("Game::Update");
+    MemoryTagScope tag(MEMORY_TAG_SIMULATION);
+    // 只做模拟时（基准测试、回放）稳定状态不应该有任何意外分配，断言；正常游戏里只计数，在性能面板上显示
+    FrameAllocationCheck allocationCheck("Game::Update", this->Headless);
+    // AI 蛇根据竞技场状态决定方向，然后移动
+    // 每条蛇只读取食物和修改自己，按蛇分段并行
+    ArenaView arena = this->GetArenaView();
+    Jobs->ParallelFor(static_cast<GLuint>(this->Snakes.size()), 16, [this, &arena, dt](GLuint begin, GLuint end) {
+        PROFILE_SCOPE("Game::Update::MoveSnakes");
+        for (GLuint i = begin; i < end; i++) {
+            SnakeObject *snake = this->Snakes[i];
+            if (snake != this->Player && !snake->Pause) {
+                snake->Controller->Control(*snake, arena, dt);
+            }
+            snake->Move(dt);
+        }
+    });
+    // 占用网格只在这个线程里修改，大部分节点没有跨过格子，只是比较一下
+    for (SnakeObject *snake : this->Snakes) {
+        this->SyncOccupancy(*snake);
+    }
     
     this->UpdateCamera();
     
@@ -270,60 +452,161 @@ void Game::Update(float dt)
     
     this->DoCollisions(dt);
     
-    Particles->Update(dt, Snake->Nodes[0], 3);
+    Particles->Update(dt, this->Player->Nodes[0], 3, glm::vec2(0.0f), Jobs);
     
     // 减少抖动时间
     if (ShakeTime > 0.0f)
     {
         ShakeTime -= dt;
-        if (ShakeTime <= 0.0f)
-            Effects->Shake = GL_FALSE;
     }
     
-    // 游戏结束检测
-    if (Snake->Died) {
-        // 如果蛇死亡则激活shake特效
-        ShakeTime = 0.05f;
-        Effects->Shake = true;
+    {
+        // 死亡和重生是偶发事件，创建新蛇、增加食物的分配不算意外分配
+        AllowAllocationScope allow;
         
-        --this->Lives;
-        // 玩家是否已失去所有生命值? : 游戏结束
-        if (this->Lives == 0)
-        {
-            this->ResetLevel();
-            this->State = GAME_MENU;
+        // 移除死亡的 AI 蛇，身体变成食物，然后补充新的 AI 蛇
+        for (GLint i = static_cast<GLint>(this->Snakes.size()) - 1; i >= 0; i--) {
+            SnakeObject *snake = this->Snakes[i];
+            if (snake != this->Player && snake->Died) {
+                this->DropFoods(*snake);
+                this->DespawnSnake(i);
+            }
+        }
+        while (this->Snakes.size() < this->Config.BotCount + 1) {
+            this->SpawnBot();
+        }
+        
+        // 游戏结束检测
+        if (this->Player->Died) {
+            // 如果蛇死亡则激活shake特效
+            ShakeTime = 0.05f;
+        
+            --this->Lives;
+            // 玩家是否已失去所有生命值? : 游戏结束
+            if (this->Lives == 0)
+            {
+                this->ResetLevel();
+                this->State = GAME_MENU;
+            }
+            this->ResetPlayer();
         }
-        this->ResetPlayer();
     }
+        
+    // 录制这次更新之后的状态，回放时用来校验
+    if (this->Recorder && this->Recorder->WantsHash(this->Tick)) {
+        this->Recorder->RecordHash(this->Tick, this->StateHash());
+    }
+    this->Tick++;
+    
+    if (!this->Headless) {
+        this->PublishSnapshot();
+    }
+    
+    // 这一帧的临时数据都不再使用了
+    FrameArena::ThreadLocal().Reset();
 }
 
 void Game::UpdateCamera()
 {
     // 摄像机跟随蛇头移动
-    glm::vec2 snakePostion = glm::vec2(Snake->Position.x + Snake->NodeSize.x /2.0, Snake->Position.y + Snake->NodeSize.y /2.0);
+    glm::vec2 snakePostion = glm::vec2(this->Player->Position.x + this->Player->NodeSize.x /2.0, this->Player->Position.y + this->Player->NodeSize.y /2.0);
     Camera->UpdateFocusPosition(snakePostion);
-    glm::mat4 projection = Camera->GetProjectionMatrix();
+}
+
+void Game::UploadProjection(const glm::mat4 &projection)
+{
+    // 名字只构造一次，"sprite_batch_gpu" 超过了 std::string 的内部缓冲区，每帧构造都会分配内存
+    static const std::string shaderNames[] = { "sprite", "line", "sprite_batch", "sprite_batch_gpu", "particle" };
+    for (const std::string &name : shaderNames) {
+        Shader shader = ResourceManager::GetShader(name);
+        shader.Use();
+        shader.SetMatrix4("projection", projection);
+    }
+}
+
+void Game::PublishSnapshot()
+{
+    // 快照是给渲染用的，记在渲染上
+    MemoryTagScope tag(MEMORY_TAG_RENDER);
+    RenderSnapshot &snapshot = this->Snapshots.Write();
     
-    Shader spriteShader = ResourceManager::GetShader("sprite");
-    spriteShader.Use();
-    spriteShader.SetMatrix4("projection", projection);
+    snapshot.State = this->State;
+    snapshot.Lives = this->Lives;
+    snapshot.Score = static_cast<GLuint>(this->Player->Nodes.size());
+    snapshot.PlayerPause = this->Player->Pause;
+    snapshot.Shake = ShakeTime > 0.0f;
+    snapshot.Chaos = ChaosEffect;
     
-    Shader lineShader = ResourceManager::GetShader("line");
-    lineShader.Use();
-    lineShader.SetMatrix4("projection", projection);
+    snapshot.Projection = Camera->GetProjectionMatrix();
+    Camera->GetViewBounds(snapshot.ViewMin, snapshot.ViewMax);
+    glm::vec2 viewMin = snapshot.ViewMin;
+    glm::vec2 viewMax = snapshot.ViewMax;
     
-    Shader spriteBatchShader = ResourceManager::GetShader("sprite_batch");
-    spriteBatchShader.Use();
-    spriteBatchShader.SetMatrix4("projection", projection);
+    // 快照里的数组每次都会复用，clear 不会释放内存，按总数预留，只在世界变大时扩容
+    GLuint nodeCount = 0;
+    for (SnakeObject *snake : this->Snakes) {
+        nodeCount += static_cast<GLuint>(snake->Nodes.size());
+    }
+    ReserveReused(snapshot.Foods, FoodsMgr->Foods.size());
+    ReserveReused(snapshot.SnakeNodes, nodeCount);
+    ReserveReused(snapshot.SnakeOffsets, this->Snakes.size() + 1);
     
-    Shader spriteBatchGPUShader = ResourceManager::GetShader("sprite_batch_gpu");
-    spriteBatchGPUShader.Use();
-    spriteBatchGPUShader.SetMatrix4("projection", projection);
+    snapshot.Foods.clear();
+    for (GameObject &food : FoodsMgr->Foods) {
+        if (food.Destroyed ||
+            food.Position.x + food.Size.x < viewMin.x || food.Position.x > viewMax.x ||
+            food.Position.y + food.Size.y < viewMin.y || food.Position.y > viewMax.y) {
+            continue;
+        }
+        snapshot.Foods.push_back(food);
+    }
+    
+    snapshot.FoodCount = static_cast<GLuint>(FoodsMgr->Foods.size());
+    
+    snapshot.SnakeNodes.clear();
+    snapshot.SnakeOffsets.clear();
+    snapshot.NodeCount = nodeCount;
+    for (SnakeObject *snake : this->Snakes) {
+        if (snake->Died ||
+            snake->BoundsMax.x < viewMin.x || snake->BoundsMin.x > viewMax.x ||
+            snake->BoundsMax.y < viewMin.y || snake->BoundsMin.y > viewMax.y) {
+            continue;
+        }
+        snapshot.SnakeOffsets.push_back(static_cast<GLuint>(snapshot.SnakeNodes.size()));
+        snapshot.SnakeNodes.insert(snapshot.SnakeNodes.end(), snake->Nodes.begin(), snake->Nodes.end());
+    }
+    snapshot.SnakeOffsets.push_back(static_cast<GLuint>(snapshot.SnakeNodes.size()));
+    
+    const std::vector<Particle> &particles = Particles->GetParticles();
+    ReserveReused(snapshot.Particles, particles.size());
+    snapshot.Particles.assign(particles.begin(), particles.end());
+    
+    this->Snapshots.Publish();
 }
 
 void Game::Render()
 {
-    if (this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_WIN)// 底部游戏渲染
+    PROFILE_SCOPE("Game::Render");
+    MemoryTagScope tag(MEMORY_TAG_RENDER);
+    // GL 驱动在调用里可能自己分配内存，渲染帧只计数不断言
+    FrameAllocationCheck allocationCheck("Game::Render");
+    uint64_t renderStart = Profiler::Now();
+    // GPU 耗时按 pass 统计，几帧之后才读回
+    GPUProfiler::BeginFrame();
+    // 上传工作线程解码好的纹理，没加载完的纹理先画成透明的
+    Loader->Update(TEXTURE_UPLOADS_PER_FRAME);
+    // 切换到模拟线程最新发布的快照，渲染期间快照不会被修改
+    this->Snapshots.Update();
+    const RenderSnapshot &snapshot = this->Snapshots.Read();
+    
+    this->UploadProjection(snapshot.Projection);
+    // 没有经过后期处理的帧（比如失败画面）也画在输出区域里
+    glViewport(this->Viewport.x, this->Viewport.y, this->Viewport.z, this->Viewport.w);
+    Effects->RenderScale = this->RenderScale.Scale;
+    Effects->Shake = snapshot.Shake;
+    Effects->Chaos = snapshot.Chaos;
+    
+    if (snapshot.State == GAME_ACTIVE || snapshot.State == GAME_MENU || snapshot.State == GAME_WIN)// 底部游戏渲染
     {
         // Begin rendering to postprocessing quad
         Effects->BeginRender();
@@ -333,37 +616,55 @@ void Game::Render()
         GLfloat mapHeight = this->MapHeight;
         GLfloat gridSize = this->GridSize;
         
+        // 只绘制摄像机可见范围内的物体
+        glm::vec2 viewMin = snapshot.ViewMin;
+        glm::vec2 viewMax = snapshot.ViewMax;
+        
         // 绘制场景背景
+        GPUProfiler::BeginPass("Background");
         Texture2D sceneTexture = ResourceManager::GetEmptyTexture();
         SpriteRender->DrawSprite(sceneTexture, glm::vec2(-static_cast<float>(this->Width / 2.0), -static_cast<float>(this->Height / 2.0)), glm::vec2(mapWidth + this->Width, mapHeight + this->Height), glm::vec4(0.35f, 0.68f, 0.38f, 1.0f));
         
         // 绘制地图背景
         Texture2D bgTexture = ResourceManager::GetEmptyTexture();
         SpriteRender->DrawSprite(bgTexture, mapOrigin, glm::vec2(mapWidth, mapHeight), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        GPUProfiler::EndPass();
         
         // 绘制网格
-        for (GLuint row = 0; row < GRID_ROWS; row++) {
+        GPUProfiler::BeginPass("Grid");
+        GLuint firstRow = static_cast<GLuint>(glm::clamp((viewMin.y - mapOrigin.y) / gridSize, 0.0f, static_cast<GLfloat>(GRID_ROWS)));
+        GLuint lastRow = static_cast<GLuint>(glm::clamp((viewMax.y - mapOrigin.y) / gridSize + 1.0f, 0.0f, static_cast<GLfloat>(GRID_ROWS)));
+        GLuint firstCol = static_cast<GLuint>(glm::clamp((viewMin.x - mapOrigin.x) / gridSize, 0.0f, static_cast<GLfloat>(GRID_COLS)));
+        GLuint lastCol = static_cast<GLuint>(glm::clamp((viewMax.x - mapOrigin.x) / gridSize + 1.0f, 0.0f, static_cast<GLfloat>(GRID_COLS)));
+        for (GLuint row = firstRow; row < lastRow; row++) {
             LineRender->DrawLine(glm::vec2(mapOrigin.x, mapOrigin.y + gridSize * row), mapWidth, GL_TRUE, 0, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
         }
-        for (GLuint col = 0; col < GRID_COLS; col++) {
+        for (GLuint col = firstCol; col < lastCol; col++) {
             LineRender->DrawLine(glm::vec2(mapOrigin.x + gridSize * col, mapOrigin.y), mapHeight, GL_FALSE, 0, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
         }
+        GPUProfiler::EndPass();
         
         // 绘制食物
-        FoodsMgr->Draw(*SpriteRender);
+        GPUProfiler::BeginPass("Foods");
+        for (const GameObject &food : snapshot.Foods) {
+            Texture2D sprite = food.Sprite;
+            SpriteRender->DrawSprite(sprite, food.Position, food.Size, food.Color, food.Rotation, food.RotationQuat);
+        }
+        GPUProfiler::EndPass();
         
         // 绘制粒子
-        Particles->Draw();
-        
-        // 绘制蛇
-//        Snake->Draw(*SpriteRender);
-        
-        // 批量绘制
-//        Snake->BatchDraw(*SpriteBatchRender);
-        
-        // 批量绘制 - 基于GPU
-        Snake->BatchGPUDraw(*SpriteBatchGPURender);
+        GPUProfiler::BeginPass("Particles");
+        Particles->Draw(snapshot.Particles);
+        GPUProfiler::EndPass();
         
+        // 批量绘制 - 基于GPU，每条蛇一次
+        GPUProfiler::BeginPass("Snakes");
+        for (GLuint i = 0; i + 1 < snapshot.SnakeOffsets.size(); i++) {
+            GLuint begin = snapshot.SnakeOffsets[i];
+            GLuint end = snapshot.SnakeOffsets[i + 1];
+            SpriteBatchGPURender->DrawSprites(snapshot.SnakeNodes.data() + begin, end - begin);
+        }
+        GPUProfiler::EndPass();
         
         // End rendering to postprocessing quad
         Effects->EndRender();
@@ -371,24 +672,61 @@ void Game::Render()
         Effects->Render(glfwGetTime());
         
         /// 文本绘制
-        std::stringstream lives; lives << this->Lives;
-        Text->RenderText("Lives:" + lives.str(), 5.0f, 5.0f, 1.0f);
+        GPUProfiler::BeginPass("Text");
+        // 格式化到栈上的缓冲区，不用 stringstream 和 std::string 拼接，每帧不分配内存
+        char text[32];
+        snprintf(text, sizeof(text), "Lives:%u", snapshot.Lives);
+        Text->RenderText(text, 5.0f, 5.0f, 1.0f);
         
-        std::stringstream nodeLength; nodeLength << Snake->Nodes.size();
-        Text->RenderText("Score:" + nodeLength.str(), 150.0f, 5.0f, 1.0f);
+        snprintf(text, sizeof(text), "Score:%u", snapshot.Score);
+        Text->RenderText(text, 150.0f, 5.0f, 1.0f);
+        GPUProfiler::EndPass();
     }
     
-    if (this->State == GAME_ACTIVE && Snake->Pause)// 游戏中
+    if (snapshot.State == GAME_ACTIVE && snapshot.PlayerPause)// 游戏中
     {
         Text->RenderText("Press ENTER to reborn", 140.0f, this->Width / 2, 1.0f);
     }
     
-    if (this->State == GAME_MENU)// 菜单
+    if (snapshot.State == GAME_MENU)// 菜单
     {
         Text->RenderText("Press SPACE to start", 140.0f, this->Width / 2  - 40.0, 1.0f);
         Text->RenderText("Press W/S/A/D to control direction", 50.0f, this->Height / 2, 1.0f);
         Text->RenderText("Press + to speed up", 145.0f, this->Height / 2 + 40, 1.0f);
     }
+    
+    GPUProfiler::EndFrame();
+    
+    // 性能面板：每帧都记录，显示时才绘制，面板自己的绘制不计入下一帧的统计
+    GLfloat frameMilliseconds = this->LastRenderStart ? (renderStart - this->LastRenderStart) / 1e6f : 0.0f;
+    this->LastRenderStart = renderStart;
+    GLfloat cpuMilliseconds = (Profiler::Now() - renderStart) / 1e6f;
+    Hud->Record(frameMilliseconds, cpuMilliseconds);
+    // 下一帧的渲染比例
+#if PROFILER_ENABLED
+    // 只有 GPU 耗时随分辨率变化，它是几帧之前读回的，刚开始的几帧是 0
+    this->RenderScale.Update(static_cast<GLfloat>(GPUProfiler::LastFrameMilliseconds()));
+#else
+    // 没有 GPU 计时，用渲染的 CPU 耗时代替
+    this->RenderScale.Update(cpuMilliseconds);
+#endif
+    if (this->ShowPerfHud) {
+        PerfCounts counts;
+        counts.Particles = 0;
+        for (const Particle &particle : snapshot.Particles) {
+            if (particle.Life > 0.0f) {
+                counts.Particles++;
+            }
+        }
+        counts.Foods = snapshot.FoodCount;
+        counts.Nodes = snapshot.NodeCount;
+        counts.RenderScale = Effects->RenderScale;
+        counts.SceneWidth = Effects->SceneWidth;
+        counts.SceneHeight = Effects->SceneHeight;
+        Hud->Draw(*Text, counts);
+    }
+    RenderStats::Reset();
+    FrameArena::ThreadLocal().Reset();
 }
 
 // collision detection
@@ -397,50 +735,363 @@ GLboolean CheckCollision(GameObject &one, GameObject &two);// AABB 碰撞检测
 // 碰撞检测
 void Game::DoCollisions(float dt)
 {
-    // 磁吸食物
-    glm::vec2 snakePostion = glm::vec2(Snake->Position.x + Snake->NodeSize.x /2.0, Snake->Position.y + Snake->NodeSize.y /2.0);
-    for (GameObject &food : FoodsMgr->Foods) {
-        glm::vec2 foodPostion = glm::vec2(food.Position.x + food.Size.x /2.0, food.Position.y + food.Size.y /2.0);
-        GLfloat distance = glm::distance(snakePostion, foodPostion);
-        if (distance < 50) {
-            glm::vec2 moveDir = glm::normalize(snakePostion - foodPostion);
-            food.Position += moveDir * INITIAL_FOOD_MAGNET_VELOCITY * dt;
-        }
+    PROFILE_SCOPE("Game::DoCollisions");
+    // 这里的临时数组都在帧内存池里，函数返回时回收，不依赖调用方每帧 Reset
+    FrameArenaScope scope;
+    GLuint snakeCount = static_cast<GLuint>(this->Snakes.size());
+    
+    // 1. 给蛇头建立空间索引
+    // 蛇头这一帧从 PreviousCenters 扫到 HeadCenters，碰撞按扫过的胶囊体检测，
+    // 所以加速或者卡顿时一次移动很远也不会穿过食物和其他蛇，结果和每次更新的时间间隔无关
+    ReserveReused(HeadCenters, snakeCount);
+    ReserveReused(PreviousCenters, snakeCount);
+    HeadCenters.resize(snakeCount);
+    PreviousCenters.resize(snakeCount);
+    GLfloat maxSweep = 0.0f;
+    for (GLuint i = 0; i < snakeCount; i++) {
+        SnakeObject *snake = this->Snakes[i];
+        HeadCenters[i] = glm::vec2(snake->Position.x + snake->NodeSize.x /2.0, snake->Position.y + snake->NodeSize.y /2.0);
+        PreviousCenters[i] = snake->PreviousPosition + snake->NodeSize / 2.0f;
+        maxSweep = glm::max(maxSweep, glm::distance(PreviousCenters[i], HeadCenters[i]));
     }
+    HeadGrid.Build(HeadCenters);
     
-    // 蛇是否碰到了食物
-    for (GameObject &food : FoodsMgr->Foods) {
-        if (!food.Destroyed) {
-            GLboolean collision = CheckCollision(Snake->Nodes[0], food);
-            if (collision) {
-                Snake->EatFood(food.Position);
-                food.Destroyed = GL_TRUE;
+    // 2. 按食物所在的格子分段并行：每个格子里的食物作为一批，依次被附近的蛇磁吸，然后检测是否被吃掉
+    // 磁吸和扫掠检测在同一个批量 SIMD 函数里完成，食物中心点按 SoA 存放。
+    // 一个食物只会被一个任务处理，附近的蛇按下标顺序处理，同一个食物只会被前面的蛇吃掉，所以结果和线程数无关
+    // 每个食物记录吃掉它的蛇，食物只属于一个任务，所以不同任务不会写同一个位置
+    const SpatialGrid &foodGrid = FoodsMgr->Grid;
+    const GLuint cellsPerJob = 64;
+    const GLuint notEaten = ~0u;
+    FrameVector<GLuint> eatenBy(FoodsMgr->Foods.size(), notEaten);
+    // 蛇头索引按当前位置建立，查询范围要加上扫过的最大距离，才能找到从旁边扫过的蛇头
+    glm::vec2 queryRange(glm::max(INITIAL_FOOD_MAGNET_RANGE, maxSweep + 2.0f * this->GridSize));
+    GLfloat pullStep = INITIAL_FOOD_MAGNET_VELOCITY * dt;
+    Jobs->ParallelFor(foodGrid.CellCount(), cellsPerJob, [this, &foodGrid, &eatenBy, queryRange, pullStep](GLuint begin, GLuint end) {
+        PROFILE_SCOPE("Game::DoCollisions::Foods");
+        // 临时数组放在执行这个任务的线程的帧内存池里，任务结束就回收
+        FrameArenaScope scope;
+        FrameVector<GLuint> nearSnakes;
+        FrameVector<GLuint> foodIndices;
+        FrameVector<GLfloat> xs, ys, radii;
+        FrameVector<GLubyte> hits;
+        for (GLuint cell = begin; cell < end; cell++) {
+            // 收集格子里的食物
+            foodIndices.clear();
+            xs.clear();
+            ys.clear();
+            radii.clear();
+            glm::vec2 cellMin(FLT_MAX), cellMax(-FLT_MAX);
+            foodGrid.ForEachInCell(cell, [&](GLuint foodIndex) {
+                GameObject &food = FoodsMgr->Foods[foodIndex];
+                glm::vec2 foodPostion = food.Position + food.Size / 2.0f;
+                foodIndices.push_back(foodIndex);
+                xs.push_back(foodPostion.x);
+                ys.push_back(foodPostion.y);
+                radii.push_back(food.Size.x / 2.0f);
+                cellMin = glm::min(cellMin, foodPostion);
+                cellMax = glm::max(cellMax, foodPostion);
+            });
+            if (foodIndices.empty()) {
+                continue;
             }
+            nearSnakes.clear();
+            HeadGrid.Query(cellMin - queryRange, cellMax + queryRange, [&nearSnakes](GLuint snakeIndex) {
+                nearSnakes.push_back(snakeIndex);
+            });
+            if (nearSnakes.empty()) {
+                continue;
+            }
+            std::sort(nearSnakes.begin(), nearSnakes.end());
+            
+            GLuint count = static_cast<GLuint>(foodIndices.size());
+            hits.resize(count);
+            PointBatch batch;
+            batch.X = xs.data();
+            batch.Y = ys.data();
+            batch.Radius = radii.data();
+            batch.Count = count;
+            for (GLuint snakeIndex : nearSnakes) {
+                SnakeObject *snake = this->Snakes[snakeIndex];
+                // 蛇头从上一帧的位置扫到这一帧的位置，食物和蛇头的半径之和以内算吃到
+                SweptCircle head;
+                head.From = PreviousCenters[snakeIndex];
+                head.To = HeadCenters[snakeIndex];
+                head.Radius = snake->NodeSize.x / 2.0f;
+                PullAndSweep(head, INITIAL_FOOD_MAGNET_RANGE, pullStep, batch, hits.data());
+                if (snake->Died) {
+                    continue;
+                }
+                for (GLuint i = 0; i < count; i++) {
+                    GameObject &food = FoodsMgr->Foods[foodIndices[i]];
+                    if (hits[i] && !food.Destroyed) {
+                        food.Destroyed = GL_TRUE;
+                        eatenBy[foodIndices[i]] = snakeIndex;
+                    }
+                }
+            }
+            // 把磁吸后的中心点写回食物
+            for (GLuint i = 0; i < count; i++) {
+                GameObject &food = FoodsMgr->Foods[foodIndices[i]];
+                food.Position = glm::vec2(xs[i], ys[i]) - food.Size / 2.0f;
+            }
+        }
+    });
+    
+    // 3. 按蛇和食物的顺序让蛇变长，蛇变长会修改节点数组，只能在一个线程里做
+    FrameVector<EatEvent> allEvents;
+    for (GLuint food = 0; food < eatenBy.size(); food++) {
+        if (eatenBy[food] != notEaten) {
+            EatEvent event;
+            event.Snake = eatenBy[food];
+            event.Food = food;
+            allEvents.push_back(event);
+        }
+    }
+    std::sort(allEvents.begin(), allEvents.end(), [](const EatEvent &a, const EatEvent &b) {
+        return a.Snake != b.Snake ? a.Snake < b.Snake : a.Food < b.Food;
+    });
+    {
+        // 蛇变长是偶发事件，节点数组扩容不算意外分配
+        AllowAllocationScope allow;
+        for (EatEvent &event : allEvents) {
+            this->Snakes[event.Snake]->EatFood(FoodsMgr->Foods[event.Food].Position);
         }
     }
     
-    // 蛇是否有撞墙
-    if (Snake->Position.x < this->MapOrigin.x ||
-        Snake->Position.y < this->MapOrigin.y ||
-        Snake->Position.x + Snake->NodeSize.x > (this->MapOrigin.x + this->MapWidth) ||
-        Snake->Position.y + Snake->NodeSize.y > (this->MapOrigin.y + this->MapHeight)) {
-        Snake->Die();
+    // 4. 给所有移动中的蛇的节点建立空间索引，每帧用计数排序重建
+    GLuint nodeCount = 0;
+    for (SnakeObject *snake : this->Snakes) {
+        nodeCount += static_cast<GLuint>(snake->Nodes.size());
+    }
+    ReserveReused(SegmentRefs, nodeCount);
+    ReserveReused(SegmentCenters, nodeCount);
+    SegmentRefs.clear();
+    SegmentCenters.clear();
+    for (GLuint i = 0; i < snakeCount; i++) {
+        SnakeObject *snake = this->Snakes[i];
+        if (snake->Pause) {
+            continue;
+        }
+        for (GLuint j = 0; j < snake->Nodes.size(); j++) {
+            SegmentRef ref;
+            ref.Snake = i;
+            ref.Node = j;
+            SegmentRefs.push_back(ref);
+            SegmentCenters.push_back(snake->Nodes[j].Position + snake->NodeSize / 2.0f);
+        }
+    }
+    SegmentGrid.Build(SegmentCenters);
+    
+    // 5. 蛇是否有撞墙，蛇头是否撞到了其他蛇或者自己的身体，按蛇分段并行
+    // 每个蛇头只检查附近格子里的节点，和蛇的长度无关
+    // 先记录结果再统一处理，这样结果和蛇的顺序无关
+    FrameVector<GLboolean> crashed(snakeCount, GL_FALSE);
+    Jobs->ParallelFor(snakeCount, 16, [this, &crashed](GLuint begin, GLuint end) {
+        FrameArenaScope scope;
+        FrameVector<GLfloat> xs, ys, radii;
+        FrameVector<GLubyte> hits;
+        for (GLuint i = begin; i < end; i++) {
+            SnakeObject *snake = this->Snakes[i];
+            if (snake->Position.x < this->MapOrigin.x ||
+                snake->Position.y < this->MapOrigin.y ||
+                snake->Position.x + snake->NodeSize.x > (this->MapOrigin.x + this->MapWidth) ||
+                snake->Position.y + snake->NodeSize.y > (this->MapOrigin.y + this->MapHeight)) {
+                crashed[i] = GL_TRUE;
+            }
+            if (snake->Pause || crashed[i]) {
+                continue;
+            }
+            // 收集蛇头附近的节点和各自的碰撞半径，然后一次批量检测
+            SweptCircle head;
+            head.From = PreviousCenters[i];
+            head.To = HeadCenters[i];
+            head.Radius = 0.0f;
+            // 身体会跟着蛇头走过刚刚扫过的路径，这段路径上的节点也要跳过
+            GLuint neckNodes = SNAKE_NECK_NODES + static_cast<GLuint>(glm::ceil(glm::distance(head.From, head.To) / snake->NodeSize.x));
+            xs.clear();
+            ys.clear();
+            radii.clear();
+            // 节点中心离蛇头扫过的线段超过一个节点大小就不可能相交
+            SegmentGrid.Query(glm::min(head.From, head.To) - snake->NodeSize, glm::max(head.From, head.To) + snake->NodeSize, [&](GLuint index) {
+                const SegmentRef &ref = SegmentRefs[index];
+                if (ref.Snake != i) {
+                    radii.push_back((snake->NodeSize.x + this->Snakes[ref.Snake]->NodeSize.x) / 2.0f);
+                } else if (ref.Node >= neckNodes) {
+                    // 相邻节点本来就贴在一起，自身碰撞用更小的半径，并且跳过脖子
+                    radii.push_back(snake->NodeSize.x * 0.75f);
+                } else {
+                    return;
+                }
+                xs.push_back(SegmentCenters[index].x);
+                ys.push_back(SegmentCenters[index].y);
+            });
+            hits.resize(xs.size());
+            PointBatch batch;
+            batch.X = xs.data();
+            batch.Y = ys.data();
+            batch.Radius = radii.data();
+            batch.Count = static_cast<GLuint>(xs.size());
+            crashed[i] = SweepTest(head, batch, hits.data()) > 0;
+        }
+    });
+    for (GLuint i = 0; i < snakeCount; i++) {
+        if (crashed[i]) {
+            this->Snakes[i]->Die();
+        }
     }
 }
 
 void Game::ResetLevel()
 {
     this->Lives = 3;
-    Snake->Reset(glm::vec2(this->MapOrigin.x + this->MapWidth / 2.0, this->MapOrigin.y + this->MapHeight / 2.0), INITIAL_SNAKE_DIRECTION * INITIAL_SNAKE_VELOCITY);
-    Snake->Restart();
-    Snake->Pause = GL_TRUE;
+    this->Player->Reset(glm::vec2(this->MapOrigin.x + this->MapWidth / 2.0, this->MapOrigin.y + this->MapHeight / 2.0), INITIAL_SNAKE_DIRECTION * INITIAL_SNAKE_VELOCITY);
+    this->Player->Restart();
+    this->Player->Pause = GL_TRUE;
+    
+    // 重新生成所有 AI 蛇
+    while (this->Snakes.size() > 1) {
+        this->DespawnSnake(static_cast<GLuint>(this->Snakes.size() - 1));
+    }
+    for (GLuint i = 0; i < this->Config.BotCount; i++) {
+        this->SpawnBot();
+    }
 }
 
 void Game::ResetPlayer()
 {
-    Snake->Reset(glm::vec2(this->MapOrigin.x + this->MapWidth / 2.0, this->MapOrigin.y + this->MapHeight / 2.0), INITIAL_SNAKE_DIRECTION * INITIAL_SNAKE_VELOCITY);
-    Snake->Reborn();
-    Snake->Pause = GL_TRUE;
+    this->Player->Reset(glm::vec2(this->MapOrigin.x + this->MapWidth / 2.0, this->MapOrigin.y + this->MapHeight / 2.0), INITIAL_SNAKE_DIRECTION * INITIAL_SNAKE_VELOCITY);
+    this->Player->Reborn();
+    this->Player->Pause = GL_TRUE;
+}
+
+void Game::SpawnBot()
+{
+    // 随机皮肤
+    const std::vector<Texture2D> &sprites = SkinSprites[this->Random.Below(SNAKE_SKIN_COUNT)];
+    
+    // 出生点离墙至少一个蛇身的距离，保证身体在地图里面
+    glm::vec2 nodeSize(24, 24);
+    GLfloat margin = glm::min(this->Config.BotLength * nodeSize.x + this->GridSize, glm::min(this->MapWidth, this->MapHeight) / 4.0f);
+    glm::vec2 spawnMin = this->MapOrigin + margin;
+    glm::vec2 spawnMax = this->MapOrigin + glm::vec2(this->MapWidth, this->MapHeight) - margin;
+    // 在空闲格子里选出生点，选到离墙太近的格子就重新选，几次都不行再在范围内随便选
+    GLfloat x = 0.0f, y = 0.0f;
+    GLboolean found = GL_FALSE;
+    GLuint cell;
+    for (GLuint i = 0; i < 8 && !found && Occupancy.RandomFreeCell(this->Random.Next(), cell); i++) {
+        glm::vec2 position = Occupancy.CellPosition(cell);
+        if (position.x >= spawnMin.x && position.y >= spawnMin.y && position.x <= spawnMax.x && position.y <= spawnMax.y) {
+            x = position.x;
+            y = position.y;
+            found = GL_TRUE;
+        }
+    }
+    if (!found) {
+        x = spawnMin.x + this->Random.Float(0.0f, spawnMax.x - spawnMin.x);
+        y = spawnMin.y + this->Random.Float(0.0f, spawnMax.y - spawnMin.y);
+    }
+    
+    // 随机上下左右一个方向
+    const glm::vec2 directions[4] = { glm::vec2(0.0f, -1.0f), glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec2(-1.0f, 0.0f) };
+    glm::vec2 direction = directions[this->Random.Below(4)];
+    
+    SnakeObject *bot = new SnakeObject(glm::vec2(x, y), nodeSize, this->Config.BotLength, sprites, 90, direction * INITIAL_SNAKE_VELOCITY, glm::vec4(0.0f, 1.0f, -1.0f, 1.0f));
+    bot->Controller = new BotController(this->BotRandom.Split());
+    bot->Pause = this->State != GAME_ACTIVE;
+    this->Snakes.push_back(bot);
+    this->SyncOccupancy(*bot);
+}
+
+void Game::DespawnSnake(GLuint index)
+{
+    SnakeObject *snake = this->Snakes[index];
+    if (snake == this->Player) {
+        this->Player = nullptr;
+    }
+    for (const glm::vec2 &position : snake->OccupiedPositions) {
+        Occupancy.Remove(position, snake->NodeSize);
+    }
+    // 保持顺序，碰撞处理依赖蛇的顺序
+    this->Snakes.erase(this->Snakes.begin() + index);
+    delete snake->Controller;
+    delete snake;
+}
+
+void Game::SyncOccupancy(SnakeObject &snake)
+{
+    // 节点数可能变了（吃了食物、复活），多出来的节点登记，少了的节点移除
+    std::vector<glm::vec2> &occupied = snake.OccupiedPositions;
+    GLuint nodeCount = static_cast<GLuint>(snake.Nodes.size());
+    GLuint occupiedCount = static_cast<GLuint>(occupied.size());
+    ReserveReused(occupied, nodeCount);
+    for (GLuint i = 0; i < nodeCount && i < occupiedCount; i++) {
+        Occupancy.Move(occupied[i], snake.Nodes[i].Position, snake.NodeSize);
+        occupied[i] = snake.Nodes[i].Position;
+    }
+    for (GLuint i = occupiedCount; i < nodeCount; i++) {
+        Occupancy.Add(snake.Nodes[i].Position, snake.NodeSize);
+        occupied.push_back(snake.Nodes[i].Position);
+    }
+    for (GLuint i = nodeCount; i < occupiedCount; i++) {
+        Occupancy.Remove(occupied[i], snake.NodeSize);
+    }
+    occupied.resize(nodeCount);
+}
+
+void Game::DropFoods(SnakeObject &snake)
+{
+    // 掉落的食物不会被补充，限制一下数量，避免食物越来越多
+    if (FoodsMgr->Foods.size() >= FoodsMgr->MaxFoods * 2) {
+        return;
+    }
+    for (GLuint i = 0; i < snake.Nodes.size(); i += 2) {
+        FoodsMgr->SpawnFoodAt(snake.Nodes[i].Position, snake.NodeSize);
+    }
+}
+
+ArenaView Game::GetArenaView()
+{
+    ArenaView arena;
+    arena.MapOrigin = this->MapOrigin;
+    arena.MapSize = glm::vec2(this->MapWidth, this->MapHeight);
+    arena.Foods = FoodsMgr;
+    return arena;
+}
+
+// FNV-1a 哈希
+static void HashBytes(GLuint &hash, const void *data, size_t size)
+{
+    const GLubyte *bytes = static_cast<const GLubyte *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+}
+
+GLuint Game::StateHash() const
+{
+    GLuint hash = 2166136261u;
+    HashBytes(hash, &this->State, sizeof(this->State));
+    HashBytes(hash, &this->Lives, sizeof(this->Lives));
+    // 随机数流的状态也是游戏状态，多用或少用一个随机数都能被发现
+    HashBytes(hash, this->Random.State, sizeof(this->Random.State));
+    HashBytes(hash, this->BotRandom.State, sizeof(this->BotRandom.State));
+    HashBytes(hash, FoodsMgr->Random.State, sizeof(FoodsMgr->Random.State));
+    for (const SnakeObject *snake : this->Snakes) {
+        HashBytes(hash, &snake->Position, sizeof(snake->Position));
+        HashBytes(hash, &snake->Velocity, sizeof(snake->Velocity));
+        HashBytes(hash, &snake->Died, sizeof(snake->Died));
+        GLuint nodeCount = static_cast<GLuint>(snake->Nodes.size());
+        HashBytes(hash, &nodeCount, sizeof(nodeCount));
+        for (const GameObject &node : snake->Nodes) {
+            HashBytes(hash, &node.Position, sizeof(node.Position));
+        }
+    }
+    for (const GameObject &food : FoodsMgr->Foods) {
+        HashBytes(hash, &food.Position, sizeof(food.Position));
+        HashBytes(hash, &food.Destroyed, sizeof(food.Destroyed));
+    }
+    return hash;
 }
 
 /// AABB 碰撞检测
@@ -459,13 +1110,13 @@ GLboolean CheckCollision(GameObject &one, GameObject &two) // AABB - AABB collis
     return collisionX && collisionY;
 }
 
-void LoadTextures(GLuint count, std::string filePrefix)
+void LoadTextures(AssetLoader &loader, GLuint count, std::string filePrefix)
 {
     for (GLuint i = 0; i < count; i++) {
         std::stringstream str, name;
         str << filePrefix << "_" << i << ".png";
         name << filePrefix << "_" << i;
-        ResourceManager::LoadTexture(str.str().c_str(), GL_TRUE, name.str());
+        loader.LoadTexture(str.str().c_str(), name.str());
     }
 }
 
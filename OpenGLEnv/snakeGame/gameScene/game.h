@@ -9,17 +9,23 @@
 #define SANKE_GAME_H
 
 #include <tuple>
+#include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "game_object.h"
+#include "snake_object.h"
+#include "snake_controller.h"
+#include "arena_config.h"
+#include "render_snapshot.h"
+#include "triple_buffer.h"
+#include "input_queue.h"
+#include "random_stream.h"
+#include "post_processor.h"
+#include "render_scale_controller.h"
 
-// 代表了游戏的当前状态
-enum GameState {
-    GAME_ACTIVE,
-    GAME_MENU,
-    GAME_WIN
-};
+class ReplayRecorder;
+class SimulationBenchmark;
 
 // Represents the four possible (collision) directions - 碰撞方向
 enum Direction {
@@ -32,13 +38,24 @@ enum Direction {
 class Game
 {
     private:
+        // 基准测试直接测量私有的碰撞检测
+        friend class SimulationBenchmark;
+        
         glm::vec2   MapOrigin;// 游戏场景位置
         GLfloat     MapWidth;// 游戏场景宽度
         GLfloat     MapHeight;// 游戏场景高度
         GLuint      GridSize;// 格子大小
     
+        // 根据配置设置地图大小
+        void SetupMap();
+        // 加载着色器、纹理，创建渲染对象
+        void InitRenderer();
         // 更新摄像机
         void UpdateCamera();
+        // 把投影矩阵上传到所有着色器（渲染线程）
+        void UploadProjection(const glm::mat4 &projection);
+        // 生成渲染快照并发布给渲染线程（模拟线程）
+        void PublishSnapshot();
         // 碰撞检测
         void DoCollisions(float dt);
         // 生成道具
@@ -48,15 +65,50 @@ class Game
         // 重置游戏
         void ResetLevel();
         void ResetPlayer();
+        // 生成和移除 AI 蛇
+        void SpawnBot();
+        void DespawnSnake(GLuint index);
+        // 把蛇节点的最新位置同步到占用网格
+        void SyncOccupancy(SnakeObject &snake);
+        // 蛇死亡后身体变成食物
+        void DropFoods(SnakeObject &snake);
+        // 控制器能看到的竞技场状态
+        ArenaView GetArenaView();
+        // 把输入事件应用到按键状态
+        void ApplyInput(const InputEvent &event);
+        // 在同一次更新里按下又释放的按键，处理完输入后再释放，保证至少被看到一次
+        void ApplyPendingReleases();
+        GLuint     KeysPressedTick[1024];// 按键最近一次按下时的更新次数
+        GLboolean  KeysReleasePending[1024];// 按键等待释放
+        GLuint     MouseKeysPressedTick[8];
+        GLboolean  MouseKeysReleasePending[8];
+        uint64_t   LastRenderStart;// 上一帧开始渲染的时间（Profiler::Now），用来计算帧间隔
     public:
         // 游戏状态
         GameState  State;
+        InputQueue Input;// 窗口线程放入的输入事件
+        // 以下按键状态只在模拟线程里访问，由 ProcessInput 根据输入事件更新
         GLboolean  Keys[1024];// 外部输入的按键数组，按下就是 true，释放就是 false
         GLboolean  KeysProcessed[1024];// 外部输入的按键数组，记录按键是否又被处理
         GLboolean  MouseKeys[8];// 外部输入的鼠标按钮数组，按下就是 true，释放就是 false
         glm::vec2  MousePositions[8];// 外部输入的鼠标所在位置数组
-        GLuint     Width, Height;// 游戏窗口宽高
+        GLuint     Tick;// 已经更新的次数
+        GLuint     Seed;// 随机数种子，需要在 Init 之前设置
+        RandomStream Random;// 游戏逻辑的随机数流（AI 蛇出生点、皮肤、方向）
+        RandomStream BotRandom;// 每条 AI 蛇的随机数流都从这里分出
+        GLboolean  Headless;// 只做模拟，不加载任何渲染资源（回放）
+        GLboolean  ShowPerfHud;// 显示性能面板，渲染线程读写
+        AntiAliasing AA;// 抗锯齿方式，需要在 Init 之前设置，创建窗口时的采样数也要按它设置
+        ReplayRecorder *Recorder;// 录制输入，不为空时每次更新都会记录，不负责释放
+        GLuint     Width, Height;// 游戏的逻辑宽高，决定地图大小和视野，窗口大小变化时不变
+        GLuint     FramebufferWidth, FramebufferHeight;// 默认帧缓冲的像素尺寸，HiDPI 下比窗口大，渲染线程读写
+        glm::ivec4 Viewport;// 画面在默认帧缓冲里的区域（x, y, 宽, 高），保持 Width:Height 的比例，其余留黑边
+        RenderScaleController RenderScale;// 动态分辨率，按帧耗时调整场景的渲染比例，渲染线程读写
         GLuint     Lives;// 玩家生命值
+        ArenaConfig Config;// 竞技场配置
+        std::vector<SnakeObject *> Snakes;// 所有的蛇，第一条是玩家
+        SnakeObject *Player;// 玩家的蛇
+        TripleBuffer<RenderSnapshot> Snapshots;// 模拟线程发布、渲染线程读取的渲染快照
 //        std::vector<GameLevel>  Levels;// 关卡数组
         unsigned int            Level;// 当前关卡
 //        std::vector<PowerUp>  PowerUps;// 道具
@@ -64,13 +116,21 @@ class Game
         Game(GLuint width, GLuint height);
         ~Game();
         // 初始化游戏状态（加载所有的着色器/纹理/关卡）
-        void Init();
-        // 根据按键输入更新位移
-        void ProcessInput(GLfloat dt);
-        // 根据时间更新位置
+        // headless 为 true 时只初始化模拟需要的状态，不需要 OpenGL 上下文，之后不能调用 Render
+        void Init(GLboolean headless = GL_FALSE);
+        // 处理发生在 tickTime 之前的输入事件，然后根据按键更新方向
+        // now 是调用方的当前时间，只用来统计输入延迟，游戏本身不读取时钟（回放时没有初始化 GLFW）
+        void ProcessInput(GLfloat dt, GLdouble tickTime, GLdouble now);
+        // 根据时间更新位置，结束时发布渲染快照，不调用任何 OpenGL 函数，可以在模拟线程里执行
         void Update(GLfloat dt);
-        // 渲染画面
+        // 渲染最新的渲染快照，需要在 OpenGL 线程里执行
         void Render();
+        // 默认帧缓冲的尺寸变化（窗口缩放、HiDPI），需要在 OpenGL 线程里执行，可以在 Init 之前调用
+        void Resize(GLuint framebufferWidth, GLuint framebufferHeight);
+        // 帧缓冲像素坐标（左上角为原点）换算成逻辑坐标
+        glm::vec2 FramebufferToView(glm::vec2 position) const;
+        // 当前游戏状态的哈希，用于回放校验
+        GLuint StateHash() const;
 };
 
 #endif /* sanke_game_hpp */
@@ -0,0 +1,104 @@
+//
+//  input_queue.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/22.
+//
+
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <atomic>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "spsc_ring.h"
+
+// 输入事件类型
+enum InputType {
+    INPUT_KEY,
+    INPUT_MOUSE_BUTTON
+};
+
+// 输入事件动作
+enum InputAction {
+    INPUT_PRESS,
+    INPUT_RELEASE
+};
+
+// 带时间戳的输入事件，由窗口线程产生，模拟线程消费
+struct InputEvent {
+    GLdouble    Time;// 事件发生的时间（glfwGetTime）
+    GLint       Type;// InputType
+    GLint       Action;// InputAction
+    GLint       Code;// 按键或者鼠标按钮
+    glm::vec2   Position;// 鼠标位置，只有鼠标事件有效
+    
+    InputEvent() : Time(0.0), Type(INPUT_KEY), Action(INPUT_PRESS), Code(0), Position(0.0f) { }
+};
+
+// 输入延迟统计：从事件发生到被模拟线程处理的时间
+// 模拟线程记录，窗口线程读取并清零，所以都用原子变量
+struct InputLatencyStats {
+    std::atomic<GLuint>     Count;// 处理的事件数
+    std::atomic<GLuint>     Dropped;// 队列满了丢掉的事件数
+    std::atomic<GLuint64>   TotalMicroseconds;// 总延迟（微秒）
+    std::atomic<GLuint64>   MaxMicroseconds;// 最大延迟（微秒）
+    
+    InputLatencyStats() : Count(0), Dropped(0), TotalMicroseconds(0), MaxMicroseconds(0) { }
+    
+    void Record(GLdouble latency)
+    {
+        GLuint64 microseconds = latency > 0.0 ? static_cast<GLuint64>(latency * 1000000.0) : 0;
+        this->Count.fetch_add(1, std::memory_order_relaxed);
+        this->TotalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+        GLuint64 max = this->MaxMicroseconds.load(std::memory_order_relaxed);
+        while (microseconds > max && !this->MaxMicroseconds.compare_exchange_weak(max, microseconds, std::memory_order_relaxed)) {
+        }
+    }
+    
+    // 取出上一次取出以来的平均和最大延迟（毫秒），然后清零
+    GLuint Collect(GLdouble &meanMs, GLdouble &maxMs)
+    {
+        GLuint count = this->Count.exchange(0, std::memory_order_relaxed);
+        GLuint64 total = this->TotalMicroseconds.exchange(0, std::memory_order_relaxed);
+        GLuint64 max = this->MaxMicroseconds.exchange(0, std::memory_order_relaxed);
+        meanMs = count > 0 ? total / 1000.0 / count : 0.0;
+        maxMs = max / 1000.0;
+        return count;
+    }
+};
+
+// 输入队列，窗口线程 Push，模拟线程 Consume
+class InputQueue
+{
+public:
+    InputLatencyStats Stats;
+    
+    // 窗口线程：放入一个事件，队列满了就丢掉并计数
+    void Push(const InputEvent &event)
+    {
+        if (!this->Events.TryPush(event)) {
+            this->Stats.Dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    // 模拟线程：按顺序处理所有发生在 tickTime 之前的事件，之后的事件留到下一次更新
+    // now 是处理的时间，用于统计延迟
+    template <typename Func>
+    void Consume(GLdouble tickTime, GLdouble now, Func func)
+    {
+        InputEvent event;
+        while (this->Events.Peek(event) && event.Time <= tickTime) {
+            this->Events.Pop();
+            this->Stats.Record(now - event.Time);
+            func(event);
+        }
+    }
+    
+private:
+    SPSCRing<InputEvent, 256> Events;
+};
+
+#endif /* input_queue_h */
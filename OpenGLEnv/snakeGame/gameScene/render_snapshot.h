@@ -0,0 +1,55 @@
+//
+//  render_snapshot.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/21.
+//
+
+#ifndef RENDER_SNAPSHOT_H
+#define RENDER_SNAPSHOT_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "game_object.h"
+#include "particle_generator.h"
+
+// 代表了游戏的当前状态
+enum GameState {
+    GAME_ACTIVE,
+    GAME_MENU,
+    GAME_WIN
+};
+
+// 渲染一帧需要的全部数据，由模拟线程在每次更新后生成，渲染线程只读
+// 只保存摄像机可见范围内的食物和蛇
+struct RenderSnapshot {
+    // HUD
+    GameState   State;// 游戏状态
+    GLuint      Lives;// 玩家生命值
+    GLuint      Score;// 玩家得分（蛇的长度）
+    GLboolean   PlayerPause;// 玩家是否在等待复活
+    
+    // 特效
+    GLboolean   Shake;// 抖动
+    GLboolean   Chaos;// 混乱
+    
+    // 摄像机
+    glm::mat4   Projection;// 投影矩阵
+    glm::vec2   ViewMin, ViewMax;// 可见范围
+    
+    std::vector<GameObject> Foods;// 可见的食物
+    std::vector<GameObject> SnakeNodes;// 可见的蛇的节点，按蛇的顺序排列
+    std::vector<GLuint>     SnakeOffsets;// 每条蛇在 SnakeNodes 里的起始位置，最后一个是节点总数
+    std::vector<Particle>   Particles;// 粒子
+    
+    // 性能面板
+    GLuint      FoodCount;// 所有食物数量
+    GLuint      NodeCount;// 所有蛇的节点数量
+    
+    RenderSnapshot() : State(GAME_MENU), Lives(0), Score(0), PlayerPause(GL_FALSE), Shake(GL_FALSE), Chaos(GL_FALSE), Projection(1.0f), ViewMin(0.0f), ViewMax(0.0f), FoodCount(0), NodeCount(0) { }
+};
+
+#endif /* render_snapshot_h */
@@ -0,0 +1,308 @@
+//
+//  replay.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/23.
+//
+
+#include "replay.h"
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include "game.h"
+
+static const char   REPLAY_MAGIC[4] = { 'S', 'N', 'K', 'R' };
+static const GLuint REPLAY_VERSION = 2;
+
+ReplayRecorder::ReplayRecorder() : LastTick(0)
+{
+
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+    if (this->Stream.is_open()) {
+        this->Stream.close();
+    }
+}
+
+GLboolean ReplayRecorder::Open(const std::string &path, const ReplayHeader &header)
+{
+    this->Stream.open(path, std::ios::binary | std::ios::trunc);
+    if (!this->Stream.is_open()) {
+        std::cout << "ERROR::REPLAY: Failed to open " << path << std::endl;
+        return GL_FALSE;
+    }
+    this->Header = header;
+    this->LastTick = 0;
+
+    this->Stream.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    this->WriteVarint(REPLAY_VERSION);
+    this->WriteVarint(header.Seed);
+    this->WriteVarint(header.Width);
+    this->WriteVarint(header.Height);
+    this->WriteVarint(header.Config.MapScale);
+    this->WriteVarint(header.Config.FoodCount);
+    this->WriteVarint(header.Config.BotCount);
+    this->WriteVarint(header.Config.PlayerLength);
+    this->WriteVarint(header.Config.BotLength);
+    this->WriteFloat(header.TickRate);
+    this->WriteVarint(header.HashInterval);
+    return GL_TRUE;
+}
+
+void ReplayRecorder::RecordInput(GLuint tick, const InputEvent &event)
+{
+    if (!this->Stream.is_open()) {
+        return;
+    }
+    this->WriteRecordHead(tick, REPLAY_INPUT);
+    this->WriteByte(static_cast<GLubyte>(event.Type << 1 | event.Action));
+    this->WriteVarint(static_cast<GLuint>(event.Code));
+    if (event.Type == INPUT_MOUSE_BUTTON && event.Action == INPUT_PRESS) {
+        this->WriteFloat(event.Position.x);
+        this->WriteFloat(event.Position.y);
+    }
+}
+
+GLboolean ReplayRecorder::WantsHash(GLuint tick) const
+{
+    return this->Stream.is_open() && this->Header.HashInterval > 0 && tick % this->Header.HashInterval == 0;
+}
+
+void ReplayRecorder::RecordHash(GLuint tick, GLuint hash)
+{
+    if (!this->Stream.is_open()) {
+        return;
+    }
+    this->WriteRecordHead(tick, REPLAY_HASH);
+    this->WriteUint32(hash);
+}
+
+void ReplayRecorder::Close(GLuint tickCount)
+{
+    if (!this->Stream.is_open()) {
+        return;
+    }
+    this->WriteRecordHead(tickCount, REPLAY_END);
+    this->Stream.close();
+}
+
+void ReplayRecorder::WriteRecordHead(GLuint tick, ReplayRecordType type)
+{
+    // 记录按更新次数递增，只保存和上一条记录的差值，大部分记录只需要 1 个字节
+    this->WriteVarint(tick - this->LastTick);
+    this->WriteByte(static_cast<GLubyte>(type));
+    this->LastTick = tick;
+}
+
+void ReplayRecorder::WriteVarint(GLuint value)
+{
+    // 每个字节保存 7 位，最高位表示后面还有字节
+    while (value >= 0x80) {
+        this->WriteByte(static_cast<GLubyte>(value | 0x80));
+        value >>= 7;
+    }
+    this->WriteByte(static_cast<GLubyte>(value));
+}
+
+void ReplayRecorder::WriteByte(GLubyte value)
+{
+    this->Stream.put(static_cast<char>(value));
+}
+
+void ReplayRecorder::WriteFloat(GLfloat value)
+{
+    GLuint bits;
+    memcpy(&bits, &value, sizeof(bits));
+    this->WriteUint32(bits);
+}
+
+void ReplayRecorder::WriteUint32(GLuint value)
+{
+    for (GLuint i = 0; i < 4; i++) {
+        this->WriteByte(static_cast<GLubyte>(value >> (i * 8)));
+    }
+}
+
+ReplayPlayer::ReplayPlayer() : TickCount(0), HashChecks(0), MismatchTick(-1), Cursor(0), RecordsStart(0), LastTick(0)
+{
+
+}
+
+GLboolean ReplayPlayer::Open(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "ERROR::REPLAY: Failed to open " << path << std::endl;
+        return GL_FALSE;
+    }
+    this->Data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    this->Cursor = 0;
+
+    GLuint version = 0;
+    if (this->Data.size() < sizeof(REPLAY_MAGIC) || memcmp(this->Data.data(), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+        std::cout << "ERROR::REPLAY: Not a replay file " << path << std::endl;
+        return GL_FALSE;
+    }
+    this->Cursor = sizeof(REPLAY_MAGIC);
+    ReplayHeader &header = this->Header;
+    if (!this->ReadVarint(version) || version != REPLAY_VERSION ||
+        !this->ReadVarint(header.Seed) ||
+        !this->ReadVarint(header.Width) || !this->ReadVarint(header.Height) ||
+        !this->ReadVarint(header.Config.MapScale) || !this->ReadVarint(header.Config.FoodCount) ||
+        !this->ReadVarint(header.Config.BotCount) || !this->ReadVarint(header.Config.PlayerLength) ||
+        !this->ReadVarint(header.Config.BotLength) ||
+        !this->ReadFloat(header.TickRate) || !this->ReadVarint(header.HashInterval)) {
+        std::cout << "ERROR::REPLAY: Unsupported or corrupted header " << path << std::endl;
+        return GL_FALSE;
+    }
+    this->RecordsStart = this->Cursor;
+    return GL_TRUE;
+}
+
+GLboolean ReplayPlayer::Play(Game &game)
+{
+    this->Cursor = this->RecordsStart;
+    this->LastTick = 0;
+    this->TickCount = 0;
+    this->HashChecks = 0;
+    this->MismatchTick = -1;
+
+    // 和录制时一样的初始状态
+    game.Width = this->Header.Width;
+    game.Height = this->Header.Height;
+    game.Config.MapScale = this->Header.Config.MapScale;
+    game.Config.FoodCount = this->Header.Config.FoodCount;
+    game.Config.BotCount = this->Header.Config.BotCount;
+    game.Config.PlayerLength = this->Header.Config.PlayerLength;
+    game.Config.BotLength = this->Header.Config.BotLength;
+    game.Seed = this->Header.Seed;
+    game.Init(GL_TRUE);
+
+    GLuint tick;
+    ReplayRecordType type;
+    if (!this->ReadRecordHead(tick, type)) {
+        return GL_FALSE;
+    }
+    for (;;) {
+        // 1. 这次更新处理的输入事件，时间戳就用更新次数
+        while (type == REPLAY_INPUT && tick == game.Tick) {
+            GLubyte typeAndAction;
+            GLuint code;
+            InputEvent event;
+            if (!this->ReadByte(typeAndAction) || !this->ReadVarint(code)) {
+                return GL_FALSE;
+            }
+            event.Time = tick;
+            event.Type = typeAndAction >> 1;
+            event.Action = typeAndAction & 1;
+            event.Code = static_cast<GLint>(code);
+            if (event.Type == INPUT_MOUSE_BUTTON && event.Action == INPUT_PRESS &&
+                (!this->ReadFloat(event.Position.x) || !this->ReadFloat(event.Position.y))) {
+                return GL_FALSE;
+            }
+            game.Input.Push(event);
+            if (!this->ReadRecordHead(tick, type)) {
+                return GL_FALSE;
+            }
+        }
+
+        if (type == REPLAY_END && tick <= game.Tick) {
+            break;
+        }
+        // 记录的更新次数不会比当前的小，否则文件是坏的
+        if (tick < game.Tick) {
+            std::cout << "ERROR::REPLAY: Records out of order at tick " << tick << std::endl;
+            return GL_FALSE;
+        }
+
+        // 2. 更新
+        GLuint currentTick = game.Tick;
+        // 回放的事件时间就是更新次数，按记录的时刻处理，延迟统计为 0
+        game.ProcessInput(this->Header.TickRate, currentTick, currentTick);
+        game.Update(this->Header.TickRate);
+        this->TickCount++;
+
+        // 3. 校验这次更新之后的状态
+        while (type == REPLAY_HASH && tick == currentTick) {
+            GLuint hash;
+            if (!this->ReadUint32(hash)) {
+                return GL_FALSE;
+            }
+            this->HashChecks++;
+            if (hash != game.StateHash()) {
+                this->MismatchTick = static_cast<GLint>(currentTick);
+                return GL_FALSE;
+            }
+            if (!this->ReadRecordHead(tick, type)) {
+                return GL_FALSE;
+            }
+        }
+    }
+    return GL_TRUE;
+}
+
+GLboolean ReplayPlayer::ReadRecordHead(GLuint &tick, ReplayRecordType &type)
+{
+    GLuint delta;
+    GLubyte value;
+    if (!this->ReadVarint(delta) || !this->ReadByte(value) || value > REPLAY_END) {
+        std::cout << "ERROR::REPLAY: Corrupted record after tick " << this->LastTick << std::endl;
+        return GL_FALSE;
+    }
+    this->LastTick += delta;
+    tick = this->LastTick;
+    type = static_cast<ReplayRecordType>(value);
+    return GL_TRUE;
+}
+
+GLboolean ReplayPlayer::ReadVarint(GLuint &value)
+{
+    value = 0;
+    for (GLuint shift = 0; shift < 35; shift += 7) {
+        GLubyte byte;
+        if (!this->ReadByte(byte)) {
+            return GL_FALSE;
+        }
+        value |= static_cast<GLuint>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return GL_TRUE;
+        }
+    }
+    return GL_FALSE;
+}
+
+GLboolean ReplayPlayer::ReadByte(GLubyte &value)
+{
+    if (this->Cursor >= this->Data.size()) {
+        return GL_FALSE;
+    }
+    value = this->Data[this->Cursor++];
+    return GL_TRUE;
+}
+
+GLboolean ReplayPlayer::ReadFloat(GLfloat &value)
+{
+    GLuint bits;
+    if (!this->ReadUint32(bits)) {
+        return GL_FALSE;
+    }
+    memcpy(&value, &bits, sizeof(value));
+    return GL_TRUE;
+}
+
+GLboolean ReplayPlayer::ReadUint32(GLuint &value)
+{
+    value = 0;
+    for (GLuint i = 0; i < 4; i++) {
+        GLubyte byte;
+        if (!this->ReadByte(byte)) {
+            return GL_FALSE;
+        }
+        value |= static_cast<GLuint>(byte) << (i * 8);
+    }
+    return GL_TRUE;
+}
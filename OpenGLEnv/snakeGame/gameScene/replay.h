@@ -0,0 +1,114 @@
+//
+//  replay.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/23.
+//
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "arena_config.h"
+#include "input_queue.h"
+
+class Game;
+
+/**
+ 回放文件格式（小端）
+
+ 文件头：
+    "SNKR" 魔数，varint 版本
+    varint 随机数种子，varint 窗口宽，varint 窗口高
+    varint 竞技场配置（MapScale, FoodCount, BotCount, PlayerLength, BotLength）
+    float 每次更新的时间间隔，varint 状态校验间隔（每隔多少次更新记录一次状态哈希）
+
+ 然后是一条条记录，每条记录：varint 距离上一条记录的更新次数 + 1 字节记录类型 + 数据
+    REPLAY_INPUT：1 字节（输入类型 << 1 | 动作），varint 按键，鼠标按下时再加两个 float 坐标
+    REPLAY_HASH：4 字节这次更新之后的状态哈希
+    REPLAY_END：没有数据，更新次数就是总的更新次数
+ */
+enum ReplayRecordType {
+    REPLAY_INPUT,
+    REPLAY_HASH,
+    REPLAY_END
+};
+
+// 回放文件头
+struct ReplayHeader {
+    GLuint      Seed;// 随机数种子
+    GLuint      Width, Height;// 窗口宽高，决定地图大小
+    ArenaConfig Config;// 竞技场配置
+    GLfloat     TickRate;// 每次更新的时间间隔
+    GLuint      HashInterval;// 状态校验间隔
+
+    ReplayHeader() : Seed(1), Width(0), Height(0), TickRate(1.0f / 60.0f), HashInterval(1) { }
+};
+
+// 录制：在模拟线程里记录每次更新处理的输入事件和状态哈希
+class ReplayRecorder
+{
+public:
+    ReplayRecorder();
+    ~ReplayRecorder();
+
+    // 打开文件并写入文件头
+    GLboolean Open(const std::string &path, const ReplayHeader &header);
+    // 记录第 tick 次更新处理的输入事件
+    void RecordInput(GLuint tick, const InputEvent &event);
+    // 第 tick 次更新是否需要记录状态哈希
+    GLboolean WantsHash(GLuint tick) const;
+    // 记录第 tick 次更新之后的状态哈希
+    void RecordHash(GLuint tick, GLuint hash);
+    // 写入结束记录并关闭文件，tickCount 是总的更新次数
+    void Close(GLuint tickCount);
+
+private:
+    std::ofstream   Stream;
+    ReplayHeader    Header;
+    GLuint          LastTick;// 上一条记录的更新次数
+
+    void WriteRecordHead(GLuint tick, ReplayRecordType type);
+    void WriteVarint(GLuint value);
+    void WriteByte(GLubyte value);
+    void WriteFloat(GLfloat value);
+    void WriteUint32(GLuint value);
+};
+
+// 回放：不需要窗口，按最快速度把输入事件重新交给 Game::ProcessInput，并校验状态哈希
+class ReplayPlayer
+{
+public:
+    ReplayHeader    Header;
+    GLuint          TickCount;// 回放的更新次数
+    GLuint          HashChecks;// 校验过的状态哈希数
+    GLint           MismatchTick;// 第一次状态不一致的更新，-1 表示全部一致
+
+    ReplayPlayer();
+
+    // 读取回放文件，文件损坏返回 false
+    GLboolean Open(const std::string &path);
+    // 用文件头里的配置初始化游戏（不加载任何 OpenGL 资源），然后回放全部记录
+    // 状态全部一致返回 true
+    GLboolean Play(Game &game);
+
+private:
+    std::vector<GLubyte> Data;
+    GLuint          Cursor;
+    GLuint          RecordsStart;// 第一条记录的位置
+    GLuint          LastTick;// 上一条记录的更新次数
+
+    // 读取下一条记录的更新次数和类型
+    GLboolean ReadRecordHead(GLuint &tick, ReplayRecordType &type);
+    GLboolean ReadVarint(GLuint &value);
+    GLboolean ReadByte(GLubyte &value);
+    GLboolean ReadFloat(GLfloat &value);
+    GLboolean ReadUint32(GLuint &value);
+};
+
+#endif /* replay_h */
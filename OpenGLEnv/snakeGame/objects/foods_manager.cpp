@@ -7,92 +7,179 @@
 
 #include "foods_manager.h"
 #include "resource_manager.h"
+#include "profiler.h"
+#include "frame_arena.h"
 
-FoodsManager::FoodsManager(glm::vec2 mapOrigin, glm::vec2 mapSize, std::vector<Texture2D> sprites, std::vector<glm::vec4> colors): MapOrigin(mapOrigin), MapSize(mapSize), Sprites(sprites), Colors(colors)
+FoodsManager::FoodsManager(glm::vec2 mapOrigin, glm::vec2 mapSize, std::vector<Texture2D> sprites, std::vector<glm::vec4> colors): MaxFoods(0), MapOrigin(mapOrigin), MapSize(mapSize), Sprites(sprites), Colors(colors), EmptySprite(ResourceManager::GetEmptyTexture()), Random(1, RANDOM_STREAM_FOODS), Occupancy(nullptr), Grid(mapOrigin, mapSize, 96.0f)
 {
     
 }
 
 void FoodsManager::GenerateSpriteFoods(GLuint foodCount, glm::vec2 foodSize)
 {
+    this->MaxFoods += foodCount;
+    // 一次生成全部随机数，每个食物三个：两个决定位置，一个决定纹理
+    std::vector<GLuint> randoms(foodCount * 3);
+    this->Random.Fill(randoms.data(), foodCount * 3);
+    this->Foods.reserve(this->Foods.size() + foodCount);
     for (GLuint i = 0; i < foodCount; i++) {
-        glm::vec2 pos = this->GenearteRandomPosition(foodSize);
-        Texture2D sprite = this->GenearteRandomSprite();
-        GameObject food(pos, foodSize, sprite, glm::vec4(1.0f));
+        glm::vec2 pos = this->RandomPosition(&randoms[i * 3], foodSize);
+        GameObject food(pos, foodSize, this->SpriteFrom(randoms[i * 3 + 2]), glm::vec4(1.0f));
         
-        this->Foods.push_back(food);
+        this->AddFood(food);
     }
+    this->RebuildGrid();
 }
 
 void FoodsManager::GenerateColorFoods(GLuint foodCount, glm::vec2 foodSize)
 {
+    this->MaxFoods += foodCount;
+    std::vector<GLuint> randoms(foodCount * 2);
+    this->Random.Fill(randoms.data(), foodCount * 2);
+    this->Foods.reserve(this->Foods.size() + foodCount);
     for (GLuint i = 0; i < foodCount; i++) {
-        glm::vec2 pos = this->GenearteRandomPosition(foodSize);
+        glm::vec2 pos = this->RandomPosition(&randoms[i * 2], foodSize);
         glm::vec4 color = this->GenearteRandomColor();
-        GameObject food(pos, foodSize, ResourceManager::GetEmptyTexture(), color);
+        GameObject food(pos, foodSize, this->EmptySprite, color);
         
-        this->Foods.push_back(food);
+        this->AddFood(food);
     }
+    this->RebuildGrid();
 }
 
-void FoodsManager::Update(GLfloat dt)
+void FoodsManager::SpawnFoodAt(glm::vec2 position, glm::vec2 foodSize)
 {
-    // 移除被吃掉的食物
-    std::vector<GameObject> destoryedFoods;
-    this->Foods.erase(std::remove_if(this->Foods.begin(), this->Foods.end(), [&destoryedFoods](GameObject &food) {
+    Texture2D sprite = this->GenearteRandomSprite();
+    GameObject food(position, foodSize, sprite, glm::vec4(1.0f));
+    
+    this->AddFood(food);
+}
+
+void FoodsManager::AddFood(const GameObject &food)
+{
+    this->Foods.push_back(food);
+    this->OccupiedPositions.push_back(food.Position);
+    if (this->Occupancy) {
+        this->Occupancy->Add(food.Position, food.Size);
+    }
+}
+
+void FoodsManager::Update(GLfloat /*dt*/)
+{
+    PROFILE_SCOPE("FoodsManager::Update");
+    // 移除被吃掉的食物，没被吃掉的食物可能被磁吸移动了，同步占用网格
+    // 被吃掉的食物只在这一帧里用，放在帧内存池里，函数返回时回收，
+    // 没有每帧 Reset 的调用方（基准测试、回放）也不会让内存池一直变大
+    FrameArenaScope scope;
+    FrameVector<GameObject> destoryedFoods;
+    GLuint kept = 0;
+    for (GLuint i = 0; i < this->Foods.size(); i++) {
+        GameObject &food = this->Foods[i];
         if (food.Destroyed) {
+            if (this->Occupancy) {
+                this->Occupancy->Remove(this->OccupiedPositions[i], food.Size);
+            }
             destoryedFoods.push_back(food);
+            continue;
         }
-        return food.Destroyed;
-    }), this->Foods.end());
+        if (this->Occupancy) {
+            this->Occupancy->Move(this->OccupiedPositions[i], food.Position, food.Size);
+        }
+        this->Foods[kept] = food;
+        this->OccupiedPositions[kept] = food.Position;
+        kept++;
+    }
+    this->Foods.resize(kept);
+    this->OccupiedPositions.resize(kept);
 
-    // 有多少食物被吃掉，就生成多少新食物
-    for (GameObject &food : destoryedFoods) {
-        if (food.Destroyed) {
-            if (food.Sprite.EmptyTexture) {
-                this->GenerateColorFoods(1, food.Size);
-            } else {
-                this->GenerateSpriteFoods(1, food.Size);
-            }
+    // 有多少食物被吃掉，就生成多少新食物，但是不超过上限
+    // 和初始生成一样一次生成全部随机数，每个食物三个：两个决定位置，一个决定纹理或颜色
+    GLuint respawnCount = static_cast<GLuint>(destoryedFoods.size());
+    GLuint room = this->MaxFoods > kept ? this->MaxFoods - kept : 0;
+    if (respawnCount > room) {
+        respawnCount = room;
+    }
+    FrameVector<GLuint> randoms(respawnCount * 3);
+    this->Random.Fill(randoms.data(), respawnCount * 3);
+    for (GLuint i = 0; i < respawnCount; i++) {
+        const GameObject &food = destoryedFoods[i];
+        glm::vec2 pos = this->RandomPosition(&randoms[i * 3], food.Size);
+        if (food.Sprite.EmptyTexture) {
+            this->AddFood(GameObject(pos, food.Size, this->EmptySprite, this->ColorFrom(randoms[i * 3 + 2])));
+        } else {
+            this->AddFood(GameObject(pos, food.Size, this->SpriteFrom(randoms[i * 3 + 2]), glm::vec4(1.0f)));
         }
     }
+    
+    this->RebuildGrid();
+}
+
+void FoodsManager::RebuildGrid()
+{
+    this->FoodCenters.resize(this->Foods.size());
+    for (GLuint i = 0; i < this->Foods.size(); i++) {
+        this->FoodCenters[i] = this->Foods[i].Position + this->Foods[i].Size / 2.0f;
+    }
+    this->Grid.Build(this->FoodCenters);
 }
 
-void FoodsManager::Draw(SpriteRenderer &renderer)
+void FoodsManager::Draw(SpriteRenderer &renderer, glm::vec2 viewMin, glm::vec2 viewMax)
 {
     for (GameObject &food : this->Foods) {
+        if (food.Position.x + food.Size.x < viewMin.x || food.Position.x > viewMax.x ||
+            food.Position.y + food.Size.y < viewMin.y || food.Position.y > viewMax.y) {
+            continue;
+        }
         if (!food.Destroyed) {
             food.Draw(renderer);
         }
     }
 }
 
-glm::vec2 FoodsManager::GenearteRandomPosition(glm::vec2 foodSize)
+glm::vec2 FoodsManager::RandomPosition(const GLuint *randoms, glm::vec2 foodSize)
 {
-    GLfloat x = this->MapOrigin.x + (rand() % ((GLuint)(this->MapSize.x - foodSize.x)));
-    GLfloat y = this->MapOrigin.y + (rand() % ((GLuint)(this->MapSize.y - foodSize.y)));
+    // 有占用网格时在所有空闲格子里均匀地选一个，食物放在格子中间，不会和蛇、其他食物重叠
+    GLuint cell;
+    if (this->Occupancy && this->Occupancy->RandomFreeCell(randoms[0], cell)) {
+        return this->Occupancy->CellPosition(cell) + (glm::vec2(this->Occupancy->CellSize) - foodSize) / 2.0f;
+    }
+    // 没有空闲格子，在整个地图里随机
+    GLfloat x = this->MapOrigin.x + RandomStream::ToFloat(randoms[0]) * (this->MapSize.x - foodSize.x);
+    GLfloat y = this->MapOrigin.y + RandomStream::ToFloat(randoms[1]) * (this->MapSize.y - foodSize.y);
     
     return glm::vec2(x, y);
 }
 
 Texture2D FoodsManager::GenearteRandomSprite()
+{
+    if (this->Sprites.empty()) {
+        return this->EmptySprite;
+    }
+    return this->SpriteFrom(this->Random.Next());
+}
+
+glm::vec4 FoodsManager::GenearteRandomColor()
+{
+    if (this->Colors.empty()) {
+        return glm::vec4(0.0f);
+    }
+    return this->ColorFrom(this->Random.Next());
+}
+
+Texture2D FoodsManager::SpriteFrom(GLuint random) const
 {
     GLuint size = static_cast<GLuint>(this->Sprites.size());
     if (size == 0) {
-        return ResourceManager::GetEmptyTexture();
+        return this->EmptySprite;
     }
-    
-    GLuint index = rand() % size;
-    return this->Sprites[index];
+    return this->Sprites[RandomStream::Bounded(random, size)];
 }
 
-glm::vec4 FoodsManager::GenearteRandomColor()
+glm::vec4 FoodsManager::ColorFrom(GLuint random) const
 {
     GLuint size = static_cast<GLuint>(this->Colors.size());
     if (size == 0) {
         return glm::vec4(0.0f);
     }
-    
-    GLuint index = rand() % size;
-    return this->Colors[index];
+    return this->Colors[RandomStream::Bounded(random, size)];
 }
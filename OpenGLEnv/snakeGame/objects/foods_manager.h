@@ -17,16 +17,27 @@
 
 #include "game_object.h"
 #include "texture.h"
+#include "spatial_grid.h"
+#include "random_stream.h"
+#include "occupancy_grid.h"
 
 class FoodsManager {
     
 public:
     std::vector<GameObject> Foods;// 所有食物
+    GLuint      MaxFoods;// 被吃掉后会补充的食物数量上限，蛇死亡掉落的食物不计入
     glm::vec2   MapOrigin, MapSize;// 地图原点和大小
     
     /// 食物有纹理和彩点两种
     std::vector<Texture2D> Sprites;// 纹理数组
     std::vector<glm::vec4> Colors;// 颜色数组
+    Texture2D   EmptySprite;// 彩点食物用的空纹理，构造时（GL 线程）取好，Update 在模拟线程里执行，不访问 ResourceManager
+    
+    RandomStream Random;// 食物位置、纹理和颜色的随机数流，由游戏用种子初始化
+    
+    OccupancyGrid *Occupancy;// 地图占用网格，不为空时新食物只生成在空闲格子上，食物的占用也登记在里面，由 Game 持有
+    
+    SpatialGrid Grid;// 食物的空间索引，每次 Update 后重建，之后新掉落的食物要等下一次 Update 才会被索引
     
     FoodsManager(glm::vec2 mapOrigin, glm::vec2 mapSize, std::vector<Texture2D> sprites, std::vector<glm::vec4> colors = {});
     
@@ -34,17 +45,37 @@ public:
     void GenerateSpriteFoods(GLuint foodCount, glm::vec2 foodSize);
     // 生成一批颜色食物
     void GenerateColorFoods(GLuint foodCount, glm::vec2 foodSize);
+    // 在指定位置生成一个食物（蛇死亡掉落），被吃掉后不会补充
+    void SpawnFoodAt(glm::vec2 position, glm::vec2 foodSize);
     
     // 更新食物状态
     void Update(GLfloat dt);
     
-    // 渲染
-    void Draw(SpriteRenderer &renderer);
+    // 遍历 [min, max] 范围附近的食物
+    template <typename Func>
+    void QueryFoods(glm::vec2 min, glm::vec2 max, Func func)
+    {
+        this->Grid.Query(min, max, [this, &func](GLuint index) {
+            func(this->Foods[index]);
+        });
+    }
+    
+    // 渲染，只绘制视野范围内的食物
+    void Draw(SpriteRenderer &renderer, glm::vec2 viewMin, glm::vec2 viewMax);
     
 private:
-    glm::vec2 GenearteRandomPosition(glm::vec2 foodSize);
+    std::vector<glm::vec2> FoodCenters;// 重建空间索引用的食物中心点
+    std::vector<glm::vec2> OccupiedPositions;// 每个食物登记在占用网格里的位置，和 Foods 一一对应
+    void RebuildGrid();
+    // 添加食物并登记占用
+    void AddFood(const GameObject &food);
+    // 用两个随机数生成一个位置，有占用网格时选一个空闲格子
+    glm::vec2 RandomPosition(const GLuint *randoms, glm::vec2 foodSize);
     Texture2D GenearteRandomSprite();
     glm::vec4 GenearteRandomColor();
+    // 用一个已经生成好的随机数选纹理和颜色，批量生成时使用
+    Texture2D SpriteFrom(GLuint random) const;
+    glm::vec4 ColorFrom(GLuint random) const;
 };
 
 #endif /* foods_manager_hpp */
@@ -0,0 +1,116 @@
+//
+//  snake_controller.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/12.
+//
+
+#include "snake_controller.h"
+
+#include <GLFW/glfw3.h>
+
+PlayerController::PlayerController(const GLboolean *keys, const GLboolean *mouseKeys, const glm::vec2 *mousePositions): Keys(keys), MouseKeys(mouseKeys), MousePositions(mousePositions)
+{
+
+}
+
+void PlayerController::Control(SnakeObject &snake, const ArenaView &/*arena*/, GLfloat /*dt*/)
+{
+    /**
+     速度=方向 * 速度大小
+     */
+    /// 处理键盘按键
+    if (this->Keys[GLFW_KEY_A])// 按了 A，表示左移
+    {
+        snake.Turn(glm::vec2(-1, 0));
+    }
+    if (this->Keys[GLFW_KEY_D])// 按了 D，表示右移
+    {
+        snake.Turn(glm::vec2(1, 0));
+    }
+    if (this->Keys[GLFW_KEY_W])// 按了 W，表示上移
+    {
+        // 因为 y 轴正方向朝下，所以 y = -1，表示向上
+        snake.Turn(glm::vec2(0, -1));
+    }
+    if (this->Keys[GLFW_KEY_S])// 按了 S，表示下移
+    {
+        snake.Turn(glm::vec2(0, 1));
+    }
+
+    /// 处理鼠标按键
+    if (this->MouseKeys[GLFW_MOUSE_BUTTON_LEFT])// 按了 左键，表示朝鼠标方向移动
+    {
+        glm::vec2 mousePos = this->MousePositions[GLFW_MOUSE_BUTTON_LEFT];
+        // 点相减等于蛇到鼠标位置的方向向量，就是得到了目标位置
+        snake.Turn(mousePos - snake.Position);
+    }
+
+    // 按了 = 表示加速
+    snake.SpeedUp = this->Keys[GLFW_KEY_EQUAL] ? GL_TRUE : GL_FALSE;
+}
+
+BotController::BotController(const RandomStream &random, GLfloat thinkInterval, GLfloat sightRange): ThinkInterval(thinkInterval), SightRange(sightRange), ThinkTime(0.0f), Random(random)
+{
+
+}
+
+void BotController::Control(SnakeObject &snake, const ArenaView &arena, GLfloat dt)
+{
+    this->ThinkTime -= dt;
+    if (this->ThinkTime > 0.0f) {
+        return;
+    }
+    this->ThinkTime = this->ThinkInterval;
+
+    glm::vec2 head = snake.Position + snake.NodeSize / 2.0f;
+    glm::vec2 mapMin = arena.MapOrigin;
+    glm::vec2 mapMax = arena.MapOrigin + arena.MapSize;
+
+    // 1. 离墙太近，转向地图中心
+    GLfloat margin = snake.NodeSize.x * 4.0f;
+    if (head.x < mapMin.x + margin || head.y < mapMin.y + margin ||
+        head.x > mapMax.x - margin || head.y > mapMax.y - margin) {
+        this->SteerTowards(snake, (mapMin + mapMax) / 2.0f - head);
+        return;
+    }
+
+    // 2. 找视野内最近的食物
+    GLfloat nearestDistance = this->SightRange;
+    const GameObject *nearestFood = nullptr;
+    glm::vec2 sight(this->SightRange);
+    arena.Foods->QueryFoods(head - sight, head + sight, [&](const GameObject &food) {
+        if (food.Destroyed) {
+            return;
+        }
+        glm::vec2 foodPosition = food.Position + food.Size / 2.0f;
+        GLfloat distance = glm::distance(head, foodPosition);
+        if (distance < nearestDistance) {
+            nearestDistance = distance;
+            nearestFood = &food;
+        }
+    });
+    if (nearestFood) {
+        this->SteerTowards(snake, nearestFood->Position + nearestFood->Size / 2.0f - head);
+        return;
+    }
+
+    // 3. 随机游走，在当前方向上左右偏转最多 45 度
+    GLfloat angle = glm::radians(static_cast<GLfloat>(this->Random.Range(-45, 45)));
+    this->SteerTowards(snake, glm::rotate(glm::normalize(snake.Velocity), angle));
+}
+
+void BotController::SteerTowards(SnakeObject &snake, glm::vec2 direction)
+{
+    if (glm::length(direction) <= 0.0f) {
+        return;
+    }
+    direction = glm::normalize(direction);
+    glm::vec2 snakeDirection = glm::normalize(snake.Velocity);
+
+    if (glm::dot(direction, snakeDirection) < 0) {// 夹角大于 90 度，先往目标一侧转 90 度
+        GLfloat cross = snakeDirection.x * direction.y - snakeDirection.y * direction.x;
+        direction = cross >= 0 ? glm::vec2(-snakeDirection.y, snakeDirection.x) : glm::vec2(snakeDirection.y, -snakeDirection.x);
+    }
+    snake.Turn(direction);
+}
@@ -0,0 +1,65 @@
+//
+//  snake_controller.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/12.
+//
+
+#ifndef SNAKE_CONTROLLER_H
+#define SNAKE_CONTROLLER_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "game_object.h"
+#include "snake_object.h"
+#include "foods_manager.h"
+#include "random_stream.h"
+
+// 控制器能看到的竞技场状态（只读）
+struct ArenaView {
+    glm::vec2   MapOrigin, MapSize;// 地图原点和大小
+    FoodsManager *Foods;// 所有食物，控制器只能读取
+};
+
+// 蛇的输入源，每条蛇都有自己的控制器（玩家或者 AI）
+class SnakeController {
+public:
+    virtual ~SnakeController() { }
+    // 根据输入修改蛇的方向和速度
+    virtual void Control(SnakeObject &snake, const ArenaView &arena, GLfloat dt) = 0;
+};
+
+// 玩家控制器，读取键盘和鼠标输入
+class PlayerController : public SnakeController {
+public:
+    PlayerController(const GLboolean *keys, const GLboolean *mouseKeys, const glm::vec2 *mousePositions);
+    void Control(SnakeObject &snake, const ArenaView &arena, GLfloat dt) override;
+
+private:
+    const GLboolean *Keys;// 外部输入的按键数组
+    const GLboolean *MouseKeys;// 外部输入的鼠标按钮数组
+    const glm::vec2 *MousePositions;// 外部输入的鼠标所在位置数组
+};
+
+// AI 控制器，靠近墙就掉头，否则找视野内最近的食物，找不到就随机游走
+// Control 只读取竞技场状态和修改自己的蛇，不同的蛇可以在不同线程里同时思考
+class BotController : public SnakeController {
+public:
+    GLfloat     ThinkInterval;// 思考间隔（秒）
+    GLfloat     SightRange;// 视野范围
+
+    // 每条 AI 蛇有自己的随机数流，多线程思考时结果也是确定的
+    BotController(const RandomStream &random, GLfloat thinkInterval = 0.25f, GLfloat sightRange = 240.0f);
+    void Control(SnakeObject &snake, const ArenaView &arena, GLfloat dt) override;
+
+private:
+    GLfloat     ThinkTime;// 距离下一次思考的时间
+    RandomStream Random;// 随机游走用的随机数
+    // 转向目标方向，如果夹角超过 90 度，就先转 90 度
+    void SteerTowards(SnakeObject &snake, glm::vec2 direction);
+};
+
+#endif /* snake_controller_h */
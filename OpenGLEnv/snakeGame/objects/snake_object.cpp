@@ -7,11 +7,11 @@
 
 #include "snake_object.h"
 #include "resource_manager.h"
+#include "profiler.h"
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
 
 // 构造函数
-SnakeObject::SnakeObject(glm::vec2 position, glm::vec2 nodeSize, GLfloat initialLength, std::vector<Texture2D> sprites, GLfloat spriteRotation, glm::vec2 velocity, glm::vec4 color): Position(position), NodeSize(nodeSize), InitialLength(initialLength), Sprites(sprites), SpriteRotation(spriteRotation), Velocity(velocity), Color(color), Pause(GL_TRUE), SpeedUp(GL_FALSE), Died(GL_FALSE) {
+SnakeObject::SnakeObject(glm::vec2 position, glm::vec2 nodeSize, GLfloat initialLength, std::vector<Texture2D> sprites, GLfloat spriteRotation, glm::vec2 velocity, glm::vec4 color): InitialLength(initialLength), SpriteRotation(spriteRotation), Position(position), NodeSize(nodeSize), Velocity(velocity), Color(color), Sprites(sprites), SpeedUp(GL_FALSE), Pause(GL_TRUE), Died(GL_FALSE), Controller(nullptr) {
     this->NodeDistance = this->NodeSize.x * 1.0f;
     this->SnakeBornCount = initialLength;
     this->LoadNodes();
@@ -24,6 +24,8 @@ void SnakeObject::LoadNodes() {
     for (GLuint i = 0; i < this->SnakeBornCount; i++) {
         this->AddTailNode();
     }
+    this->PreviousPosition = this->Position;
+    this->UpdateBounds();
 }
 
 void SnakeObject::AddTailNode()
@@ -63,7 +65,7 @@ void SnakeObject::AddTailNode()
     this->Nodes.push_back(newNode);
 }
 
-void SnakeObject::EatFood(glm::vec2 foodPosition)
+void SnakeObject::EatFood(glm::vec2 /*foodPosition*/)
 {
     this->AddTailNode();
 }
@@ -108,12 +110,35 @@ void SnakeObject::MoveHead() {
 }
 
 void SnakeObject::Move(GLfloat dt) {
+    PROFILE_SCOPE("SnakeObject::Move");
+    // 停止移动时扫过的距离是 0
+    this->PreviousPosition = this->Position;
     if (this->Pause) {
         return;
     }
     
-    this->MoveBody1(dt);
+    // 一次移动超过半个节点距离时（加速、卡顿、低频率更新）分成几步移动，
+    // 否则身体插值的系数大于 1，节点会越过前一个节点
+    GLfloat speedUp = this->SpeedUp ? 2.0f : 1.0f;
+    GLfloat distance = glm::length(this->Velocity) * speedUp * dt;
+    GLuint steps = glm::max(1u, static_cast<GLuint>(glm::ceil(distance / (this->NodeDistance / 2.0f))));
+    for (GLuint i = 0; i < steps; i++) {
+        this->MoveBody1(dt / steps);
+    }
 //    this->MoveBody2(dt);
+    
+    this->UpdateBounds();
+}
+
+void SnakeObject::UpdateBounds() {
+    glm::vec2 boundsMin = this->Nodes[0].Position;
+    glm::vec2 boundsMax = this->Nodes[0].Position;
+    for (GameObject &node : this->Nodes) {
+        boundsMin = glm::min(boundsMin, node.Position);
+        boundsMax = glm::max(boundsMax, node.Position);
+    }
+    this->BoundsMin = boundsMin;
+    this->BoundsMax = boundsMax + this->NodeSize;
 }
 
 void SnakeObject::MoveBody1(GLfloat dt) {
@@ -157,7 +182,7 @@ void SnakeObject::MoveBody2(GLfloat dt) {
      */
     /// 移动其他节点
     GLuint size = static_cast<GLuint>(this->Nodes.size());
-    for (GLint i = 1; i < size; i++) {
+    for (GLuint i = 1; i < size; i++) {
         GameObject &preNode = this->Nodes[i-1];
         GameObject &curNode = this->Nodes[i];
         
@@ -219,21 +244,33 @@ void SnakeObject::MoveBody2(GLfloat dt) {
 
 void SnakeObject::Reset(glm::vec2 position, glm::vec2 velocity) {
     this->Position = position;
+    this->PreviousPosition = position;
     this->Velocity = velocity;
 }
 
+void SnakeObject::Turn(glm::vec2 direction) {
+    if (glm::length(direction) <= 0.0f) {
+        return;
+    }
+    
+    direction = glm::normalize(direction);
+    glm::vec2 snakeDirection = glm::normalize(this->Velocity);
+    
+    if (glm::dot(direction, snakeDirection) >= 0) {// 向量点乘的值大于等于 0，说明这两个向量的夹角是小于等于 90 度的
+        this->Velocity = direction * glm::length(this->Velocity);
+    }
+}
+
 void SnakeObject::Draw(SpriteRenderer &renderer) {
     if (this->Died) {
         return;
     }
     
-    GLfloat t0 = glfwGetTime();
+    PROFILE_SCOPE("SnakeObject::Draw");
     GLuint size = static_cast<GLuint>(this->Nodes.size());
     for (GLint i = size - 1; i >= 0; i--) {
         this->Nodes[i].Draw(renderer);
     }
-    GLfloat t1 = glfwGetTime();
-    printf("SnakeObject::Draw duration time %f\n", t1 - t0);// BatchDraw duration time 0.000015
 }
 
 void SnakeObject::BatchDraw(SpriteBatchRenderer &renderer) {
@@ -244,12 +281,8 @@ void SnakeObject::BatchDraw(SpriteBatchRenderer &renderer) {
     /**
      几个节点的话，和上面性能差不多，如果是500个以上的节点，性能可以提升一倍以上
      */
-    GLfloat t0 = glfwGetTime();
-    
+    PROFILE_SCOPE("SnakeObject::BatchDraw");
     renderer.DrawSprites(this->Nodes);
-    
-    GLfloat t1 = glfwGetTime();
-    printf("SnakeObject::BatchDraw duration time %f\n", t1 - t0);// BatchDraw duration time 0.000015
 }
 
 void SnakeObject::BatchGPUDraw(SpriteBatchGPURenderer &renderer) {
@@ -260,10 +293,6 @@ void SnakeObject::BatchGPUDraw(SpriteBatchGPURenderer &renderer) {
     /**
      几个节点的话，和上面性能差不多，如果是500个以上的节点，性能比批量渲染提升18倍
      */
-    GLfloat t0 = glfwGetTime();
-    
+    PROFILE_SCOPE("SnakeObject::BatchGPUDraw");
     renderer.DrawSprites(this->Nodes);
-    
-    GLfloat t1 = glfwGetTime();
-//    printf("SnakeObject::BatchGPUDraw duration time %f\n", t1 - t0);// BatchGPUDraw duration time 0.000015
 }
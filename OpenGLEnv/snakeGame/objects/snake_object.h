@@ -20,7 +20,12 @@
 #include "sprite_batch_renderer.h"
 #include "sprite_batch_gpu_renderer.h"
 
+class SnakeController;
+class SimulationBenchmark;
+
 class SnakeObject {
+    // 基准测试直接测量私有的移动函数
+    friend class SimulationBenchmark;
     
 public:
     // 蛇的所有节点
@@ -29,6 +34,7 @@ public:
     // 位置，大小，长度，速度(向量，包含了方向和大小)
     GLfloat     InitialLength, SpriteRotation;
     glm::vec2   Position, NodeSize, Velocity;
+    glm::vec2   PreviousPosition;// 最近一次移动前蛇头的位置，蛇头从这里扫到 Position，用于连续碰撞检测
     
     // 外观
     glm::vec4   Color;// 颜色
@@ -38,12 +44,18 @@ public:
     GLboolean   Pause;// 蛇停止移动
     GLboolean   Died;// 蛇是否死亡
     
+    glm::vec2   BoundsMin, BoundsMax;// 所有节点的包围盒，用于快速排除碰撞
+    SnakeController *Controller;// 输入源（玩家或者 AI），由 Game 负责释放
+    std::vector<glm::vec2> OccupiedPositions;// 每个节点登记在占用网格里的位置，由 Game 维护
+    
     // 构造函数
     SnakeObject(glm::vec2 position, glm::vec2 nodeSize, GLfloat initialLength, std::vector<Texture2D> sprites, GLfloat spriteRotation, glm::vec2 velocity, glm::vec4 color = glm::vec4(1.0f));
     
     // 更新
     void Move(GLfloat dt);
     void Reset(glm::vec2 position, glm::vec2 velocity);
+    // 转向，夹角大于 90 度的方向会被忽略，速度大小不变
+    void Turn(glm::vec2 direction);
     
     // 吃食物
     void EatFood(glm::vec2 foodPosition);
@@ -71,6 +83,7 @@ private:
     void MoveHead();
     void MoveBody1(GLfloat dt);
     void MoveBody2(GLfloat dt);
+    void UpdateBounds();
 };
 
 
@@ -6,6 +6,10 @@
 //
 
 #include "sprite_batch_renderer.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
+#include "profiler.h"
+#include "frame_arena.h"
 
 #define MaxTextureNum 8
 
@@ -25,23 +29,30 @@ SpriteBatchRenderer::SpriteBatchRenderer(Shader &shader)
 SpriteBatchRenderer::~SpriteBatchRenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    GPUMemory::Release(GPU_BUFFER, this->quadVBO);
+    GPUMemory::Release(GPU_BUFFER, this->matrixVBO);
+    glDeleteBuffers(1, &this->quadVBO);
+    glDeleteBuffers(1, &this->matrixVBO);
 }
 
 void SpriteBatchRenderer::DrawSprites(std::vector<GameObject> &sprites)
 {
+    PROFILE_SCOPE("SpriteBatchRenderer::DrawSprites");
     this->shader.Use();
     
     GLuint count = static_cast<GLuint>(sprites.size());
-    // 矩阵数据
-    InstanceData* instanceDatas = new InstanceData[count];
+    // 矩阵数据和纹理坐标上传之后就不用了，放在帧内存池里，函数返回时回收
+    FrameArenaScope scope;
+    FrameArena &arena = FrameArena::ThreadLocal();
+    InstanceData* instanceDatas = arena.Allocate<InstanceData>(count);
     
     // 纹理坐标
-    glm::vec2* textureCoords = new glm::vec2[count * 6];
+    glm::vec2* textureCoords = arena.Allocate<glm::vec2>(count * 6);
     
     GLuint textureIndexes[MaxTextureNum] = {0};
     GLuint textureInfoCount = 0;
     
-    for (GLint i = 0; i < count; i++) {
+    for (GLuint i = 0; i < count; i++) {
         GameObject gameObject = sprites[i];
         
         glm::mat4 model = glm::mat4(1.0f);
@@ -69,7 +80,7 @@ void SpriteBatchRenderer::DrawSprites(std::vector<GameObject> &sprites)
         
         GLint textureIndex = 0;
         GLboolean foundSame = GL_FALSE;
-        for (int ii = 0; ii < textureInfoCount; ++ii) {
+        for (GLuint ii = 0; ii < textureInfoCount; ++ii) {
             if (textureIndexes[ii] == texture.ID) {
                 foundSame = GL_TRUE;
                 textureIndex = ii;
@@ -97,23 +108,29 @@ void SpriteBatchRenderer::DrawSprites(std::vector<GameObject> &sprites)
     }
     
     // 局部更新纹理坐标：发送纹理坐标数据到GPU
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 3 * sizeof(GLfloat), count * 6 * sizeof(GLfloat), &textureCoords[0]);
+    // quadVBO 只有 6 个顶点，超过 4 个精灵时写越界（GL_INVALID_VALUE），少于 4 个时会覆盖顶点位置，而且纹理坐标已经在 quadVBO 里了，所以不再上传
+//    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+//    glBufferSubData(GL_ARRAY_BUFFER, 3 * sizeof(GLfloat), count * 6 * sizeof(GLfloat), &textureCoords[0]);
     
     // 更新模型视图矩阵： 发送矩阵数据到GPU
     glBindBuffer(GL_ARRAY_BUFFER, matrixVBO);
     glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), &instanceDatas[0], GL_DYNAMIC_DRAW);
+    RenderStats::CountBufferUpload(count * sizeof(InstanceData));
+    GPUMemory::Track(GPU_BUFFER, matrixVBO, count * sizeof(InstanceData));
     
     GLuint textureUnit = 0;
     for (GLuint ii = 0; ii < textureInfoCount; ++ii) {
         GLuint textureName = textureIndexes[ii];
         glActiveTexture(GL_TEXTURE0 + textureUnit);
         glBindTexture(GL_TEXTURE_2D, textureName);
+        RenderStats::CountStateChange();
         textureUnit++;
     }
     
     glBindVertexArray(this->quadVAO);
+    RenderStats::CountStateChange();
     glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+    RenderStats::CountDraw(count);
     glBindVertexArray(0);
 }
 
@@ -151,6 +168,7 @@ void SpriteBatchRenderer::initRenderData()
 
     glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    GPUMemory::Track(GPU_BUFFER, quadVBO, sizeof(vertices));
 
     glBindVertexArray(this->quadVAO);
     glEnableVertexAttribArray(0);
@@ -164,7 +182,7 @@ void SpriteBatchRenderer::initRenderData()
     
     // 矩阵属性
     GLsizei size = sizeof(InstanceData);
-    GLsizei vec4Size = sizeof(glm::vec4);
+    size_t vec4Size = sizeof(glm::vec4);
     
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, size, (void*)0);
@@ -175,7 +193,8 @@ void SpriteBatchRenderer::initRenderData()
     glEnableVertexAttribArray(5);
     glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, size, (void*)(3 * vec4Size));
     glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 1, GL_INT, GL_FALSE, size, (void*)(offsetof(InstanceData, TextureIndex)));
+    // 整数属性要用 glVertexAttribIPointer，否则会被转换成浮点数，着色器里的 int 读到的是错误的值
+    glVertexAttribIPointer(6, 1, GL_INT, size, (void*)(offsetof(InstanceData, TextureIndex)));
     
     // 设置顶点属性更新方式，0 表示每个顶点更新，1 表示每个实例更新，2 每隔 2 个实例更新，以此类推
     glVertexAttribDivisor(2, 1);
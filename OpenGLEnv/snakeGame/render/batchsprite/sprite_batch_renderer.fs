@@ -7,5 +7,21 @@ uniform sampler2D images[8];
 
 void main()
 {
-    color = texture(images[TexIndex], TexCoords);
+    // GLSL 330 里采样器数组只能用常量下标，TexIndex 对整个实例都一样（flat），用分支选择不会有导数问题
+    if (TexIndex == 0)
+        color = texture(images[0], TexCoords);
+    else if (TexIndex == 1)
+        color = texture(images[1], TexCoords);
+    else if (TexIndex == 2)
+        color = texture(images[2], TexCoords);
+    else if (TexIndex == 3)
+        color = texture(images[3], TexCoords);
+    else if (TexIndex == 4)
+        color = texture(images[4], TexCoords);
+    else if (TexIndex == 5)
+        color = texture(images[5], TexCoords);
+    else if (TexIndex == 6)
+        color = texture(images[6], TexCoords);
+    else
+        color = texture(images[7], TexCoords);
 }
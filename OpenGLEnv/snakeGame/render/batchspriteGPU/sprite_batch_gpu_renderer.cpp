@@ -6,24 +6,13 @@
 //
 
 #include "sprite_batch_gpu_renderer.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
+#include "profiler.h"
+#include "frame_arena.h"
 
 #define MaxTextureNum 8
 
-struct InstanceData {
-    // 实例位置
-    glm::vec2 Position;
-    // 实例大小
-    glm::vec2 Size;
-    // 实例旋转弧度
-    GLfloat Radian;
-    // 实例旋转四元数
-    glm::quat Quaternion;
-    // 纹理索引
-    GLint TextureIndex;
-    // 纹理 frame, 纹理左下角和纹理宽高，都是小于 1.0
-    glm::vec4 TextureFrame;
-};
-
 SpriteBatchGPURenderer::SpriteBatchGPURenderer(Shader &shader)
 {
     this->shader = shader;
@@ -33,40 +22,80 @@ SpriteBatchGPURenderer::SpriteBatchGPURenderer(Shader &shader)
 SpriteBatchGPURenderer::~SpriteBatchGPURenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    GPUMemory::Release(GPU_BUFFER, this->quadVBO);
+    GPUMemory::Release(GPU_BUFFER, this->matrixVBO);
+    glDeleteBuffers(1, &this->quadVBO);
+    glDeleteBuffers(1, &this->matrixVBO);
 }
 
 void SpriteBatchGPURenderer::DrawSprites(std::vector<GameObject> &sprites)
 {
+    this->DrawSprites(sprites.data(), static_cast<GLuint>(sprites.size()));
+}
+
+void SpriteBatchGPURenderer::DrawSprites(const GameObject *sprites, GLuint count)
+{
+    PROFILE_SCOPE("SpriteBatchGPURenderer::DrawSprites");
     this->shader.Use();
     
-    GLuint count = static_cast<GLuint>(sprites.size());
-    // 矩阵数据
-    InstanceData* instanceDatas = new InstanceData[count];
+    // 矩阵数据，上传之后就不用了，放在帧内存池里，函数返回时回收
+    FrameArenaScope scope;
+    SpriteInstanceData* instanceDatas = FrameArena::ThreadLocal().Allocate<SpriteInstanceData>(count);
     
     // 纹理坐标
 //    glm::vec2* textureCoords = new glm::vec2[count * 6];
     
     GLuint textureIndexes[MaxTextureNum] = {0};
+    GLuint textureInfoCount = BuildInstances(sprites, count, instanceDatas, textureIndexes);
+    
+    // 局部更新纹理坐标：发送纹理坐标数据到GPU
+//    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+//    glBufferSubData(GL_ARRAY_BUFFER, 3 * sizeof(GLfloat), count * 6 * sizeof(GLfloat), &textureCoords[0]);
+    
+    // 更新模型视图矩阵： 发送矩阵数据到GPU
+    glBindBuffer(GL_ARRAY_BUFFER, matrixVBO);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(SpriteInstanceData), &instanceDatas[0], GL_DYNAMIC_DRAW);
+    RenderStats::CountBufferUpload(count * sizeof(SpriteInstanceData));
+    GPUMemory::Track(GPU_BUFFER, matrixVBO, count * sizeof(SpriteInstanceData));
+    
+    GLuint textureUnit = 0;
+    for (GLuint ii = 0; ii < textureInfoCount; ++ii) {
+        GLuint textureName = textureIndexes[ii];
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D, textureName);
+        RenderStats::CountStateChange();
+        textureUnit++;
+    }
+    
+    glBindVertexArray(this->quadVAO);
+    RenderStats::CountStateChange();
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+    RenderStats::CountDraw(count);
+    glBindVertexArray(0);
+}
+
+GLuint SpriteBatchGPURenderer::BuildInstances(const GameObject *sprites, GLuint count, SpriteInstanceData *instances, GLuint *textureIDs)
+{
     GLuint textureInfoCount = 0;
     
-    for (GLint i = 0; i < count; i++) {
-        GameObject gameObject = sprites[i];
+    for (GLuint i = 0; i < count; i++) {
+        const GameObject &gameObject = sprites[i];
         
         glm::vec2 position = gameObject.Position;
         glm::vec2 size = gameObject.Size;
         float rotate = gameObject.Rotation;
         glm::quat rotationQuat = gameObject.RotationQuat;
-        Texture2D &texture = gameObject.Sprite;
+        const Texture2D &texture = gameObject.Sprite;
  
-        instanceDatas[i].Position = position;
-        instanceDatas[i].Size = size;
-        instanceDatas[i].Radian = glm::radians(rotate);
-        instanceDatas[i].Quaternion = rotationQuat;
+        instances[i].Position = position;
+        instances[i].Size = size;
+        instances[i].Radian = glm::radians(rotate);
+        instances[i].Quaternion = rotationQuat;
         
         GLint textureIndex = 0;
         GLboolean foundSame = GL_FALSE;
-        for (int ii = 0; ii < textureInfoCount; ++ii) {
-            if (textureIndexes[ii] == texture.ID) {
+        for (GLuint ii = 0; ii < textureInfoCount; ++ii) {
+            if (textureIDs[ii] == texture.ID) {
                 foundSame = GL_TRUE;
                 textureIndex = ii;
                 break;
@@ -74,7 +103,7 @@ void SpriteBatchGPURenderer::DrawSprites(std::vector<GameObject> &sprites)
         }
         if (foundSame == GL_FALSE) {
             if (textureInfoCount < MaxTextureNum) {
-                textureIndexes[textureInfoCount] = texture.ID;
+                textureIDs[textureInfoCount] = texture.ID;
                 textureIndex = textureInfoCount;
                 textureInfoCount++;
             } else {
@@ -83,7 +112,7 @@ void SpriteBatchGPURenderer::DrawSprites(std::vector<GameObject> &sprites)
         }
         
         // 设置纹理索引和纹理坐标
-        instanceDatas[i].TextureIndex = textureIndex;
+        instances[i].TextureIndex = textureIndex;
 //        textureCoords[i + 0] = glm::vec2(0.0, 1.0);
 //        textureCoords[i + 1] = glm::vec2(1.0, 0.0);
 //        textureCoords[i + 2] = glm::vec2(0.0, 0.0);
@@ -91,35 +120,16 @@ void SpriteBatchGPURenderer::DrawSprites(std::vector<GameObject> &sprites)
 //        textureCoords[i + 4] = glm::vec2(1.0, 1.0);
 //        textureCoords[i + 5] = glm::vec2(1.0, 0.0);
 //
-//        instanceDatas[i].TextureCoords[i + 0] = glm::vec2(0.0, 1.0);
-//        instanceDatas[i].TextureCoords[i + 1] = glm::vec2(1.0, 0.0);
-//        instanceDatas[i].TextureCoords[i + 2] = glm::vec2(0.0, 0.0);
-//        instanceDatas[i].TextureCoords[i + 3] = glm::vec2(0.0, 1.0);
-//        instanceDatas[i].TextureCoords[i + 4] = glm::vec2(1.0, 1.0);
-//        instanceDatas[i].TextureCoords[i + 5] = glm::vec2(1.0, 0.0);
+//        instances[i].TextureCoords[i + 0] = glm::vec2(0.0, 1.0);
+//        instances[i].TextureCoords[i + 1] = glm::vec2(1.0, 0.0);
+//        instances[i].TextureCoords[i + 2] = glm::vec2(0.0, 0.0);
+//        instances[i].TextureCoords[i + 3] = glm::vec2(0.0, 1.0);
+//        instances[i].TextureCoords[i + 4] = glm::vec2(1.0, 1.0);
+//        instances[i].TextureCoords[i + 5] = glm::vec2(1.0, 0.0);
         
-        instanceDatas[i].TextureFrame = glm::vec4(0.0, 0.0, 1.0, 1.0);
-    }
-    
-    // 局部更新纹理坐标：发送纹理坐标数据到GPU
-//    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-//    glBufferSubData(GL_ARRAY_BUFFER, 3 * sizeof(GLfloat), count * 6 * sizeof(GLfloat), &textureCoords[0]);
-    
-    // 更新模型视图矩阵： 发送矩阵数据到GPU
-    glBindBuffer(GL_ARRAY_BUFFER, matrixVBO);
-    glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), &instanceDatas[0], GL_DYNAMIC_DRAW);
-    
-    GLuint textureUnit = 0;
-    for (GLuint ii = 0; ii < textureInfoCount; ++ii) {
-        GLuint textureName = textureIndexes[ii];
-        glActiveTexture(GL_TEXTURE0 + textureUnit);
-        glBindTexture(GL_TEXTURE_2D, textureName);
-        textureUnit++;
+        instances[i].TextureFrame = glm::vec4(0.0, 0.0, 1.0, 1.0);
     }
-    
-    glBindVertexArray(this->quadVAO);
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
-    glBindVertexArray(0);
+    return textureInfoCount;
 }
 
 void SpriteBatchGPURenderer::initRenderData()
@@ -157,6 +167,7 @@ void SpriteBatchGPURenderer::initRenderData()
 
     glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    GPUMemory::Track(GPU_BUFFER, quadVBO, sizeof(vertices));
 
     /// 配置顶点属性取值描述
     glBindVertexArray(this->quadVAO);
@@ -169,19 +180,20 @@ void SpriteBatchGPURenderer::initRenderData()
     /// 配置矩阵属性取值描述
     glBindBuffer(GL_ARRAY_BUFFER, matrixVBO);// 绑定矩阵 VBO，让下面的顶点属性从 matrixVBO 里取数据
     // 矩阵属性
-    GLsizei size = sizeof(InstanceData);
+    GLsizei size = sizeof(SpriteInstanceData);
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, size, (void*)0);
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, size, (void*)(offsetof(InstanceData, Size)));
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, size, (void*)(offsetof(SpriteInstanceData, Size)));
     glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, size, (void*)(offsetof(InstanceData, Radian)));
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, size, (void*)(offsetof(SpriteInstanceData, Radian)));
     glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, size, (void*)(offsetof(InstanceData, Quaternion)));
+    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, size, (void*)(offsetof(SpriteInstanceData, Quaternion)));
     glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 1, GL_INT, GL_FALSE, size, (void*)(offsetof(InstanceData, TextureIndex)));
+    // 整数属性要用 glVertexAttribIPointer，否则会被转换成浮点数，着色器里的 int 读到的是错误的值
+    glVertexAttribIPointer(6, 1, GL_INT, size, (void*)(offsetof(SpriteInstanceData, TextureIndex)));
     glEnableVertexAttribArray(7);
-    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, size, (void*)(offsetof(InstanceData, TextureFrame)));
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, size, (void*)(offsetof(SpriteInstanceData, TextureFrame)));
     
     // 设置顶点属性更新方式，0 表示每个顶点更新，1 表示每个实例更新，2 每隔 2 个实例更新，以此类推
     glVertexAttribDivisor(2, 1);
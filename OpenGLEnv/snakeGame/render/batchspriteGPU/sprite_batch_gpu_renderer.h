@@ -20,6 +20,22 @@
 #include "shader.h"
 #include "game_object.h"
 
+// 每个实例（精灵）上传到 GPU 的数据，矩阵在顶点着色器里计算
+struct SpriteInstanceData {
+    // 实例位置
+    glm::vec2 Position;
+    // 实例大小
+    glm::vec2 Size;
+    // 实例旋转弧度
+    GLfloat Radian;
+    // 实例旋转四元数
+    glm::quat Quaternion;
+    // 纹理索引
+    GLint TextureIndex;
+    // 纹理 frame, 纹理左下角和纹理宽高，都是小于 1.0
+    glm::vec4 TextureFrame;
+};
+
 // 批量精灵render - 基于 GPU 计算矩阵
 class SpriteBatchGPURenderer
 {
@@ -30,6 +46,11 @@ public:
     ~SpriteBatchGPURenderer();
     // 绘制一批精灵，用同一个纹理
     void DrawSprites(std::vector<GameObject> &sprites);
+    // 绘制连续的 count 个精灵
+    void DrawSprites(const GameObject *sprites, GLuint count);
+    // 填充 count 个实例的数据，用到的纹理放到 textureIDs 里（最多 8 个），返回纹理个数
+    // 只在 CPU 上计算，不调用 OpenGL 函数
+    static GLuint BuildInstances(const GameObject *sprites, GLuint count, SpriteInstanceData *instances, GLuint *textureIDs);
 private:
     // Render state
     Shader       shader;
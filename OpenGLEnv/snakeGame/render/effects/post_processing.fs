@@ -21,43 +21,90 @@ in  vec2  TexCoords;
 out vec4  color;
 
 uniform sampler2D scene;
+#if defined(CHAOS) || defined(SHAKE)
 uniform vec2      offsets[9];
+#endif
+#if defined(CHAOS)
 uniform int       edge_kernel[9];
+#elif defined(SHAKE)
 uniform float     blur_kernel[9];
+#endif
 
-uniform bool chaos;
-uniform bool confuse;
-uniform bool shake;
+#if defined(FXAA)
+// FXAA：按四个对角像素的亮度算出边缘的法线方向，沿边缘方向取样混合。
+// 只在边缘上起作用，平坦区域保持原来的颜色；一次 pass，最多 9 次采样，不需要多重采样缓冲
+const float FXAA_REDUCE_MIN = 1.0 / 128.0;
+const float FXAA_REDUCE_MUL = 1.0 / 8.0;
+const float FXAA_SPAN_MAX   = 8.0;
+const float FXAA_EDGE_THRESHOLD     = 1.0 / 8.0;
+const float FXAA_EDGE_THRESHOLD_MIN = 1.0 / 32.0;
+const vec3  LUMA            = vec3(0.299, 0.587, 0.114);
+
+// 纹理是 GL_REPEAT 的（chaos 要用），FXAA 在屏幕边上不能采到另一边
+vec3 fxaaSample(vec2 uv, vec2 texel)
+{
+    return texture(scene, clamp(uv, 0.5 * texel, 1.0 - 0.5 * texel)).rgb;
+}
+
+vec4 sceneColor(vec2 uv)
+{
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    vec4 center = texture(scene, uv);
+    float lumaNW = dot(fxaaSample(uv + vec2(-1.0, -1.0) * texel, texel), LUMA);
+    float lumaNE = dot(fxaaSample(uv + vec2( 1.0, -1.0) * texel, texel), LUMA);
+    float lumaSW = dot(fxaaSample(uv + vec2(-1.0,  1.0) * texel, texel), LUMA);
+    float lumaSE = dot(fxaaSample(uv + vec2( 1.0,  1.0) * texel, texel), LUMA);
+    float lumaM  = dot(center.rgb, LUMA);
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    // 对比度不够的地方不是边缘，直接用原来的颜色，也省掉后面的采样
+    if (lumaMax - lumaMin < max(FXAA_EDGE_THRESHOLD_MIN, lumaMax * FXAA_EDGE_THRESHOLD))
+        return center;
+
+    // 边缘的方向，短的一边被放大到至少一个像素，最长 FXAA_SPAN_MAX 个像素
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (0.25 * FXAA_REDUCE_MUL), FXAA_REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-FXAA_SPAN_MAX), vec2(FXAA_SPAN_MAX)) * texel;
+
+    vec3 rgbA = 0.5 * (fxaaSample(uv + dir * (1.0 / 3.0 - 0.5), texel) + fxaaSample(uv + dir * (2.0 / 3.0 - 0.5), texel));
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (fxaaSample(uv - dir * 0.5, texel) + fxaaSample(uv + dir * 0.5, texel));
+    // 远处的两个样本跨过了别的边缘时只用近处的
+    float lumaB = dot(rgbB, LUMA);
+    if (lumaB < lumaMin || lumaB > lumaMax)
+        return vec4(rgbA, center.a);
+    return vec4(rgbB, center.a);
+}
+#else
+vec4 sceneColor(vec2 uv)
+{
+    return texture(scene, uv);
+}
+#endif
 
 void main()
 {
     // zero out memory since an out variable is initialized with undefined values by default
     color = vec4(0.0f);
+#if defined(CHAOS) || defined(SHAKE)
+    // 使用卷积矩阵的变体才对纹理的偏移像素进行采样
     vec3 sample[9];
-    // 如果使用卷积矩阵，则对纹理的偏移像素进行采样
-    if(chaos || shake)
-        for(int i = 0; i < 9; i++)
-            sample[i] = vec3(texture(scene, TexCoords.st + offsets[i]));
+    for(int i = 0; i < 9; i++)
+        sample[i] = vec3(texture(scene, TexCoords.st + offsets[i]));
+#endif
 
     // 处理特效
-    if(chaos)
-    {
-        for(int i = 0; i < 9; i++)
-            color += vec4(sample[i] * edge_kernel[i], 0.0f);
-        color.a = 1.0f;
-    }
-    else if(confuse)
-    {
-        color = vec4(1.0 - texture(scene, TexCoords).rgb, 1.0);
-    }
-    else if(shake)
-    {
-        for(int i = 0; i < 9; i++)
-            color += vec4(sample[i] * blur_kernel[i], 0.0f);
-        color.a = 1.0f;
-    }
-    else
-    {
-        color =  texture(scene, TexCoords);
-    }
+#if defined(CHAOS)
+    for(int i = 0; i < 9; i++)
+        color += vec4(sample[i] * edge_kernel[i], 0.0f);
+    color.a = 1.0f;
+#elif defined(CONFUSE)
+    color = vec4(1.0 - sceneColor(TexCoords).rgb, 1.0);
+#elif defined(SHAKE)
+    for(int i = 0; i < 9; i++)
+        color += vec4(sample[i] * blur_kernel[i], 0.0f);
+    color.a = 1.0f;
+#else
+    color =  sceneColor(TexCoords);
+#endif
 }
@@ -19,42 +19,111 @@
  shake：轻微晃动场景并附加一个微小的模糊效果。
  shake：反转场景中的颜色并颠倒x轴和y轴。
  chaos: 利用边缘检测卷积核创造有趣的视觉效果，并以圆形旋转动画的形式移动纹理图片，实现“混沌”特效。
+
+ 特效组合在编译时选择：着色器里用 #if defined(CHAOS) 这样的宏代替 uniform bool，
+ 每种组合是一个变体，第一次用到时编译（有程序二进制缓存时直接加载）。
+ 绝大多数帧没有特效，这时上面的步骤全部跳过：场景直接画到默认帧缓冲，抗锯齿用窗口自己的多重采样，
+ 没有解析和全屏四边形。离屏帧缓冲在第一次出现特效时才创建，之后留着给下一次特效用。
+
+ 抗锯齿方式（AntiAliasing）：
+ none/msaa2/msaa4/msaa8：窗口的默认帧缓冲和离屏的多重采样缓冲用同样的采样数，none 时离屏直接画到纹理，不用解析；
+ fxaa：窗口不要多重采样，每帧都画到单采样的离屏纹理，全屏 pass 里加上 FXAA 变体，
+ 和 confuse 一起时先 FXAA 再反色，chaos 和 shake 本身就是卷积，不再做 FXAA。
+
+ 动态分辨率：RenderScale 小于 1 时也走离屏帧缓冲，场景画在 RenderScale 倍输出尺寸的帧缓冲上，
+ 全屏四边形画到输出区域，纹理是线性过滤的，采样的时候就放大了。比例变化时重新分配离屏帧缓冲的存储，
+ 纹理坐标始终是 0 到 1，chaos 的 GL_REPEAT 和 FXAA 的像素偏移都不用改。
+ EndRender 之后视口恢复成输出区域，后面的文字和性能面板按原生分辨率绘制。
  */
 
 #include "post_processor.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
+#include "gpu_profiler.h"
 
+#include <algorithm>
 #include <iostream>
 
-PostProcessor::PostProcessor(Shader shader, GLuint width, GLuint height)
-    : PostProcessingShader(shader), Texture(), Width(width), Height(height), Confuse(GL_FALSE), Chaos(GL_FALSE), Shake(GL_FALSE)
+PostProcessor::PostProcessor(ShaderVariants &shaders, GLuint width, GLuint height, AntiAliasing aa)
+    : PostProcessingShaders(shaders), Texture(), X(0), Y(0), Width(width), Height(height), RenderScale(1.0f), SceneWidth(width), SceneHeight(height), Confuse(GL_FALSE), Chaos(GL_FALSE), Shake(GL_FALSE), AA(aa), MSFBO(0), FBO(0), RBO(0), Offscreen(GL_FALSE)
 {
-    // Initialize renderbuffer/framebuffer object
-    glGenFramebuffers(1, &this->MSFBO);
-    glGenFramebuffers(1, &this->FBO);
-    glGenRenderbuffers(1, &this->RBO);
-    
-    // Initialize renderbuffer storage with a multisampled color buffer (don't need a depth/stencil buffer)
-    glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, this->RBO);
-//    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 8, GL_RGB, width, height); // Allocate storage for render buffer object
-    // 指定 4 个采样点
-    glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGB, width, height); // Allocate storage for render buffer object
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO); // Attach MS render buffer object to framebuffer
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
+    // Initialize render data and uniforms
+    this->initRenderData();
+    this->PostProcessingShaders.Setup = setupShader;
+}
+
+void PostProcessor::initFramebuffers(GLuint width, GLuint height)
+{
+    // 采样数不能超过驱动的上限，超过时按上限创建
+    GLint maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    GLuint samples = std::min(Samples(this->AA), static_cast<GLuint>(maxSamples));
+    if (samples > 1) {
+        // Initialize renderbuffer/framebuffer object
+        if (this->MSFBO == 0) {
+            glGenFramebuffers(1, &this->MSFBO);
+            glGenRenderbuffers(1, &this->RBO);
+        }
+        
+        // Initialize renderbuffer storage with a multisampled color buffer (don't need a depth/stencil buffer)
+        glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, this->RBO);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGB, width, height); // Allocate storage for render buffer object
+        GPUMemory::Track(GPU_RENDERBUFFER, this->RBO, GPUMemory::ImageBytes(GL_RGB, width, height, GL_FALSE, samples));
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->RBO); // Attach MS render buffer object to framebuffer
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
+    }
         
     // Also initialize the FBO/texture to blit multisampled color-buffer to; used for shader operations (for postprocessing effects)
+    // 没有多重采样时场景直接画到这里
+    if (this->FBO == 0)
+        glGenFramebuffers(1, &this->FBO);
     glBindFramebuffer(GL_FRAMEBUFFER, this->FBO);
     this->Texture.Generate(width, height, NULL);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Texture.ID, 0); // Attach texture to framebuffer as its color attachment
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "ERROR::POSTPROCESSOR: Failed to initialize FBO" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    
-    // Initialize render data and uniforms
-    this->initRenderData();
-    this->PostProcessingShader.Use();
-    this->PostProcessingShader.SetInteger("scene", 0, GL_TRUE);
+}
+
+std::vector<std::string> PostProcessor::EffectFeatures()
+{
+    return { "CHAOS", "CONFUSE", "SHAKE", "FXAA" };
+}
+
+GLuint PostProcessor::Samples(AntiAliasing aa)
+{
+    switch (aa) {
+        case AA_MSAA_2: return 2;
+        case AA_MSAA_4: return 4;
+        case AA_MSAA_8: return 8;
+        default: return 0;
+    }
+}
+
+static const GLchar *ANTI_ALIASING_NAMES[] = { "none", "msaa2", "msaa4", "msaa8", "fxaa" };
+
+const GLchar *PostProcessor::AntiAliasingName(AntiAliasing aa)
+{
+    return ANTI_ALIASING_NAMES[aa];
+}
+
+GLboolean PostProcessor::ParseAntiAliasing(const std::string &name, AntiAliasing &aa)
+{
+    for (GLuint i = 0; i <= AA_FXAA; i++) {
+        if (name == ANTI_ALIASING_NAMES[i]) {
+            aa = static_cast<AntiAliasing>(i);
+            return GL_TRUE;
+        }
+    }
+    return GL_FALSE;
+}
+
+void PostProcessor::setupShader(Shader &shader)
+{
+    // 变体里没有用到的 uniform 位置是 -1，设置了也没有影响
+    shader.SetInteger("scene", 0);
     GLfloat offset = 1.0f / 300.0f;
     GLfloat offsets[9][2] = {
         { -offset,  offset  },  // 左上
@@ -67,57 +136,124 @@ PostProcessor::PostProcessor(Shader shader, GLuint width, GLuint height)
         {  0.0f,   -offset  },  // 中下
         {  offset, -offset  }   // 右下
     };
-    glUniform2fv(glGetUniformLocation(this->PostProcessingShader.ID, "offsets"), 9, (GLfloat*)offsets);
+    glUniform2fv(glGetUniformLocation(shader.ID, "offsets"), 9, (GLfloat*)offsets);
     GLint edge_kernel[9] = {
         -1, -1, -1,
         -1,  8, -1,
         -1, -1, -1
     };
-    glUniform1iv(glGetUniformLocation(this->PostProcessingShader.ID, "edge_kernel"), 9, edge_kernel);
+    glUniform1iv(glGetUniformLocation(shader.ID, "edge_kernel"), 9, edge_kernel);
     GLfloat blur_kernel[9] = {
         1.0 / 16, 2.0 / 16, 1.0 / 16,
         2.0 / 16, 4.0 / 16, 2.0 / 16,
         1.0 / 16, 2.0 / 16, 1.0 / 16
     };
-    glUniform1fv(glGetUniformLocation(this->PostProcessingShader.ID, "blur_kernel"), 9, blur_kernel);
+    glUniform1fv(glGetUniformLocation(shader.ID, "blur_kernel"), 9, blur_kernel);
+}
+
+void PostProcessor::Resize(GLint x, GLint y, GLuint width, GLuint height)
+{
+    this->X = x;
+    this->Y = y;
+    this->Width = width;
+    this->Height = height;
+}
+
+PostProcessor::~PostProcessor()
+{
+    GPUMemory::Release(GPU_RENDERBUFFER, this->RBO);
+    GPUMemory::Release(GPU_TEXTURE, this->Texture.ID);
+    GPUMemory::Release(GPU_BUFFER, this->VBO);
+    glDeleteRenderbuffers(1, &this->RBO);
+    glDeleteTextures(1, &this->Texture.ID);
+    glDeleteFramebuffers(1, &this->MSFBO);
+    glDeleteFramebuffers(1, &this->FBO);
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->VBO);
 }
 
 void PostProcessor::BeginRender()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO);
+    PROFILE_SCOPE("PostProcessor::BeginRender");
+    PROFILE_GPU_SCOPE("PostProcessor::Clear");
+    // 内部分辨率至少 1 个像素
+    this->SceneWidth = std::max(1u, static_cast<GLuint>(this->Width * this->RenderScale + 0.5f));
+    this->SceneHeight = std::max(1u, static_cast<GLuint>(this->Height * this->RenderScale + 0.5f));
+    GLboolean scaled = this->SceneWidth != this->Width || this->SceneHeight != this->Height;
+    // 没有特效也不缩放时直接画到默认帧缓冲，FXAA 每帧都要全屏 pass
+    this->Offscreen = this->EffectMask() != 0 || this->AA == AA_FXAA || scaled;
+    if (this->Offscreen) {
+        if (this->FBO == 0 || this->Texture.Width != this->SceneWidth || this->Texture.Height != this->SceneHeight)
+            this->initFramebuffers(this->SceneWidth, this->SceneHeight);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->MSFBO != 0 ? this->MSFBO : this->FBO);
+        glViewport(0, 0, this->SceneWidth, this->SceneHeight);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(this->X, this->Y, this->Width, this->Height);
+    }
+    RenderStats::CountStateChange();
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 void PostProcessor::EndRender()
 {
-    // Now resolve multisampled color-buffer into intermediate FBO to store to texture
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
-    // 位块传输
-    glBlitFramebuffer(0, 0, this->Width, this->Height, 0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    if (!this->Offscreen)
+        return;
+    PROFILE_SCOPE("PostProcessor::EndRender");
+    PROFILE_GPU_SCOPE("PostProcessor::ResolveMSAA");
+    if (this->MSFBO != 0) {
+        // Now resolve multisampled color-buffer into intermediate FBO to store to texture
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->MSFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->FBO);
+        RenderStats::CountStateChange();
+        // 位块传输
+        glBlitFramebuffer(0, 0, this->SceneWidth, this->SceneHeight, 0, 0, this->SceneWidth, this->SceneHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, 0); // Binds both READ and WRITE framebuffer to default framebuffer
+    // 全屏四边形和后面的文字都画在原生分辨率的输出区域
+    glViewport(this->X, this->Y, this->Width, this->Height);
+    RenderStats::CountStateChange();
 }
 
 void PostProcessor::Render(GLfloat time)
 {
-    // Set uniforms/options
-    this->PostProcessingShader.Use();
-    this->PostProcessingShader.SetFloat("time", time);
-    this->PostProcessingShader.SetInteger("confuse", this->Confuse);
-    this->PostProcessingShader.SetInteger("chaos", this->Chaos);
-    this->PostProcessingShader.SetInteger("shake", this->Shake);
+    if (!this->Offscreen)
+        return;
+    GLuint mask = this->EffectMask();
+    if (this->AA == AA_FXAA)
+        mask |= POST_EFFECT_FXAA;
+    PROFILE_SCOPE("PostProcessor::Render");
+    PROFILE_GPU_SCOPE("PostProcessor::Render");
+    // 挑选当前特效组合的变体，只有它需要的 uniform
+    Shader &shader = this->PostProcessingShaders.Get(mask);
+    shader.Use();
+    if (mask & (POST_EFFECT_CHAOS | POST_EFFECT_SHAKE))
+        shader.SetFloat("time", time);
     // Render textured quad
     glActiveTexture(GL_TEXTURE0);
     this->Texture.Bind();
     glBindVertexArray(this->VAO);
+    RenderStats::CountStateChange();
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    RenderStats::CountDraw();
     glBindVertexArray(0);
 }
 
+GLuint PostProcessor::EffectMask() const
+{
+    GLuint mask = 0;
+    if (this->Chaos)
+        mask |= POST_EFFECT_CHAOS;
+    else if (this->Confuse)
+        mask |= POST_EFFECT_CONFUSE;
+    if (this->Shake)
+        mask |= POST_EFFECT_SHAKE;
+    return mask;
+}
+
 void PostProcessor::initRenderData()
 {
     // Configure VAO/VBO
-    GLuint VBO;
     GLfloat vertices[] = {
         // Pos        // Tex
         -1.0f, -1.0f, 0.0f, 0.0f,
@@ -129,10 +265,11 @@ void PostProcessor::initRenderData()
          1.0f,  1.0f, 1.0f, 1.0f
     };
     glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->VBO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    GPUMemory::Track(GPU_BUFFER, this->VBO, sizeof(vertices));
 
     glBindVertexArray(this->VAO);
     glEnableVertexAttribArray(0);
@@ -8,12 +8,35 @@
 #ifndef POST_PROCESSOR_H
 #define POST_PROCESSOR_H
 
+#include <string>
+#include <vector>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "texture.h"
 #include "sprite_renderer.h"
 #include "shader.h"
+#include "shader_variants.h"
+
+// 后期处理特效，也是后期处理着色器变体的特性位，顺序和 PostProcessor::EffectFeatures 一致
+enum PostEffect {
+    POST_EFFECT_CHAOS = 1 << 0,
+    POST_EFFECT_CONFUSE = 1 << 1,
+    POST_EFFECT_SHAKE = 1 << 2,
+    // 不是玩法特效，抗锯齿方式为 AA_FXAA 时在全屏 pass 里做 FXAA
+    POST_EFFECT_FXAA = 1 << 3
+};
+
+// 抗锯齿方式
+enum AntiAliasing {
+    AA_NONE,
+    AA_MSAA_2,
+    AA_MSAA_4,
+    AA_MSAA_8,
+    // 单采样绘制，在后期处理的全屏 pass 里按亮度找边缘做一次 FXAA
+    AA_FXAA
+};
 
 // 后期处理render
 // PostProcessor hosts all PostProcessing effects for the Breakout
@@ -22,30 +45,65 @@
 // Shake boolean.
 // It is required to call BeginRender() before rendering the game
 // and EndRender() after rendering the game for the class to work.
+// 每种特效组合用一个只包含自己代码的着色器变体。
+// 没有特效时场景直接画到默认帧缓冲（窗口自带多重采样），不经过离屏帧缓冲，EndRender 和 Render 什么都不做；
+// 离屏帧缓冲在第一次出现特效时才创建。
+// MSAA 由默认帧缓冲（创建窗口时按 Samples 申请）和离屏的多重采样缓冲提供，采样数相同；
+// FXAA 每帧都走离屏帧缓冲（单采样），在全屏 pass 里做抗锯齿。
+// RenderScale 小于 1 时场景画到按比例缩小的离屏帧缓冲，全屏 pass 用线性过滤放大到输出区域（动态分辨率）。
 class PostProcessor
 {
 public:
     // State
-    Shader PostProcessingShader;
+    ShaderVariants &PostProcessingShaders;
     Texture2D Texture;
+    // 输出区域：场景最后显示在默认帧缓冲里的位置（左下角）和像素尺寸
+    GLint X, Y;
     GLuint Width, Height;
+    // 场景的内部分辨率相对于输出区域的比例，BeginRender 之前设置
+    GLfloat RenderScale;
+    // 本帧场景的内部分辨率，BeginRender 里按 RenderScale 计算
+    GLuint SceneWidth, SceneHeight;
     // Options
     GLboolean Confuse, Chaos, Shake;
+    // 抗锯齿方式，创建后不能再改（窗口的采样数要跟着变）
+    const AntiAliasing AA;
     // Constructor
-    PostProcessor(Shader shader, GLuint width, GLuint height);
+    PostProcessor(ShaderVariants &shaders, GLuint width, GLuint height, AntiAliasing aa = AA_MSAA_4);
+    ~PostProcessor();
+    // 窗口大小变化后更新输出区域，离屏帧缓冲在下次用到时按新的尺寸重新分配
+    void Resize(GLint x, GLint y, GLuint width, GLuint height);
     // Prepares the postprocessor's framebuffer operations before rendering the game
+    // 在这里决定本帧走哪条路径，特效开关要在调用之前设置好
     void BeginRender();
     // Should be called after rendering the game, so it stores all the rendered data into a texture object
     void EndRender();
     // Renders the PostProcessor texture quad (as a screen-encompassing large sprite)
     void Render(GLfloat time);
+    // 当前开启的特效组合（PostEffect 的位掩码），Chaos 和 Confuse 同时开启时只算 Chaos
+    GLuint EffectMask() const;
+    // 本帧是否经过离屏帧缓冲
+    GLboolean IsOffscreen() const { return this->Offscreen; }
+    // 变体的特性宏名，加载后期处理着色器时传给 ResourceManager::LoadShaderVariants
+    static std::vector<std::string> EffectFeatures();
+    // 抗锯齿方式的多重采样数，不用多重采样时是 0，创建窗口时用它设置 GLFW_SAMPLES
+    static GLuint Samples(AntiAliasing aa);
+    // 抗锯齿方式的名字：none、msaa2、msaa4、msaa8、fxaa
+    static const GLchar *AntiAliasingName(AntiAliasing aa);
+    // 按名字解析抗锯齿方式，名字不认识时返回 false，aa 不变
+    static GLboolean ParseAntiAliasing(const std::string &name, AntiAliasing &aa);
 private:
     // Render state
     GLuint MSFBO, FBO; // MSFBO = Multisampled FBO. FBO is regular, used for blitting MS color-buffer to texture
     GLuint RBO; // RBO is used for multisampled color buffer
-    GLuint VAO;
+    GLuint VAO, VBO;
+    GLboolean Offscreen;
     // Initialize quad for rendering postprocessing texture
     void initRenderData();
+    // 创建离屏帧缓冲和解析用的纹理，有多重采样时才创建多重采样帧缓冲；已经创建过时按新的尺寸重新分配存储
+    void initFramebuffers(GLuint width, GLuint height);
+    // 设置变体里不随帧变化的 uniform
+    static void setupShader(Shader &shader);
 };
 
 #endif
@@ -0,0 +1,83 @@
+//
+//  render_scale_controller.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "render_scale_controller.h"
+#include "gpu_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// 平滑系数，越小越不容易被单帧的尖刺带偏
+static const GLfloat SMOOTHING = 0.2f;
+// 调整后的目标是预算的 90%，留一点余量给波动
+static const GLfloat HEADROOM = 0.9f;
+// 至少平滑这么多帧才判断升档
+static const GLuint MIN_SAMPLES = 4;
+// 连续超出预算这么多帧才降档
+static const GLuint OVER_BUDGET_FRAMES = 8;
+// 改变比例之后忽略的帧数，GPU 计时读回有延迟
+static const GLuint SETTLE_FRAMES = GPUProfiler::FrameLatency + 2;
+
+RenderScaleController::RenderScaleController(GLfloat targetMilliseconds, GLfloat minScale, GLfloat maxScale, GLfloat step)
+    : Enabled(GL_TRUE), TargetMilliseconds(targetMilliseconds), MinScale(minScale), MaxScale(maxScale), Step(step), Scale(maxScale), Changes(0), Smoothed(0.0f), Samples(0), OverBudget(0), Settle(0)
+{
+
+}
+
+GLfloat RenderScaleController::quantize(GLfloat scale) const
+{
+    // 加一点余量，0.85 / 0.05 算出来是 16.999 时不要落到 0.8
+    GLfloat steps = std::floor(scale / this->Step + 1e-3f);
+    return std::min(this->MaxScale, std::max(this->MinScale, steps * this->Step));
+}
+
+void RenderScaleController::SetFixed(GLfloat scale)
+{
+    this->Enabled = GL_FALSE;
+    this->Scale = this->quantize(scale);
+}
+
+void RenderScaleController::Update(GLfloat frameMilliseconds)
+{
+    if (!this->Enabled) {
+        return;
+    }
+    if (this->Settle > 0) {
+        this->Settle--;
+        return;
+    }
+    if (frameMilliseconds <= 0.0f) {
+        return;
+    }
+    this->Smoothed = this->Samples == 0 ? frameMilliseconds : this->Smoothed + (frameMilliseconds - this->Smoothed) * SMOOTHING;
+    this->OverBudget = frameMilliseconds > this->TargetMilliseconds ? this->OverBudget + 1 : 0;
+    if (++this->Samples < MIN_SAMPLES) {
+        return;
+    }
+
+    GLfloat scale = this->Scale;
+    GLfloat target = this->TargetMilliseconds * HEADROOM;
+    if (this->OverBudget >= OVER_BUDGET_FRAMES) {
+        // 超出预算：估算降到预算以内的比例，至少降一档
+        scale = this->quantize(std::min(this->Scale * std::sqrt(target / this->Smoothed), this->Scale - this->Step));
+    } else if (this->OverBudget == 0 && this->Scale < this->MaxScale) {
+        // 升一档之后的耗时估算也在预算以内才升
+        GLfloat next = this->quantize(this->Scale + this->Step);
+        GLfloat growth = next / this->Scale;
+        if (this->Smoothed * growth * growth < target) {
+            scale = next;
+        }
+    }
+    if (std::fabs(scale - this->Scale) < this->Step * 0.5f) {
+        return;
+    }
+    this->Scale = scale;
+    this->Changes++;
+    this->Settle = SETTLE_FRAMES;
+    this->Samples = 0;
+    this->OverBudget = 0;
+}
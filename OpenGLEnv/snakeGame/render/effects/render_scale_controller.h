@@ -0,0 +1,46 @@
+//
+//  render_scale_controller.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef RENDER_SCALE_CONTROLLER_H
+#define RENDER_SCALE_CONTROLLER_H
+
+#include <glad/glad.h>
+
+// 动态分辨率：按测到的帧耗时和预算调整场景的渲染比例（PostProcessor::RenderScale）
+// 填充的代价大致和像素数成正比，也就是比例的平方。连续几帧超出预算时按 sqrt(预算 / 耗时) 一次降到位，
+// 单独一帧的尖刺（编译着色器变体、上传纹理）不会让比例降下来；
+// 升的时候每次只升一档，并且要估算升档后还在预算以内才升，降得快升得慢，不会来回跳。
+// GPU 计时要晚 GPUProfiler::FrameLatency 帧才读回，改变比例之后的几帧测到的还是旧比例，这几帧不参与判断。
+// 比例按 Step 取整，离屏帧缓冲只在比例变化时重新分配。
+class RenderScaleController
+{
+public:
+    GLboolean   Enabled;// 为 false 时比例保持不变
+    GLfloat     TargetMilliseconds;// 每帧的预算
+    GLfloat     MinScale, MaxScale;
+    GLfloat     Step;// 比例的档位
+    GLfloat     Scale;// 当前比例
+    GLuint      Changes;// 比例改变的次数
+
+    RenderScaleController(GLfloat targetMilliseconds = 1000.0f / 60.0f, GLfloat minScale = 0.5f, GLfloat maxScale = 1.0f, GLfloat step = 0.05f);
+
+    // 每帧渲染之后调用一次，传入测到的帧耗时，0 表示这一帧还没有测量结果
+    void Update(GLfloat frameMilliseconds);
+    // 比例固定为 scale（按档位取整），关闭自动调整
+    void SetFixed(GLfloat scale);
+
+private:
+    GLfloat Smoothed;// 平滑后的帧耗时
+    GLuint  Samples;// 上次改变比例之后参与平滑的帧数
+    GLuint  OverBudget;// 连续超出预算的帧数
+    GLuint  Settle;// 还要忽略的帧数
+
+    // 向下取整到档位，并限制在 [MinScale, MaxScale]
+    GLfloat quantize(GLfloat scale) const;
+};
+
+#endif /* render_scale_controller_h */
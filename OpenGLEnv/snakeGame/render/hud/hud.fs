@@ -0,0 +1,8 @@
+#version 330 core
+in vec4 Color;
+out vec4 color;
+
+void main()
+{
+    color = Color;
+}
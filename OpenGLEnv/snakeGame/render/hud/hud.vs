@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec2 vertex; // <vec2 position>
+layout (location = 1) in vec4 vertexColor;
+
+out vec4 Color;
+
+uniform mat4 projection;
+
+void main()
+{
+    Color = vertexColor;
+    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+}
@@ -0,0 +1,205 @@
+//
+//  perf_hud.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/30.
+//
+
+#include "perf_hud.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "text_renderer.h"
+#include "render_stats.h"
+#include "gpu_profiler.h"
+#include "allocation_stats.h"
+#include "gpu_memory.h"
+
+// 图表位置和大小，纵轴 0 到 GRAPH_MAX_MS 毫秒
+static const glm::vec2 GRAPH_ORIGIN(10.0f, 40.0f);
+static const GLfloat GRAPH_HEIGHT = 60.0f;
+static const GLfloat GRAPH_MAX_MS = 33.3f;
+// 背景的宽度，比图表宽，放得下最长的一行文字
+static const GLfloat PANEL_WIDTH = 400.0f;
+
+// 进程占用的物理内存
+static uint64_t ResidentBytes()
+{
+#ifdef __APPLE__
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#else
+    unsigned long size = 0, resident = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(file);
+    return static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+PerfHud::PerfHud(Shader shader, GLuint width, GLuint height) : shader(shader), History(), FrameCount(0), LastAllocations(AllocationStats::Now().Count)
+{
+    this->shader.Use();
+    this->shader.SetMatrix4("projection", glm::ortho(0.0f, static_cast<GLfloat>(width), static_cast<GLfloat>(height), 0.0f, -1.0f, 1.0f));
+    
+    glGenVertexArrays(1, &this->VAO);
+    glGenBuffers(1, &this->VBO);
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Color));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    
+    this->Sorted.reserve(HistorySize);
+}
+
+PerfHud::~PerfHud()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    GPUMemory::Release(GPU_BUFFER, this->VBO);
+    glDeleteBuffers(1, &this->VBO);
+}
+
+void PerfHud::Record(GLfloat frameMilliseconds, GLfloat cpuMilliseconds)
+{
+    PerfFrame &frame = this->History[this->FrameCount % HistorySize];
+    frame.FrameMilliseconds = frameMilliseconds;
+    frame.CPUMilliseconds = cpuMilliseconds;
+    frame.GPUMilliseconds = static_cast<GLfloat>(GPUProfiler::LastFrameMilliseconds());
+    frame.DrawCalls = RenderStats::DrawCalls;
+    frame.StateChanges = RenderStats::StateChanges;
+    frame.Instances = RenderStats::Instances;
+    frame.UploadedBytes = RenderStats::UploadedBytes();
+    uint64_t allocations = AllocationStats::Now().Count;
+    frame.Allocations = allocations - this->LastAllocations;
+    this->LastAllocations = allocations;
+    this->FrameCount++;
+}
+
+void PerfHud::AddQuad(glm::vec2 min, glm::vec2 max, glm::vec4 color)
+{
+    // 和精灵四边形一样的顶点顺序，开启背面剔除时也能看到
+    Vertex vertices[6] = {
+        { glm::vec2(min.x, max.y), color },
+        { glm::vec2(max.x, min.y), color },
+        { glm::vec2(min.x, min.y), color },
+        { glm::vec2(min.x, max.y), color },
+        { glm::vec2(max.x, max.y), color },
+        { glm::vec2(max.x, min.y), color }
+    };
+    this->Vertices.insert(this->Vertices.end(), vertices, vertices + 6);
+}
+
+GLfloat PerfHud::Percentile(GLuint count, GLfloat percentile)
+{
+    this->Sorted.clear();
+    for (GLuint i = 0; i < count; i++) {
+        this->Sorted.push_back(this->History[(this->FrameCount - 1 - i) % HistorySize].FrameMilliseconds);
+    }
+    std::vector<GLfloat>::iterator nth = this->Sorted.begin() + static_cast<GLuint>(percentile * (count - 1));
+    std::nth_element(this->Sorted.begin(), nth, this->Sorted.end());
+    return *nth;
+}
+
+void PerfHud::Draw(TextRenderer &text, const PerfCounts &counts)
+{
+    GLuint count = std::min(this->FrameCount, HistorySize);
+    if (count == 0) {
+        return;
+    }
+    
+    // 固定的几行加上有内存占用的子系统，每个一行
+    const GLfloat lineHeight = 15.0f, scale = 0.5f;
+    GLuint lines = 8;
+    for (GLuint i = 0; i < MEMORY_TAG_COUNT; i++) {
+        MemoryTag tag = static_cast<MemoryTag>(i);
+        if (MemoryTags::Stats(tag).Bytes > 0 || GPUMemory::Bytes(tag) > 0) {
+            lines++;
+        }
+    }
+    
+    /// 图表：背景、16.7ms 参考线、每帧一列，CPU 是柱子，GPU 是点
+    this->Vertices.clear();
+    glm::vec2 graphMax = GRAPH_ORIGIN + glm::vec2(HistorySize, GRAPH_HEIGHT);
+    AddQuad(GRAPH_ORIGIN - glm::vec2(5.0f), glm::vec2(GRAPH_ORIGIN.x + PANEL_WIDTH, graphMax.y + 10.0f + lines * lineHeight), glm::vec4(0.0f, 0.0f, 0.0f, 0.6f));
+    GLfloat pixelsPerMs = GRAPH_HEIGHT / GRAPH_MAX_MS;
+    for (GLuint i = 0; i < count; i++) {
+        // 最新的一帧在最右边
+        const PerfFrame &frame = this->History[(this->FrameCount - 1 - i) % HistorySize];
+        GLfloat x = graphMax.x - 1.0f - i;
+        GLfloat cpu = std::min(frame.CPUMilliseconds, GRAPH_MAX_MS) * pixelsPerMs;
+        GLfloat gpu = std::min(frame.GPUMilliseconds, GRAPH_MAX_MS) * pixelsPerMs;
+        AddQuad(glm::vec2(x, graphMax.y - cpu), glm::vec2(x + 1.0f, graphMax.y), glm::vec4(0.3f, 0.9f, 0.3f, 0.9f));
+        AddQuad(glm::vec2(x, graphMax.y - gpu - 1.0f), glm::vec2(x + 1.0f, graphMax.y - gpu + 1.0f), glm::vec4(1.0f, 0.6f, 0.1f, 1.0f));
+    }
+    GLfloat budget = graphMax.y - 1000.0f / 60.0f * pixelsPerMs;
+    AddQuad(glm::vec2(GRAPH_ORIGIN.x, budget), glm::vec2(graphMax.x, budget + 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 0.5f));
+    
+    this->shader.Use();
+    glBindVertexArray(this->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    glBufferData(GL_ARRAY_BUFFER, this->Vertices.size() * sizeof(Vertex), this->Vertices.data(), GL_STREAM_DRAW);
+    RenderStats::CountBufferUpload(this->Vertices.size() * sizeof(Vertex));
+    GPUMemory::Track(GPU_BUFFER, this->VBO, this->Vertices.size() * sizeof(Vertex));
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(this->Vertices.size()));
+    RenderStats::CountDraw();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    
+    /// 文字
+    const PerfFrame &last = this->History[(this->FrameCount - 1) % HistorySize];
+    char line[128];
+    GLfloat y = graphMax.y + 6.0f;
+    glm::vec3 color(1.0f);
+    
+    snprintf(line, sizeof(line), "frame p50 %.1f ms  p99 %.1f ms", Percentile(count, 0.5f), Percentile(count, 0.99f));
+    text.RenderText(line, GRAPH_ORIGIN.x, y, scale, color);
+    snprintf(line, sizeof(line), "cpu %.2f ms  gpu %.2f ms", last.CPUMilliseconds, last.GPUMilliseconds);
+    text.RenderText(line, GRAPH_ORIGIN.x, y += lineHeight, scale, color);
+    snprintf(line, sizeof(line), "draws %llu  states %llu  instances %llu", (unsigned long long)last.DrawCalls, (unsigned long long)last.StateChanges, (unsigned long long)last.Instances);
+    text.RenderText(line, GRAPH_ORIGIN.x, y += lineHeight, scale, color);
+    snprintf(line, sizeof(line), "upload %.1f KB  allocs %llu (%llu unexpected, %llu warnings)", last.UploadedBytes / 1024.0, (unsigned long long)last.Allocations, (unsigned long long)FrameAllocationCheck::LastUnexpected(), (unsigned long long)FrameAllocationCheck::Warnings());
+    text.RenderText(line, GRAPH_ORIGIN.x, y += lineHeight, scale, color);
+    snprintf(line, sizeof(line), "particles %u  foods %u  nodes %u", counts.Particles, counts.Foods, counts.Nodes);
+    text.RenderText(line, GRAPH_ORIGIN.x, y += lineHeight, scale, color);
+    snprintf(line, sizeof(line), "render scale %.2f  %ux%u", counts.RenderScale, counts.SceneWidth, counts.SceneHeight);
+    text.RenderText(line, GRAPH_ORIGIN.x, y += lineHeight, scale, color);
+    
+    /// 内存：进程占用、堆、显存账本，然后是各个子系统
+    const GLdouble MB = 1024.0 * 1024.0;
+    snprintf(line, sizeof(line), "memory %.1f MB  heap %.1f MB  gpu %.1f MB", ResidentBytes() / MB, MemoryTags::TotalBytes() / MB, GPUMemory::TotalBytes() / MB);
+    text.RenderText(line, GRAPH_ORIGIN.x, y += lineHeight, scale, color);
+    snprintf(line, sizeof(line), "gpu tex %.1f MB (%u)  buf %.1f MB (%u)  rb %.1f MB", GPUMemory::Bytes(GPU_TEXTURE) / MB, GPUMemory::Count(GPU_TEXTURE), GPUMemory::Bytes(GPU_BUFFER) / MB, GPUMemory::Count(GPU_BUFFER), GPUMemory::Bytes(GPU_RENDERBUFFER) / MB);
+    text.RenderText(line, GRAPH_ORIGIN.x, y += lineHeight, scale, color);
+    for (GLuint i = 0; i < MEMORY_TAG_COUNT; i++) {
+        MemoryTag tag = static_cast<MemoryTag>(i);
+        MemoryTagStats stats = MemoryTags::Stats(tag);
+        uint64_t gpuBytes = GPUMemory::Bytes(tag);
+        if (stats.Bytes == 0 && gpuBytes == 0) {
+            continue;
+        }
+        snprintf(line, sizeof(line), "  %-11s cpu %7.1f KB  gpu %7.1f KB", MemoryTags::Name(tag), stats.Bytes / 1024.0, gpuBytes / 1024.0);
+        text.RenderText(line, GRAPH_ORIGIN.x, y += lineHeight, scale, color);
+    }
+}
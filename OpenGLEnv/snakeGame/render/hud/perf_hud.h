@@ -0,0 +1,79 @@
+//
+//  perf_hud.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/30.
+//
+
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+class TextRenderer;
+
+// 一帧的性能数据
+struct PerfFrame {
+    GLfloat     FrameMilliseconds;// 和上一帧开始的间隔
+    GLfloat     CPUMilliseconds;// Game::Render 的 CPU 耗时
+    GLfloat     GPUMilliseconds;// GPU 耗时（几帧之前读回的）
+    uint64_t    DrawCalls;
+    uint64_t    StateChanges;
+    uint64_t    Instances;
+    uint64_t    UploadedBytes;
+    uint64_t    Allocations;// 这一帧的堆分配次数（所有线程）
+};
+
+// 画面里要显示的物体数量，由快照提供
+struct PerfCounts {
+    GLuint      Particles;// 活着的粒子
+    GLuint      Foods;
+    GLuint      Nodes;// 所有蛇的节点
+    GLfloat     RenderScale;// 动态分辨率的渲染比例
+    GLuint      SceneWidth, SceneHeight;// 场景的内部分辨率
+};
+
+// 屏幕上的性能面板
+// 每帧 Record 只把几个数字写进环形数组（隐藏时也记录，打开时马上能看到历史），
+// 百分位、内存和图表都只在 Draw 时计算。
+// 图表是一批彩色四边形，一次 glBufferData 一次 glDrawArrays；文字用 TextRenderer。
+class PerfHud
+{
+public:
+    // 保留的帧数，也是图表的宽度（像素）
+    static const GLuint HistorySize = 240;
+
+    PerfHud(Shader shader, GLuint width, GLuint height);
+    ~PerfHud();
+
+    // 记录一帧，RenderStats 要在这之后清零
+    void Record(GLfloat frameMilliseconds, GLfloat cpuMilliseconds);
+    // 绘制面板
+    void Draw(TextRenderer &text, const PerfCounts &counts);
+
+private:
+    struct Vertex {
+        glm::vec2 Position;
+        glm::vec4 Color;
+    };
+
+    Shader                  shader;
+    GLuint                  VAO, VBO;
+    PerfFrame               History[HistorySize];
+    GLuint                  FrameCount;// 记录过的总帧数
+    uint64_t                LastAllocations;
+    std::vector<Vertex>     Vertices;// 每次绘制复用
+    std::vector<GLfloat>    Sorted;// 计算百分位用
+
+    void AddQuad(glm::vec2 min, glm::vec2 max, glm::vec4 color);
+    // 最近几帧里帧间隔的百分位，percentile 在 [0, 1]
+    GLfloat Percentile(GLuint count, GLfloat percentile);
+};
+
+#endif /* perf_hud_h */
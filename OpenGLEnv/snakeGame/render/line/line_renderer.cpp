@@ -6,6 +6,9 @@
 //
 
 #include "line_renderer.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
+#include "profiler.h"
 
 LineRenderer::LineRenderer(Shader &shader)
 {
@@ -16,10 +19,13 @@ LineRenderer::LineRenderer(Shader &shader)
 LineRenderer::~LineRenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    GPUMemory::Release(GPU_BUFFER, this->quadVBO);
+    glDeleteBuffers(1, &this->quadVBO);
 }
 
 void LineRenderer::DrawLine(glm::vec2 position, glm::float_t length, GLboolean horizontal, glm::float_t rotate, glm::vec4 color)
 {
+    PROFILE_SCOPE("LineRenderer::DrawLine");
     // prepare transformations
     this->shader.Use();
     glm::mat4 model = glm::mat4(1.0f);
@@ -37,6 +43,7 @@ void LineRenderer::DrawLine(glm::vec2 position, glm::float_t length, GLboolean h
     this->shader.SetVector4f("spriteColor", color);
 
     glBindVertexArray(this->quadVAO);
+    RenderStats::CountStateChange();
     glLineWidth(0.2f);
     glEnable(GL_LINE_SMOOTH);
     
@@ -45,6 +52,7 @@ void LineRenderer::DrawLine(glm::vec2 position, glm::float_t length, GLboolean h
     } else {
         glDrawArrays(GL_LINES, 2, 2);
     }
+    RenderStats::CountDraw();
     
     glLineWidth(1.0f);
     glDisable(GL_LINE_SMOOTH);
@@ -54,7 +62,6 @@ void LineRenderer::DrawLine(glm::vec2 position, glm::float_t length, GLboolean h
 void LineRenderer::initRenderData()
 {
     // configure VAO/VBO
-    unsigned int VBO;
     float vertices[] = {
         // pos
         // 位置
@@ -78,10 +85,11 @@ void LineRenderer::initRenderData()
      */
     
     glGenVertexArrays(1, &this->quadVAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    GPUMemory::Track(GPU_BUFFER, this->quadVBO, sizeof(vertices));
 
     glBindVertexArray(this->quadVAO);
     glEnableVertexAttribArray(0);
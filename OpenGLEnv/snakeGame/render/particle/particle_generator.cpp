@@ -6,26 +6,60 @@
 //
 
 #include "particle_generator.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
+#include "profiler.h"
 
 ParticleGenerator::ParticleGenerator(Shader shader, Texture2D texture, GLuint amount)
-    : shader(shader), texture(texture), amount(amount)
+    : amount(amount), random(1, RANDOM_STREAM_PARTICLES), shader(shader), texture(texture), VAO(0), VBO(0)
 {
-    this->init();
+    // Create this->amount default particle instances
+    for (GLuint i = 0; i < this->amount; ++i)
+        this->particles.push_back(Particle());
+}
+
+ParticleGenerator::~ParticleGenerator()
+{
+    // 渲染数据在第一次绘制时才创建，只做模拟时没有 OpenGL 上下文，也不能调用 OpenGL 函数
+    if (this->VAO == 0) {
+        return;
+    }
+    glDeleteVertexArrays(1, &this->VAO);
+    GPUMemory::Release(GPU_BUFFER, this->VBO);
+    glDeleteBuffers(1, &this->VBO);
 }
 
 /**
  在每一帧里面，我们都会用一个起始变量来产生一些新的粒子并且对每个粒子（还活着的）更新它们的值。
  */
-void ParticleGenerator::Update(GLfloat dt, GameObject &object, GLuint newParticles, glm::vec2 offset)
+void ParticleGenerator::Update(GLfloat dt, GameObject &object, GLuint newParticles, glm::vec2 offset, JobSystem *jobs)
 {
+    PROFILE_SCOPE("ParticleGenerator::Update");
     // Add new particles
+    // 新粒子需要的随机数一次生成
+    this->spawnRandoms.resize(newParticles * 2);
+    this->random.FillFloat(this->spawnRandoms.data(), newParticles * 2);
     for (GLuint i = 0; i < newParticles; ++i)
     {
         int unusedParticle = this->firstUnusedParticle();
-        this->respawnParticle(this->particles[unusedParticle], object, offset);
+        this->respawnParticle(this->particles[unusedParticle], object, &this->spawnRandoms[i * 2], offset);
     }
     // Update all particles
-    for (GLuint i = 0; i < this->amount; ++i)
+    if (jobs)
+    {
+        jobs->ParallelFor(this->amount, 256, [this, dt](GLuint begin, GLuint end) {
+            this->updateParticles(dt, begin, end);
+        });
+    }
+    else
+    {
+        this->updateParticles(dt, 0, this->amount);
+    }
+}
+
+void ParticleGenerator::updateParticles(GLfloat dt, GLuint begin, GLuint end)
+{
+    for (GLuint i = begin; i < end; ++i)
     {
         Particle &p = this->particles[i];
         p.Life -= dt; // reduce life
@@ -38,18 +72,38 @@ void ParticleGenerator::Update(GLfloat dt, GameObject &object, GLuint newParticl
     }
 }
 
+void ParticleGenerator::Seed(GLuint seed)
+{
+    this->random.Seed(seed, RANDOM_STREAM_PARTICLES);
+}
+
 // Render all particles
 void ParticleGenerator::Draw()
 {
+    this->Draw(this->particles);
+}
+
+const std::vector<Particle> &ParticleGenerator::GetParticles() const
+{
+    return this->particles;
+}
+
+void ParticleGenerator::Draw(const std::vector<Particle> &particles)
+{
+    PROFILE_SCOPE("ParticleGenerator::Draw");
     /**
      对于每个粒子，我们一一设置他们的uniform变量offse和color，绑定纹理，然后渲染2D四边形的粒子
      
      我们在这看到了两次调用函数glBlendFunc。当要渲染这些粒子的时候，我们使用GL_ONE替换默认的目的因子模式GL_ONE_MINUS_SRC_ALPHA，这样，这些粒子叠加在一起的时候就会产生一些平滑的发热效果，就像在这个教程前面那样使用混合模式来渲染出火焰的效果也是可以的，这样在有大多数粒子的中心就会产生更加灼热的效果。
      */
     // Use additive blending to give it a 'glow' effect
+    // 渲染数据在第一次绘制时才创建，只做模拟时不需要 OpenGL
+    if (this->VAO == 0)
+        this->init();
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    RenderStats::CountStateChange();
     this->shader.Use();
-    for (Particle particle : this->particles)
+    for (const Particle &particle : particles)
     {
         if (particle.Life > 0.0f)
         {
@@ -57,18 +111,20 @@ void ParticleGenerator::Draw()
             this->shader.SetVector4f("color", particle.Color);
             this->texture.Bind();
             glBindVertexArray(this->VAO);
+            RenderStats::CountStateChange();
             glDrawArrays(GL_TRIANGLES, 0, 6);
+            RenderStats::CountDraw();
             glBindVertexArray(0);
         }
     }
     // Don't forget to reset to default blending mode
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    RenderStats::CountStateChange();
 }
 
 void ParticleGenerator::init()
 {
     // Set up mesh and attribute properties
-    GLuint VBO;
     GLfloat particle_quad[] = {
         // 位置      // 纹理坐标
         0.0f, 1.0f, 0.0f, 1.0f,
@@ -93,19 +149,16 @@ void ParticleGenerator::init()
                y
      */
     glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->VBO);
     glBindVertexArray(this->VAO);
     // Fill mesh buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(particle_quad), particle_quad, GL_STATIC_DRAW);
+    GPUMemory::Track(GPU_BUFFER, this->VBO, sizeof(particle_quad));
     // Set mesh attributes
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
     glBindVertexArray(0);
-
-    // Create this->amount default particle instances
-    for (GLuint i = 0; i < this->amount; ++i)
-        this->particles.push_back(Particle());
 }
 
 
@@ -135,15 +188,15 @@ GLuint ParticleGenerator::firstUnusedParticle()
     return 0;
 }
 
-void ParticleGenerator::respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset)
+void ParticleGenerator::respawnParticle(Particle &particle, GameObject &object, const GLfloat *randoms, glm::vec2 offset)
 {
     /**
      一旦粒子数组中第一个消亡的粒子被发现的时候，我们就通过调用RespawnParticle函数更新它的值，函数接受一个Particle对象，一个GameObject对象和一个offset向量:
      */
-    GLfloat random = ((rand() % 100) - 50) / 10.0f;// [0, 99] => [-50, 49] => [-5, 4.9]
+    GLfloat random = randoms[0] * 10.0f - 5.0f;// [0, 1) => [-5, 5)
     particle.Position = object.Position + random + offset;
     
-    GLfloat rColor = 0.5 + ((rand() % 100) / 100.0f);// 0.5 + [0, 99] / 100 => 0.5 + [0, 0.99] => [0.5, 1.49]
+    GLfloat rColor = 0.5 + randoms[1];// 0.5 + [0, 1) => [0.5, 1.5)
     particle.Color = glm::vec4(rColor, rColor, rColor, 1.0f);
     
     particle.Life = 1.0f;
@@ -15,6 +15,8 @@
 #include "shader.h"
 #include "texture.h"
 #include "game_object.h"
+#include "job_system.h"
+#include "random_stream.h"
 
 // 粒子发射器render
 // Represents a single particle and its state
@@ -35,24 +37,37 @@ class ParticleGenerator
 public:
     // Constructor
     ParticleGenerator(Shader shader, Texture2D texture, GLuint amount);
+    ~ParticleGenerator();
     // Update all particles
-    void Update(GLfloat dt, GameObject &object, GLuint newParticles, glm::vec2 offset = glm::vec2(0.0f));
+    // 传入 jobs 时，粒子的位置和颜色分段并行更新（每个粒子互不影响），新粒子仍然在当前线程生成
+    void Update(GLfloat dt, GameObject &object, GLuint newParticles, glm::vec2 offset = glm::vec2(0.0f), JobSystem *jobs = nullptr);
+    // 设置随机数种子，相同的种子生成相同的粒子
+    void Seed(GLuint seed);
     // Render all particles
     void Draw();
+    // 渲染指定的粒子（比如渲染快照里的粒子）
+    void Draw(const std::vector<Particle> &particles);
+    // 当前所有粒子的状态
+    const std::vector<Particle> &GetParticles() const;
 private:
     // State
     std::vector<Particle> particles;
     GLuint amount;
+    RandomStream random;// 新粒子的位置偏移和颜色
+    std::vector<GLfloat> spawnRandoms;// 每次更新批量生成的随机数，每个新粒子两个
     // Render state
     Shader shader;
     Texture2D texture;
-    GLuint VAO;
+    GLuint VAO, VBO;
     // Initializes buffer and vertex attributes
     void init();
     // Returns the first Particle index that's currently unused e.g. Life <= 0.0f or 0 if no particle is currently inactive
     GLuint firstUnusedParticle();
     // Respawns particle
-    void respawnParticle(Particle &particle, GameObject &object, glm::vec2 offset = glm::vec2(0.0f));
+    // randoms 是两个 [0, 1) 的随机数，分别决定位置偏移和颜色
+    void respawnParticle(Particle &particle, GameObject &object, const GLfloat *randoms, glm::vec2 offset = glm::vec2(0.0f));
+    // Updates particles in [begin, end)
+    void updateParticles(GLfloat dt, GLuint begin, GLuint end);
 };
 
 #endif
@@ -6,6 +6,9 @@
 //
 
 #include "sprite_renderer.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
+#include "profiler.h"
 
 SpriteRenderer::SpriteRenderer(Shader &shader)
 {
@@ -16,10 +19,13 @@ SpriteRenderer::SpriteRenderer(Shader &shader)
 SpriteRenderer::~SpriteRenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    GPUMemory::Release(GPU_BUFFER, this->quadVBO);
+    glDeleteBuffers(1, &this->quadVBO);
 }
 
 void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, glm::vec4 color, float rotate, glm::quat rotationQuat)
 {
+    PROFILE_SCOPE("SpriteRenderer::DrawSprite");
     // prepare transformations
     this->shader.Use();
     glm::mat4 model = glm::mat4(1.0f);
@@ -52,14 +58,15 @@ void SpriteRenderer::DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec
     texture.Bind();
     
     glBindVertexArray(this->quadVAO);
+    RenderStats::CountStateChange();
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    RenderStats::CountDraw();
     glBindVertexArray(0);
 }
 
 void SpriteRenderer::initRenderData()
 {
     // configure VAO/VBO
-    unsigned int VBO;
     float vertices[] = {
         // pos             // tex
         // 位置            // 纹理坐标
@@ -87,10 +94,11 @@ void SpriteRenderer::initRenderData()
      */
     
     glGenVertexArrays(1, &this->quadVAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    GPUMemory::Track(GPU_BUFFER, this->quadVBO, sizeof(vertices));
 
     glBindVertexArray(this->quadVAO);
     glEnableVertexAttribArray(0);
@@ -31,6 +31,7 @@ private:
     // Render state
     Shader       shader;
     unsigned int quadVAO;
+    unsigned int quadVBO;
     // Initializes and configures the quad's buffer and vertex attributes
     void initRenderData();
 };
@@ -0,0 +1,128 @@
+//
+//  gpu_memory.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "gpu_memory.h"
+#include "allocation_stats.h"
+
+#include <algorithm>
+
+std::unordered_map<GLuint, GPUMemory::Entry>    GPUMemory::Entries[GPU_RESOURCE_KIND_COUNT];
+uint64_t                                        GPUMemory::KindBytes[GPU_RESOURCE_KIND_COUNT] = {0};
+uint64_t                                        GPUMemory::TagBytes[MEMORY_TAG_COUNT] = {0};
+uint64_t                                        GPUMemory::Peak = 0;
+
+GLuint GPUMemory::BytesPerPixel(GLenum internalFormat)
+{
+    switch (internalFormat) {
+        case GL_RED:
+        case GL_R8:
+            return 1;
+        case GL_RG:
+        case GL_RG8:
+        case GL_R16F:
+            return 2;
+        case GL_RGB:
+        case GL_RGB8:
+        case GL_SRGB8:
+        case GL_RGBA:
+        case GL_RGBA8:
+        case GL_SRGB8_ALPHA8:
+        case GL_RGB10_A2:
+        case GL_R11F_G11F_B10F:
+        case GL_R32F:
+        case GL_RG16F:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_RGB16F:
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGB32F:
+        case GL_RGBA32F:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+uint64_t GPUMemory::ImageBytes(GLenum internalFormat, GLuint width, GLuint height, GLboolean mipmaps, GLuint samples)
+{
+    uint64_t pixels = static_cast<uint64_t>(width) * height;
+    if (mipmaps) {
+        // 每一级宽高减半，直到 1x1
+        GLuint w = width, h = height;
+        while (w > 1 || h > 1) {
+            w = std::max(w / 2, 1u);
+            h = std::max(h / 2, 1u);
+            pixels += static_cast<uint64_t>(w) * h;
+        }
+    }
+    return pixels * BytesPerPixel(internalFormat) * std::max(samples, 1u);
+}
+
+void GPUMemory::Track(GPUResourceKind kind, GLuint id, uint64_t bytes)
+{
+    if (id == 0) {
+        return;
+    }
+    std::unordered_map<GLuint, Entry>::iterator it = Entries[kind].find(id);
+    if (it == Entries[kind].end()) {
+        // 新对象第一次登记，账本自己的节点不算意外分配
+        AllowAllocationScope allow;
+        Entry entry;
+        entry.Bytes = 0;
+        entry.Tag = MemoryTags::Current();
+        it = Entries[kind].insert(std::make_pair(id, entry)).first;
+    }
+    Entry &entry = it->second;
+    KindBytes[kind] += bytes - entry.Bytes;
+    TagBytes[entry.Tag] += bytes - entry.Bytes;
+    entry.Bytes = bytes;
+    Peak = std::max(Peak, TotalBytes());
+}
+
+void GPUMemory::Release(GPUResourceKind kind, GLuint id)
+{
+    std::unordered_map<GLuint, Entry>::iterator it = Entries[kind].find(id);
+    if (it == Entries[kind].end()) {
+        return;
+    }
+    KindBytes[kind] -= it->second.Bytes;
+    TagBytes[it->second.Tag] -= it->second.Bytes;
+    Entries[kind].erase(it);
+}
+
+uint64_t GPUMemory::Bytes(GPUResourceKind kind)
+{
+    return KindBytes[kind];
+}
+
+uint64_t GPUMemory::Bytes(MemoryTag tag)
+{
+    return TagBytes[tag];
+}
+
+GLuint GPUMemory::Count(GPUResourceKind kind)
+{
+    return static_cast<GLuint>(Entries[kind].size());
+}
+
+uint64_t GPUMemory::TotalBytes()
+{
+    uint64_t total = 0;
+    for (GLuint i = 0; i < GPU_RESOURCE_KIND_COUNT; i++) {
+        total += KindBytes[i];
+    }
+    return total;
+}
+
+uint64_t GPUMemory::PeakBytes()
+{
+    return Peak;
+}
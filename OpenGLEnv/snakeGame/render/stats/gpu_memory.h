@@ -0,0 +1,62 @@
+//
+//  gpu_memory.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+#include "memory_tags.h"
+
+// GPU 对象的种类
+enum GPUResourceKind {
+    GPU_TEXTURE,
+    GPU_BUFFER,
+    GPU_RENDERBUFFER,
+    GPU_RESOURCE_KIND_COUNT
+};
+
+// GPU 显存账本
+// 引擎创建纹理、缓冲区、渲染缓冲时按格式和大小登记，删除时注销，记在当前线程的内存标签上。
+// OpenGL 查不到显存占用，这里是按格式估算的逻辑大小，驱动的对齐和压缩不算。
+// 和 RenderStats 一样只在有 OpenGL 上下文的线程里调用。
+class GPUMemory
+{
+public:
+    // 每个像素的字节数，RGB 这种 3 字节的格式驱动一般会补成 4 字节
+    static GLuint BytesPerPixel(GLenum internalFormat);
+    // 纹理或渲染缓冲的字节数，mipmaps 为 true 时加上整条 mipmap 链
+    static uint64_t ImageBytes(GLenum internalFormat, GLuint width, GLuint height, GLboolean mipmaps = GL_FALSE, GLuint samples = 1);
+
+    // 登记一个对象，同一个对象重新分配存储时更新大小，标签保持第一次登记时的
+    static void Track(GPUResourceKind kind, GLuint id, uint64_t bytes);
+    // 对象删除前注销
+    static void Release(GPUResourceKind kind, GLuint id);
+
+    static uint64_t Bytes(GPUResourceKind kind);
+    static uint64_t Bytes(MemoryTag tag);
+    static GLuint Count(GPUResourceKind kind);
+    static uint64_t TotalBytes();
+    static uint64_t PeakBytes();
+private:
+    struct Entry {
+        uint64_t    Bytes;
+        MemoryTag   Tag;
+    };
+
+    static std::unordered_map<GLuint, Entry>    Entries[GPU_RESOURCE_KIND_COUNT];
+    static uint64_t                             KindBytes[GPU_RESOURCE_KIND_COUNT];
+    static uint64_t                             TagBytes[MEMORY_TAG_COUNT];
+    static uint64_t                             Peak;
+
+    GPUMemory() { }
+};
+
+#endif /* gpu_memory_h */
@@ -0,0 +1,25 @@
+//
+//  render_stats.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/28.
+//
+
+#include "render_stats.h"
+
+uint64_t RenderStats::DrawCalls = 0;
+uint64_t RenderStats::StateChanges = 0;
+uint64_t RenderStats::Instances = 0;
+uint64_t RenderStats::BufferBytes = 0;
+uint64_t RenderStats::UniformBytes = 0;
+uint64_t RenderStats::TextureBytes = 0;
+
+void RenderStats::Reset()
+{
+    DrawCalls = 0;
+    StateChanges = 0;
+    Instances = 0;
+    BufferBytes = 0;
+    UniformBytes = 0;
+    TextureBytes = 0;
+}
@@ -0,0 +1,42 @@
+//
+//  render_stats.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/28.
+//
+
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// 渲染统计，所有 render 在调用 OpenGL 的地方计数：绘制调用、状态切换、实例数、上传到 GPU 的字节数
+// 只在有 OpenGL 上下文的线程（主线程）里调用，计数是普通整数，开销只是几次加法。
+// 每帧开始时 Reset，帧结束后读出来给基准测试或者性能面板用。
+class RenderStats
+{
+public:
+    static uint64_t DrawCalls;// glDraw* 调用次数
+    static uint64_t StateChanges;// 绘制时切换着色器、纹理、VAO、帧缓冲和混合模式的次数
+    static uint64_t Instances;// 绘制的实例数，不是实例化绘制的算 1 个
+    static uint64_t BufferBytes;// glBufferData / glBufferSubData 上传的字节数
+    static uint64_t UniformBytes;// glUniform* 上传的字节数
+    static uint64_t TextureBytes;// glTexImage2D 上传的字节数
+
+    // 清空所有计数
+    static void Reset();
+    // 上传到 GPU 的总字节数
+    static uint64_t UploadedBytes() { return BufferBytes + UniformBytes + TextureBytes; }
+
+    static void CountDraw(GLuint instances = 1) { DrawCalls++; Instances += instances; }
+    static void CountStateChange() { StateChanges++; }
+    static void CountBufferUpload(uint64_t bytes) { BufferBytes += bytes; }
+    static void CountUniformUpload(uint64_t bytes) { UniformBytes += bytes; }
+    static void CountTextureUpload(uint64_t bytes) { TextureBytes += bytes; }
+private:
+    RenderStats() { }
+};
+
+#endif /* render_stats_h */
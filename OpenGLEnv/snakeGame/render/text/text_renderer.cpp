@@ -5,7 +5,9 @@
 //  Created by karos li on 2021/5/11.
 //
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <ft2build.h>
@@ -13,10 +15,16 @@
 
 #include "text_renderer.h"
 #include "resource_manager.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
+#include "profiler.h"
+#include "vfs.h"
 
 
 TextRenderer::TextRenderer(GLuint width, GLuint height)
+    : PixelRatio(1.0f), FontSize(0)
 {
+    MemoryTagScope tag(MEMORY_TAG_TEXT);
     // Load and configure shader
     this->TextShader = ResourceManager::LoadShader("text_rendering.vs", "text_rendering.fs", nullptr, "text");
     this->TextShader.SetMatrix4("projection", glm::ortho(0.0f, static_cast<GLfloat>(width), static_cast<GLfloat>(height), 0.0f), GL_TRUE);
@@ -27,26 +35,52 @@ TextRenderer::TextRenderer(GLuint width, GLuint height)
     glBindVertexArray(this->VAO);
     glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+    GPUMemory::Track(GPU_BUFFER, this->VBO, sizeof(GLfloat) * 6 * 4);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
+TextRenderer::~TextRenderer()
+{
+    this->clearCharacters();
+    glDeleteVertexArrays(1, &this->VAO);
+    GPUMemory::Release(GPU_BUFFER, this->VBO);
+    glDeleteBuffers(1, &this->VBO);
+}
+
+void TextRenderer::clearCharacters()
+{
+    for (auto &iter : this->Characters) {
+        GPUMemory::Release(GPU_TEXTURE, iter.second.TextureID);
+        glDeleteTextures(1, &iter.second.TextureID);
+    }
+    this->Characters.clear();
+}
+
 void TextRenderer::Load(std::string font, GLuint fontSize)
 {
+    MemoryTagScope tag(MEMORY_TAG_TEXT);
     // First clear the previously loaded Characters
-    this->Characters.clear();
+    // 重新加载时原来的字形纹理也要删掉，否则一直占着显存
+    this->clearCharacters();
+    this->Font = font;
+    this->FontSize = fontSize;
+    // 字形按输出的像素大小光栅化，RenderText 里再除以 PixelRatio 换回文字坐标
+    GLuint pixelSize = std::max(1u, static_cast<GLuint>(fontSize * this->PixelRatio + 0.5f));
     // Then initialize and load the FreeType library
     FT_Library ft;
     if (FT_Init_FreeType(&ft)) // All functions return a value different than 0 whenever an error occurred
         std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
     // Load font as face
+    // 字体文件通过 VFS 读进内存，FreeType 在 FT_Done_Face 之前一直引用这块内存
     FT_Face face;
-    if (FT_New_Face(ft, font.c_str(), 0, &face))
+    std::vector<unsigned char> fontData;
+    if (!VFS::ReadFile(font, fontData) || FT_New_Memory_Face(ft, fontData.data(), static_cast<FT_Long>(fontData.size()), 0, &face))
         std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
     // Set size to load glyphs as
-    FT_Set_Pixel_Sizes(face, 0, fontSize);
+    FT_Set_Pixel_Sizes(face, 0, pixelSize);
     // Disable byte-alignment restriction
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     // Then for the first 128 ASCII characters, pre-load/compile their characters and store them
@@ -73,6 +107,8 @@ void TextRenderer::Load(std::string font, GLuint fontSize)
             GL_UNSIGNED_BYTE,
             face->glyph->bitmap.buffer
             );
+        RenderStats::CountTextureUpload(face->glyph->bitmap.width * face->glyph->bitmap.rows);
+        GPUMemory::Track(GPU_TEXTURE, texture, GPUMemory::ImageBytes(GL_RED, face->glyph->bitmap.width, face->glyph->bitmap.rows));
         // Set texture options
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -94,17 +130,36 @@ void TextRenderer::Load(std::string font, GLuint fontSize)
     FT_Done_FreeType(ft);
 }
 
-void TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+void TextRenderer::SetPixelRatio(GLfloat ratio)
+{
+    // 字号取整后一样就不用重新加载
+    GLuint current = static_cast<GLuint>(this->FontSize * this->PixelRatio + 0.5f);
+    GLuint pixelSize = static_cast<GLuint>(this->FontSize * ratio + 0.5f);
+    this->PixelRatio = ratio;
+    if (this->FontSize > 0 && pixelSize != current)
+        this->Load(this->Font, this->FontSize);
+}
+
+void TextRenderer::RenderText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
+{
+    this->RenderText(text.c_str(), x, y, scale, color);
+}
+
+void TextRenderer::RenderText(const char *text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color)
 {
+    PROFILE_SCOPE("TextRenderer::RenderText");
+    // 字形是按 PixelRatio 放大光栅化的，尺寸换回文字坐标
+    scale /= this->PixelRatio;
     // Activate corresponding render state
     this->TextShader.Use();
     this->TextShader.SetVector3f("textColor", color);
     glActiveTexture(GL_TEXTURE0);
     glBindVertexArray(this->VAO);
+    RenderStats::CountStateChange();
 
     // Iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+    const char *c;
+    for (c = text; *c != '\0'; c++)
     {
         Character ch = Characters[*c];
 
@@ -125,15 +180,18 @@ void TextRenderer::RenderText(std::string text, GLfloat x, GLfloat y, GLfloat sc
         };
         // Render glyph texture over quad
         glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+        RenderStats::CountStateChange();
         // Update content of VBO memory
         glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
         // glBufferData 拷贝顶点数据到 VBO
         // glBufferSubData 把顶点数据更新到 VBO 的 offset 位置
         glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // Be sure to use glBufferSubData and not glBufferData
+        RenderStats::CountBufferUpload(sizeof(vertices));
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         // Render quad
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        RenderStats::CountDraw();
         // Now advance cursors for next glyph
         x += (ch.Advance >> 6) * scale; // Bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
     }
@@ -37,15 +37,28 @@ public:
     std::map<GLchar, Character> Characters;
     // Shader used for text rendering
     Shader TextShader;
+    // 输出的像素和文字坐标的比例（HiDPI 或者窗口放大时大于 1），字形按这个比例光栅化，画出来的大小不变
+    GLfloat PixelRatio;
     // Constructor
     TextRenderer(GLuint width, GLuint height);
+    // 删除字形纹理和顶点缓冲
+    ~TextRenderer();
     // Pre-compiles a list of characters from the given font
     void Load(std::string font, GLuint fontSize);
+    // 输出像素的比例变了时按新的比例重新加载字形，文字保持原生分辨率的清晰度
+    void SetPixelRatio(GLfloat ratio);
     // Renders a string of text using the precompiled list of characters
-    void RenderText(std::string text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(0.0f));
+    // 字面量和 snprintf 格式化的文本直接传 const char *，不用构造 std::string（超过 15 个字符会分配内存）
+    void RenderText(const char *text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(0.0f));
+    void RenderText(const std::string &text, GLfloat x, GLfloat y, GLfloat scale, glm::vec3 color = glm::vec3(0.0f));
 private:
     // Render state
     GLuint VAO, VBO;
+    // 最后一次加载的字体和字号，SetPixelRatio 重新加载时用
+    std::string Font;
+    GLuint FontSize;
+    // 删除已经加载的字形纹理
+    void clearCharacters();
 };
 
 #endif
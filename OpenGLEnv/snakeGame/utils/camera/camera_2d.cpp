@@ -42,3 +42,11 @@ glm::mat4 Camera2D::GetProjectionMatrix()
     glm::mat4 scaleMatrix = glm::scale(glm::vec3(this->Zoom, this->Zoom, 1.0f));
     return scaleMatrix * projection;
 }
+
+void Camera2D::GetViewBounds(glm::vec2 &viewMin, glm::vec2 &viewMax)
+{
+    // 缩放是在投影之后做的，所以可见范围要除以缩放大小
+    glm::vec2 halfSize = glm::vec2(this->Width, this->Height) / (2.0f * this->Zoom);
+    viewMin = this->FocusPosition - halfSize;
+    viewMax = this->FocusPosition + halfSize;
+}
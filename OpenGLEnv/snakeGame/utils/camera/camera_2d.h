@@ -26,6 +26,8 @@ public:
     void UpdateFocusPosition(glm::vec2 position);
     void UpdateZoom(GLfloat zoom);
     glm::mat4 GetProjectionMatrix();
+    // 获取摄像机可见范围（世界坐标）
+    void GetViewBounds(glm::vec2 &viewMin, glm::vec2 &viewMax);
 };
 
 #endif /* camera_2d_h */
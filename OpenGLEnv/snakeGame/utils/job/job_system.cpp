@@ -0,0 +1,270 @@
+//
+//  job_system.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/19.
+//
+
+#include "job_system.h"
+#include "profiler.h"
+
+#include <chrono>
+
+// 当前线程属于哪个调度器的哪个队列，不属于任何调度器的线程使用第 0 个队列
+static thread_local const JobSystem *CurrentSystem = nullptr;
+static thread_local GLuint CurrentIndex = 0;
+
+JobSystem::JobSystem(GLuint threadCount)
+    : QueuedTasks(0), Quit(GL_FALSE)
+{
+    MemoryTagScope tag(MEMORY_TAG_JOBS);
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    GLuint workerCount = threadCount > 1 ? threadCount - 1 : 0;
+    for (GLuint i = 0; i < workerCount + 1; i++) {
+        this->Queues.push_back(new WorkQueue());
+    }
+    for (GLuint i = 0; i < workerCount; i++) {
+        this->Workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i + 1));
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->SleepMutex);
+        this->Quit = GL_TRUE;
+    }
+    this->WakeUp.notify_all();
+    for (std::thread &worker : this->Workers) {
+        worker.join();
+    }
+    for (WorkQueue *queue : this->Queues) {
+        delete queue;
+    }
+}
+
+GLuint JobSystem::ThreadCount() const
+{
+    return static_cast<GLuint>(this->Queues.size());
+}
+
+void JobSystem::Run(Job job, JobCounter *counter)
+{
+    if (counter) {
+        counter->Value.fetch_add(1, std::memory_order_relaxed);
+    }
+    Task task;
+    task.Func = std::move(job);
+    task.Counter = counter;
+    task.Allocations = CurrentAllocationCounter();
+    task.Tag = MemoryTags::Current();
+    this->Push(this->Queues[this->CurrentQueue()], std::move(task));
+}
+
+void JobSystem::RunAfter(JobCounter &dependency, Job job, JobCounter *counter)
+{
+    if (counter) {
+        counter->Value.fetch_add(1, std::memory_order_relaxed);
+    }
+    PendingTask pending;
+    pending.Dependency = &dependency;
+    pending.Work.Func = std::move(job);
+    pending.Work.Counter = counter;
+    pending.Work.Allocations = CurrentAllocationCounter();
+    pending.Work.Tag = MemoryTags::Current();
+    {
+        std::lock_guard<std::mutex> lock(this->PendingMutex);
+        this->Pending.push_back(std::move(pending));
+    }
+    // 依赖可能已经完成了
+    this->ReleasePending();
+}
+
+void JobSystem::RunBackground(Job job, JobCounter *counter)
+{
+    if (this->Workers.empty()) {
+        job();
+        return;
+    }
+    if (counter) {
+        counter->Value.fetch_add(1, std::memory_order_relaxed);
+    }
+    Task task;
+    task.Func = std::move(job);
+    task.Counter = counter;
+    task.Allocations = CurrentAllocationCounter();
+    task.Tag = MemoryTags::Current();
+    this->Push(&this->Background, std::move(task));
+}
+
+void JobSystem::Wait(JobCounter &counter)
+{
+    GLuint queueIndex = this->CurrentQueue();
+    while (!counter.IsDone()) {
+        if (!this->RunOne(queueIndex)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::ParallelFor(const Range &range)
+{
+    GLuint count = range.Count;
+    GLuint grainSize = range.GrainSize;
+    if (count == 0) {
+        return;
+    }
+    // 只有一段或者没有工作线程，直接在当前线程执行
+    if (count <= grainSize || this->Workers.empty()) {
+        for (GLuint begin = 0; begin < count; begin += grainSize) {
+            range.Invoke(range.Context, begin, begin + grainSize < count ? begin + grainSize : count);
+        }
+        return;
+    }
+
+    JobCounter counter;
+    for (GLuint begin = 0; begin < count; begin += grainSize) {
+        this->Run([&range, begin]() {
+            GLuint end = begin + range.GrainSize < range.Count ? begin + range.GrainSize : range.Count;
+            range.Invoke(range.Context, begin, end);
+        }, &counter);
+    }
+    this->Wait(counter);
+}
+
+void JobSystem::Push(WorkQueue *queue, Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(queue->Mutex);
+        GLuint capacity = static_cast<GLuint>(queue->Tasks.size());
+        if (queue->Count == capacity) {
+            // 只在任务突然变多时扩容，不算意外分配
+            AllowAllocationScope allow;
+            MemoryTagScope tag(MEMORY_TAG_JOBS);
+            std::vector<Task> tasks(capacity * 2);
+            for (GLuint i = 0; i < queue->Count; i++) {
+                tasks[i] = std::move(queue->Tasks[(queue->Head + i) & (capacity - 1)]);
+            }
+            queue->Tasks.swap(tasks);
+            queue->Head = 0;
+            capacity *= 2;
+        }
+        queue->Tasks[(queue->Head + queue->Count) & (capacity - 1)] = std::move(task);
+        queue->Count++;
+    }
+    this->QueuedTasks.fetch_add(1, std::memory_order_release);
+    {
+        // 加锁后再通知，避免工作线程检查完条件、还没睡下时错过通知
+        std::lock_guard<std::mutex> lock(this->SleepMutex);
+    }
+    this->WakeUp.notify_one();
+}
+
+GLboolean JobSystem::Pop(GLuint queueIndex, Task &task)
+{
+    WorkQueue *queue = this->Queues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue->Mutex);
+    if (queue->Count == 0) {
+        return GL_FALSE;
+    }
+    queue->Count--;
+    Task &back = queue->Tasks[(queue->Head + queue->Count) & (queue->Tasks.size() - 1)];
+    task = std::move(back);
+    back.Func = nullptr;
+    return GL_TRUE;
+}
+
+GLboolean JobSystem::PopFront(WorkQueue *queue, Task &task)
+{
+    std::lock_guard<std::mutex> lock(queue->Mutex);
+    if (queue->Count == 0) {
+        return GL_FALSE;
+    }
+    Task &front = queue->Tasks[queue->Head];
+    task = std::move(front);
+    front.Func = nullptr;
+    queue->Head = (queue->Head + 1) & (queue->Tasks.size() - 1);
+    queue->Count--;
+    return GL_TRUE;
+}
+
+GLboolean JobSystem::Steal(GLuint thiefIndex, Task &task)
+{
+    GLuint queueCount = static_cast<GLuint>(this->Queues.size());
+    for (GLuint i = 1; i < queueCount; i++) {
+        if (this->PopFront(this->Queues[(thiefIndex + i) % queueCount], task)) {
+            return GL_TRUE;
+        }
+    }
+    return GL_FALSE;
+}
+
+GLboolean JobSystem::RunOne(GLuint queueIndex)
+{
+    Task task;
+    // 后台任务只给工作线程（队列下标从 1 开始）在没有别的任务时执行
+    if (!this->Pop(queueIndex, task) && !this->Steal(queueIndex, task) &&
+        (queueIndex == 0 || !this->PopFront(&this->Background, task))) {
+        return GL_FALSE;
+    }
+    this->QueuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    AllocationCounter *allocations = CurrentAllocationCounter();
+    MemoryTag tag = MemoryTags::Current();
+    SetAllocationCounter(task.Allocations);
+    MemoryTags::SetCurrent(task.Tag);
+    task.Func();
+    SetAllocationCounter(allocations);
+    MemoryTags::SetCurrent(tag);
+    this->Finish(task);
+    return GL_TRUE;
+}
+
+void JobSystem::Finish(Task &task)
+{
+    if (task.Counter && task.Counter->Value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        this->ReleasePending();
+    }
+}
+
+void JobSystem::ReleasePending()
+{
+    std::vector<Task> ready;
+    {
+        std::lock_guard<std::mutex> lock(this->PendingMutex);
+        for (GLuint i = 0; i < this->Pending.size();) {
+            if (this->Pending[i].Dependency->IsDone()) {
+                ready.push_back(std::move(this->Pending[i].Work));
+                this->Pending.erase(this->Pending.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+    WorkQueue *queue = this->Queues[this->CurrentQueue()];
+    for (Task &task : ready) {
+        this->Push(queue, std::move(task));
+    }
+}
+
+void JobSystem::WorkerLoop(GLuint queueIndex)
+{
+    CurrentSystem = this;
+    CurrentIndex = queueIndex;
+    PROFILE_THREAD("Job Worker");
+    while (!this->Quit) {
+        if (this->RunOne(queueIndex)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(this->SleepMutex);
+        this->WakeUp.wait_for(lock, std::chrono::milliseconds(1), [this]() {
+            return this->Quit || this->QueuedTasks.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+GLuint JobSystem::CurrentQueue() const
+{
+    return CurrentSystem == this ? CurrentIndex : 0;
+}
@@ -0,0 +1,124 @@
+//
+//  job_system.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/19.
+//
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "allocation_stats.h"
+
+// 依赖计数器，提交任务时加一，任务完成时减一，等于 0 表示依赖的任务全部完成
+struct JobCounter {
+    std::atomic<GLint> Value;
+
+    JobCounter() : Value(0) { }
+    GLboolean IsDone() const { return this->Value.load(std::memory_order_acquire) == 0; }
+};
+
+// 工作窃取任务调度器
+// 每个线程（包括提交任务的主线程）都有一个自己的双端队列：自己从队尾取任务（后进先出，缓存友好），
+// 空闲的线程从别的线程的队头偷任务（先进先出，偷到的通常是比较大的任务）。
+// 等待计数器的线程不会阻塞，而是一边等一边帮忙执行任务。
+// 另外有一个后台队列放低优先级的任务（解码纹理），只有工作线程在没有别的任务时才取，
+// 模拟线程在 ParallelFor 里等待时不会被一张图片的解码卡住。
+class JobSystem
+{
+public:
+    typedef std::function<void()> Job;
+
+    // threadCount 是包括当前线程在内的线程数量，0 表示按 CPU 核心数自动决定
+    JobSystem(GLuint threadCount = 0);
+    ~JobSystem();
+
+    // 包括主线程在内的线程数量
+    GLuint ThreadCount() const;
+
+    // 提交一个任务，完成后 counter 减一
+    void Run(Job job, JobCounter *counter = nullptr);
+    // 等 dependency 完成后再执行任务，期间不占用线程
+    void RunAfter(JobCounter &dependency, Job job, JobCounter *counter = nullptr);
+    // 提交一个后台任务，完成后 counter 减一；没有工作线程时直接在当前线程执行
+    void RunBackground(Job job, JobCounter *counter = nullptr);
+    // 等待计数器归零，等待期间执行队列里的任务
+    void Wait(JobCounter &counter);
+
+    // 把 [0, count) 按 grainSize 切成若干段并行执行，函数返回时所有段都已经完成
+    // 每一段的划分只和 count、grainSize 有关，和线程数无关
+    // func 的参数是 (GLuint begin, GLuint end)。因为返回前所有段都已经完成，这里只引用 func，
+    // 不把它拷贝到 std::function 里，捕获很多变量的 lambda 也不会分配内存
+    template <typename Func>
+    void ParallelFor(GLuint count, GLuint grainSize, const Func &func)
+    {
+        Range range;
+        range.Context = &func;
+        range.Invoke = [](const void *context, GLuint begin, GLuint end) {
+            (*static_cast<const Func *>(context))(begin, end);
+        };
+        range.Count = count;
+        range.GrainSize = grainSize > 0 ? grainSize : 1;
+        this->ParallelFor(range);
+    }
+
+private:
+    struct Task {
+        Job                 Func;
+        JobCounter          *Counter;
+        AllocationCounter   *Allocations;// 任务里的意外分配算在提交任务的线程上
+        MemoryTag           Tag;// 任务里的分配记在提交时的内存标签上
+    };
+    // 环形数组实现的双端队列，std::deque 两头进出时会反复申请和释放内存块
+    struct WorkQueue {
+        std::mutex          Mutex;
+        std::vector<Task>   Tasks;// 长度是 2 的幂，满了翻倍
+        GLuint              Head;// 队头在 Tasks 里的下标
+        GLuint              Count;
+
+        WorkQueue() : Tasks(64), Head(0), Count(0) { }
+    };
+    // 类型擦除后的 ParallelFor 参数，每一段的任务只捕获它的地址和起点，放得进 std::function 的内部缓冲区
+    struct Range {
+        const void  *Context;
+        void        (*Invoke)(const void *context, GLuint begin, GLuint end);
+        GLuint      Count;
+        GLuint      GrainSize;
+    };
+    struct PendingTask {
+        JobCounter  *Dependency;
+        Task        Work;
+    };
+
+    std::vector<WorkQueue *>    Queues;// 第 0 个属于主线程
+    WorkQueue                   Background;// 后台任务，只有工作线程从队头取
+    std::vector<std::thread>    Workers;
+    std::mutex                  SleepMutex;
+    std::condition_variable     WakeUp;
+    std::atomic<GLint>          QueuedTasks;// 所有队列里还没被取走的任务数
+    std::atomic<GLboolean>      Quit;
+    std::mutex                  PendingMutex;
+    std::vector<PendingTask>    Pending;// 等待依赖完成的任务
+
+    void ParallelFor(const Range &range);
+    void Push(WorkQueue *queue, Task task);
+    GLboolean Pop(GLuint queueIndex, Task &task);
+    GLboolean PopFront(WorkQueue *queue, Task &task);
+    GLboolean Steal(GLuint thiefIndex, Task &task);
+    GLboolean RunOne(GLuint queueIndex);
+    void Finish(Task &task);
+    void ReleasePending();
+    void WorkerLoop(GLuint queueIndex);
+    GLuint CurrentQueue() const;
+};
+
+#endif /* job_system_h */
@@ -0,0 +1,261 @@
+//
+//  collision_kernels.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/26.
+//
+
+#include "collision_kernels.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define COLLISION_KERNELS_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COLLISION_KERNELS_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define COLLISION_KERNELS_NEON 1
+#endif
+
+// 不允许编译器把乘加合并成 FMA，否则标量版本和 SIMD 版本的舍入会不一样
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+// 扫掠圆和点的公共参数，每批只算一次
+struct SweepSetup {
+    GLfloat FromX, FromY;
+    GLfloat SegX, SegY;// 线段方向 To - From
+    GLfloat LengthSq;// 线段长度的平方，为 0 时退化成圆
+};
+
+static SweepSetup MakeSweepSetup(const SweptCircle &shape)
+{
+    SweepSetup setup;
+    setup.FromX = shape.From.x;
+    setup.FromY = shape.From.y;
+    setup.SegX = shape.To.x - shape.From.x;
+    setup.SegY = shape.To.y - shape.From.y;
+    setup.LengthSq = setup.SegX * setup.SegX + setup.SegY * setup.SegY;
+    return setup;
+}
+
+// 磁吸：离 to 小于 range 的点朝 to 移动 step
+static inline void PullPoint(GLfloat toX, GLfloat toY, GLfloat range, GLfloat step, GLfloat &x, GLfloat &y)
+{
+    GLfloat dx = toX - x;
+    GLfloat dy = toY - y;
+    GLfloat distance = std::sqrt(dx * dx + dy * dy);
+    if (distance > 0.0f && distance < range) {
+        x = x + dx / distance * step;
+        y = y + dy / distance * step;
+    }
+}
+
+// 点到线段的最近距离是否小于 radius
+static inline GLubyte SweepPoint(const SweepSetup &setup, GLfloat radius, GLfloat x, GLfloat y)
+{
+    GLfloat cx = x - setup.FromX;
+    GLfloat cy = y - setup.FromY;
+    GLfloat t = 0.0f;
+    if (setup.LengthSq > 0.0f) {
+        t = (cx * setup.SegX + cy * setup.SegY) / setup.LengthSq;
+        t = std::fmin(std::fmax(t, 0.0f), 1.0f);
+    }
+    GLfloat ox = x - (setup.FromX + setup.SegX * t);
+    GLfloat oy = y - (setup.FromY + setup.SegY * t);
+    return ox * ox + oy * oy < radius * radius ? 1 : 0;
+}
+
+static void PullAndSweepRange(const SweptCircle &shape, const SweepSetup &setup, GLfloat pullRange, GLfloat pullStep, PointBatch &points, GLubyte *hits, GLuint begin)
+{
+    for (GLuint i = begin; i < points.Count; i++) {
+        PullPoint(shape.To.x, shape.To.y, pullRange, pullStep, points.X[i], points.Y[i]);
+        hits[i] = SweepPoint(setup, shape.Radius + points.Radius[i], points.X[i], points.Y[i]);
+    }
+}
+
+static GLuint SweepTestRange(const SweptCircle &shape, const SweepSetup &setup, const PointBatch &points, GLubyte *hits, GLuint begin)
+{
+    GLuint count = 0;
+    for (GLuint i = begin; i < points.Count; i++) {
+        hits[i] = SweepPoint(setup, shape.Radius + points.Radius[i], points.X[i], points.Y[i]);
+        count += hits[i];
+    }
+    return count;
+}
+
+void PullAndSweepScalar(const SweptCircle &shape, GLfloat pullRange, GLfloat pullStep, PointBatch &points, GLubyte *hits)
+{
+    PullAndSweepRange(shape, MakeSweepSetup(shape), pullRange, pullStep, points, hits, 0);
+}
+
+GLuint SweepTestScalar(const SweptCircle &shape, const PointBatch &points, GLubyte *hits)
+{
+    return SweepTestRange(shape, MakeSweepSetup(shape), points, hits, 0);
+}
+
+#if COLLISION_KERNELS_AVX || COLLISION_KERNELS_SSE2 || COLLISION_KERNELS_NEON
+
+// 每个指令集包装成同样的一组函数，下面的循环只写一遍
+#if COLLISION_KERNELS_AVX
+typedef __m256 Lane;
+typedef __m256 LaneMask;
+static const GLuint LANE_WIDTH = 8;
+static inline Lane LaneSet(GLfloat value) { return _mm256_set1_ps(value); }
+static inline Lane LaneLoad(const GLfloat *values) { return _mm256_loadu_ps(values); }
+static inline void LaneStore(GLfloat *values, Lane lane) { _mm256_storeu_ps(values, lane); }
+static inline Lane LaneAdd(Lane a, Lane b) { return _mm256_add_ps(a, b); }
+static inline Lane LaneSub(Lane a, Lane b) { return _mm256_sub_ps(a, b); }
+static inline Lane LaneMul(Lane a, Lane b) { return _mm256_mul_ps(a, b); }
+static inline Lane LaneDiv(Lane a, Lane b) { return _mm256_div_ps(a, b); }
+static inline Lane LaneSqrt(Lane a) { return _mm256_sqrt_ps(a); }
+static inline Lane LaneMin(Lane a, Lane b) { return _mm256_min_ps(a, b); }
+static inline Lane LaneMax(Lane a, Lane b) { return _mm256_max_ps(a, b); }
+static inline LaneMask LaneLess(Lane a, Lane b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline LaneMask LaneAnd(LaneMask a, LaneMask b) { return _mm256_and_ps(a, b); }
+static inline Lane LaneSelect(LaneMask mask, Lane a, Lane b) { return _mm256_blendv_ps(b, a, mask); }
+static inline GLuint LaneBits(LaneMask mask) { return static_cast<GLuint>(_mm256_movemask_ps(mask)); }
+#elif COLLISION_KERNELS_SSE2
+typedef __m128 Lane;
+typedef __m128 LaneMask;
+static const GLuint LANE_WIDTH = 4;
+static inline Lane LaneSet(GLfloat value) { return _mm_set1_ps(value); }
+static inline Lane LaneLoad(const GLfloat *values) { return _mm_loadu_ps(values); }
+static inline void LaneStore(GLfloat *values, Lane lane) { _mm_storeu_ps(values, lane); }
+static inline Lane LaneAdd(Lane a, Lane b) { return _mm_add_ps(a, b); }
+static inline Lane LaneSub(Lane a, Lane b) { return _mm_sub_ps(a, b); }
+static inline Lane LaneMul(Lane a, Lane b) { return _mm_mul_ps(a, b); }
+static inline Lane LaneDiv(Lane a, Lane b) { return _mm_div_ps(a, b); }
+static inline Lane LaneSqrt(Lane a) { return _mm_sqrt_ps(a); }
+static inline Lane LaneMin(Lane a, Lane b) { return _mm_min_ps(a, b); }
+static inline Lane LaneMax(Lane a, Lane b) { return _mm_max_ps(a, b); }
+static inline LaneMask LaneLess(Lane a, Lane b) { return _mm_cmplt_ps(a, b); }
+static inline LaneMask LaneAnd(LaneMask a, LaneMask b) { return _mm_and_ps(a, b); }
+// SSE2 没有 blendv，用与、非与、或拼出来
+static inline Lane LaneSelect(LaneMask mask, Lane a, Lane b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline GLuint LaneBits(LaneMask mask) { return static_cast<GLuint>(_mm_movemask_ps(mask)); }
+#else
+typedef float32x4_t Lane;
+typedef uint32x4_t LaneMask;
+static const GLuint LANE_WIDTH = 4;
+static inline Lane LaneSet(GLfloat value) { return vdupq_n_f32(value); }
+static inline Lane LaneLoad(const GLfloat *values) { return vld1q_f32(values); }
+static inline void LaneStore(GLfloat *values, Lane lane) { vst1q_f32(values, lane); }
+static inline Lane LaneAdd(Lane a, Lane b) { return vaddq_f32(a, b); }
+static inline Lane LaneSub(Lane a, Lane b) { return vsubq_f32(a, b); }
+static inline Lane LaneMul(Lane a, Lane b) { return vmulq_f32(a, b); }
+static inline Lane LaneDiv(Lane a, Lane b) { return vdivq_f32(a, b); }
+static inline Lane LaneSqrt(Lane a) { return vsqrtq_f32(a); }
+static inline Lane LaneMin(Lane a, Lane b) { return vminq_f32(a, b); }
+static inline Lane LaneMax(Lane a, Lane b) { return vmaxq_f32(a, b); }
+static inline LaneMask LaneLess(Lane a, Lane b) { return vcltq_f32(a, b); }
+static inline LaneMask LaneAnd(LaneMask a, LaneMask b) { return vandq_u32(a, b); }
+static inline Lane LaneSelect(LaneMask mask, Lane a, Lane b) { return vbslq_f32(mask, a, b); }
+static inline GLuint LaneBits(LaneMask mask)
+{
+    static const uint32_t weights[4] = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(mask, vld1q_u32(weights)));
+}
+#endif
+
+static inline void StoreHits(GLubyte *hits, GLuint bits)
+{
+    for (GLuint lane = 0; lane < LANE_WIDTH; lane++) {
+        hits[lane] = (bits >> lane) & 1;
+    }
+}
+
+// 和 SweepPoint 相同的计算，一次算 LANE_WIDTH 个点
+static inline LaneMask SweepLanes(const SweepSetup &setup, Lane fromX, Lane fromY, Lane segX, Lane segY, Lane lengthSq, Lane radius, Lane x, Lane y)
+{
+    Lane cx = LaneSub(x, fromX);
+    Lane cy = LaneSub(y, fromY);
+    Lane t = LaneSet(0.0f);
+    if (setup.LengthSq > 0.0f) {
+        t = LaneDiv(LaneAdd(LaneMul(cx, segX), LaneMul(cy, segY)), lengthSq);
+        t = LaneMin(LaneMax(t, LaneSet(0.0f)), LaneSet(1.0f));
+    }
+    Lane ox = LaneSub(x, LaneAdd(fromX, LaneMul(segX, t)));
+    Lane oy = LaneSub(y, LaneAdd(fromY, LaneMul(segY, t)));
+    return LaneLess(LaneAdd(LaneMul(ox, ox), LaneMul(oy, oy)), LaneMul(radius, radius));
+}
+
+void PullAndSweep(const SweptCircle &shape, GLfloat pullRange, GLfloat pullStep, PointBatch &points, GLubyte *hits)
+{
+    SweepSetup setup = MakeSweepSetup(shape);
+    Lane toX = LaneSet(shape.To.x), toY = LaneSet(shape.To.y);
+    Lane range = LaneSet(pullRange), step = LaneSet(pullStep), zero = LaneSet(0.0f);
+    Lane fromX = LaneSet(setup.FromX), fromY = LaneSet(setup.FromY);
+    Lane segX = LaneSet(setup.SegX), segY = LaneSet(setup.SegY), lengthSq = LaneSet(setup.LengthSq);
+    Lane shapeRadius = LaneSet(shape.Radius);
+
+    GLuint i = 0;
+    for (; i + LANE_WIDTH <= points.Count; i += LANE_WIDTH) {
+        Lane x = LaneLoad(points.X + i);
+        Lane y = LaneLoad(points.Y + i);
+        // 磁吸，距离为 0 的点除出来的 NaN 会被掩码丢掉
+        Lane dx = LaneSub(toX, x);
+        Lane dy = LaneSub(toY, y);
+        Lane distance = LaneSqrt(LaneAdd(LaneMul(dx, dx), LaneMul(dy, dy)));
+        LaneMask pull = LaneAnd(LaneLess(zero, distance), LaneLess(distance, range));
+        x = LaneSelect(pull, LaneAdd(x, LaneMul(LaneDiv(dx, distance), step)), x);
+        y = LaneSelect(pull, LaneAdd(y, LaneMul(LaneDiv(dy, distance), step)), y);
+        LaneStore(points.X + i, x);
+        LaneStore(points.Y + i, y);
+        // 扫掠检测
+        Lane radius = LaneAdd(shapeRadius, LaneLoad(points.Radius + i));
+        StoreHits(hits + i, LaneBits(SweepLanes(setup, fromX, fromY, segX, segY, lengthSq, radius, x, y)));
+    }
+    PullAndSweepRange(shape, setup, pullRange, pullStep, points, hits, i);
+}
+
+GLuint SweepTest(const SweptCircle &shape, const PointBatch &points, GLubyte *hits)
+{
+    SweepSetup setup = MakeSweepSetup(shape);
+    Lane fromX = LaneSet(setup.FromX), fromY = LaneSet(setup.FromY);
+    Lane segX = LaneSet(setup.SegX), segY = LaneSet(setup.SegY), lengthSq = LaneSet(setup.LengthSq);
+    Lane shapeRadius = LaneSet(shape.Radius);
+
+    GLuint count = 0;
+    GLuint i = 0;
+    for (; i + LANE_WIDTH <= points.Count; i += LANE_WIDTH) {
+        Lane radius = LaneAdd(shapeRadius, LaneLoad(points.Radius + i));
+        GLuint bits = LaneBits(SweepLanes(setup, fromX, fromY, segX, segY, lengthSq, radius, LaneLoad(points.X + i), LaneLoad(points.Y + i)));
+        StoreHits(hits + i, bits);
+        count += static_cast<GLuint>(__builtin_popcount(bits));
+    }
+    return count + SweepTestRange(shape, setup, points, hits, i);
+}
+
+#else
+
+void PullAndSweep(const SweptCircle &shape, GLfloat pullRange, GLfloat pullStep, PointBatch &points, GLubyte *hits)
+{
+    PullAndSweepScalar(shape, pullRange, pullStep, points, hits);
+}
+
+GLuint SweepTest(const SweptCircle &shape, const PointBatch &points, GLubyte *hits)
+{
+    return SweepTestScalar(shape, points, hits);
+}
+
+#endif
+
+const char *CollisionKernelsISA()
+{
+#if COLLISION_KERNELS_AVX
+    return "AVX";
+#elif COLLISION_KERNELS_SSE2
+    return "SSE2";
+#elif COLLISION_KERNELS_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
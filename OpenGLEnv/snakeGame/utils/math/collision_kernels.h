@@ -0,0 +1,46 @@
+//
+//  collision_kernels.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/26.
+//
+
+#ifndef COLLISION_KERNELS_H
+#define COLLISION_KERNELS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// 批量碰撞检测
+// 一个查询形状对一批候选点（通常是空间索引查询出来的结果），候选点按 SoA 存放（x、y、半径各一个数组），
+// 每次处理 8 个（AVX）或 4 个（SSE2 / NEON），不足的部分和没有 SIMD 的平台用标量版本。
+// SIMD 版本和标量版本的每一步运算顺序都一样，sqrt 和除法都是精确舍入的，所以结果完全相同，
+// 不同指令集的机器上回放也能得到一样的状态。
+
+// 扫掠圆（胶囊体）：半径为 Radius 的圆从 From 移动到 To
+struct SweptCircle {
+    glm::vec2   From, To;
+    GLfloat     Radius;
+};
+
+// 一批候选点，X、Y 是中心点，Radius 是每个点自己的半径
+struct PointBatch {
+    GLfloat         *X, *Y;
+    const GLfloat   *Radius;
+    GLuint          Count;
+};
+
+// 先把离 shape.To 小于 pullRange 的点朝 shape.To 拉近 pullStep（磁吸），
+// 然后检测点是否和扫掠圆相交（点到线段的距离小于两个半径之和），hits 里相交的是 1，否则是 0
+void PullAndSweep(const SweptCircle &shape, GLfloat pullRange, GLfloat pullStep, PointBatch &points, GLubyte *hits);
+// 只检测相交，不移动点，返回相交的点数
+GLuint SweepTest(const SweptCircle &shape, const PointBatch &points, GLubyte *hits);
+
+// 标量版本，用于没有 SIMD 的平台、处理剩下的点以及基准测试对比
+void PullAndSweepScalar(const SweptCircle &shape, GLfloat pullRange, GLfloat pullStep, PointBatch &points, GLubyte *hits);
+GLuint SweepTestScalar(const SweptCircle &shape, const PointBatch &points, GLubyte *hits);
+
+// 编译时选中的指令集："AVX"、"SSE2"、"NEON" 或者 "scalar"
+const char *CollisionKernelsISA();
+
+#endif /* collision_kernels_h */
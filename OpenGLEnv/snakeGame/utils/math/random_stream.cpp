@@ -0,0 +1,105 @@
+//
+//  random_stream.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/24.
+//
+
+#include "random_stream.h"
+
+// SplitMix64，把一个 64 位种子扩展成互不相关的初始状态
+static uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+RandomStream::RandomStream(GLuint seed, GLuint stream)
+{
+    this->Seed(seed, stream);
+}
+
+void RandomStream::Seed(GLuint seed, GLuint stream)
+{
+    this->SeedFrom(static_cast<uint64_t>(stream) << 32 | seed);
+}
+
+RandomStream RandomStream::Split()
+{
+    uint64_t high = this->Next();
+    uint64_t low = this->Next();
+    RandomStream child;
+    child.SeedFrom(high << 32 | low);
+    return child;
+}
+
+void RandomStream::SeedFrom(uint64_t seed)
+{
+    // 种子只经过 SplitMix64 使用，相邻的种子和流编号也会得到完全不同的状态
+    for (GLuint i = 0; i < 4; i += 2) {
+        uint64_t value = SplitMix64(seed);
+        this->State[i] = static_cast<GLuint>(value);
+        this->State[i + 1] = static_cast<GLuint>(value >> 32);
+    }
+}
+
+void RandomStream::Fill(GLuint *values, GLuint count)
+{
+    GLuint i = 0;
+    if (count >= 4) {
+        // 子流的状态从主流派生，主流前进两步，下次批量生成得到的是新的子流
+        uint64_t high = this->Next();
+        uint64_t low = this->Next();
+        uint64_t seed = high << 32 | low;
+        GLuint s0[4], s1[4], s2[4], s3[4];
+        for (GLuint lane = 0; lane < 4; lane++) {
+            uint64_t a = SplitMix64(seed);
+            uint64_t b = SplitMix64(seed);
+            s0[lane] = static_cast<GLuint>(a);
+            s1[lane] = static_cast<GLuint>(a >> 32);
+            s2[lane] = static_cast<GLuint>(b);
+            s3[lane] = static_cast<GLuint>(b >> 32);
+        }
+        for (; i + 4 <= count; i += 4) {
+            // 4 条子流各走一步，每条子流的计算和 Next 一样
+            for (GLuint lane = 0; lane < 4; lane++) {
+                const GLuint t = s1[lane] << 9;
+                values[i + lane] = Rotl(s1[lane] * 5, 7) * 9;
+                s2[lane] ^= s0[lane];
+                s3[lane] ^= s1[lane];
+                s1[lane] ^= s2[lane];
+                s0[lane] ^= s3[lane];
+                s2[lane] ^= t;
+                s3[lane] = Rotl(s3[lane], 11);
+            }
+        }
+    }
+    // 不足 4 个的部分用主流补齐
+    for (; i < count; i++) {
+        values[i] = this->Next();
+    }
+}
+
+void RandomStream::FillBelow(GLuint *values, GLuint count, GLuint bound)
+{
+    this->Fill(values, count);
+    for (GLuint i = 0; i < count; i++) {
+        values[i] = Bounded(values[i], bound);
+    }
+}
+
+void RandomStream::FillFloat(GLfloat *values, GLuint count, GLfloat min, GLfloat max)
+{
+    // 分块生成整数再转换，不需要额外分配内存
+    GLuint bits[64];
+    GLfloat scale = max - min;
+    for (GLuint begin = 0; begin < count; begin += 64) {
+        GLuint size = count - begin < 64 ? count - begin : 64;
+        this->Fill(bits, size);
+        for (GLuint i = 0; i < size; i++) {
+            values[begin + i] = min + scale * ToFloat(bits[i]);
+        }
+    }
+}
@@ -0,0 +1,103 @@
+//
+//  random_stream.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/24.
+//
+
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// 随机数流的编号，同一个种子下不同编号的流互不相关
+// 每个子系统用自己的流，某个子系统多用或少用几个随机数不会影响其他子系统
+enum RandomStreamId {
+    RANDOM_STREAM_GAME,// 游戏逻辑（AI 蛇出生）
+    RANDOM_STREAM_FOODS,// 食物生成
+    RANDOM_STREAM_PARTICLES,// 粒子
+    RANDOM_STREAM_BOTS// AI 蛇思考，每条蛇再从这里分出自己的流
+};
+
+// xoshiro128** 随机数生成器
+// 状态只有 4 个 32 位整数，可以直接复制、比较和保存，相同的种子在任何平台上得到相同的序列。
+// 不是线程安全的：每个线程（或者每个并行任务、每个实体）使用自己的流。
+class RandomStream
+{
+public:
+    GLuint State[4];// 当前状态，属于游戏状态的一部分
+
+    RandomStream(GLuint seed = 1, GLuint stream = 0);
+
+    // 用种子和流编号重新初始化
+    void Seed(GLuint seed, GLuint stream = 0);
+    // 分出一条新的流，用于给每个实体或者每个并行任务一条独立的流
+    RandomStream Split();
+
+    // [0, 2^32) 的随机整数
+    GLuint Next()
+    {
+        const GLuint result = Rotl(this->State[1] * 5, 7) * 9;
+        const GLuint t = this->State[1] << 9;
+        this->State[2] ^= this->State[0];
+        this->State[3] ^= this->State[1];
+        this->State[1] ^= this->State[2];
+        this->State[0] ^= this->State[3];
+        this->State[2] ^= t;
+        this->State[3] = Rotl(this->State[3], 11);
+        return result;
+    }
+    // [0, bound) 的随机整数，用乘法代替取模
+    GLuint Below(GLuint bound)
+    {
+        return Bounded(this->Next(), bound);
+    }
+    // [min, max] 的随机整数
+    GLint Range(GLint min, GLint max)
+    {
+        return min + static_cast<GLint>(this->Below(static_cast<GLuint>(max - min) + 1));
+    }
+    // [0, 1) 的随机浮点数
+    GLfloat Float()
+    {
+        return ToFloat(this->Next());
+    }
+    // [min, max) 的随机浮点数
+    GLfloat Float(GLfloat min, GLfloat max)
+    {
+        return min + (max - min) * this->Float();
+    }
+
+    // 批量生成，一次生成很多食物或粒子时使用
+    // 4 条交错的子流同时推进，循环里没有依赖，编译器可以展开成 SIMD 指令。
+    // 子流每次都从主流取两个数派生，用完就丢掉，流的全部状态仍然只有 State，复制、比较和哈希 State 就够了。
+    // 批量生成的序列和逐个调用 Next 不同，但同样只由种子决定。
+    void Fill(GLuint *values, GLuint count);
+    // 批量生成 [0, bound) 的随机整数
+    void FillBelow(GLuint *values, GLuint count, GLuint bound);
+    // 批量生成 [min, max) 的随机浮点数
+    void FillFloat(GLfloat *values, GLuint count, GLfloat min = 0.0f, GLfloat max = 1.0f);
+
+    static GLuint Rotl(GLuint x, GLuint k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+    // 把 [0, 2^32) 的随机整数映射到 [0, bound)
+    static GLuint Bounded(GLuint value, GLuint bound)
+    {
+        return static_cast<GLuint>((static_cast<uint64_t>(value) * bound) >> 32);
+    }
+    // 取高 24 位转成 [0, 1) 的浮点数
+    static GLfloat ToFloat(GLuint value)
+    {
+        return static_cast<GLfloat>(value >> 8) * (1.0f / 16777216.0f);
+    }
+
+private:
+    // 从 SplitMix64 序列初始化状态
+    void SeedFrom(uint64_t seed);
+};
+
+#endif /* random_stream_h */
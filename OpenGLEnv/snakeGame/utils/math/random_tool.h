@@ -8,16 +8,14 @@
 #ifndef RANDOM_TOOL_H
 #define RANDOM_TOOL_H
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
+#include "random_stream.h"
 
 #define kSum 1000
 //算法一
 /*
  *均匀分布随机函数均匀化
 */
-double _uniform(double min, double max, long int *seed) {
+inline double _uniform(double min, double max, long int *seed) {
     double t = 0;
     *seed = 2045 * (*seed) + 1;
     *seed = *seed - (*seed / 1048576) * 1048576;
@@ -27,26 +25,25 @@ double _uniform(double min, double max, long int *seed) {
 }
 
 /*
- *均匀分布随机函数产生随机数
+ *均匀分布随机函数产生随机数，种子来自调用方的随机数流
 */
-long int Uniform(double min, double max) {
+inline long int Uniform(RandomStream &random, double min, double max) {
     long int s = 0;
     double r = 0;
 
-    //srand((unsigned int)time(NULL)); /*同一个时间种子可能会从产生相同的随机数列*/
-    s = rand();
+    s = random.Below(1048576);
     r = _uniform(min, max, &s);
 
     return ((long int)r);
 }
 
 //算法二
-double AverageRandom(double min, double max) {
+inline double AverageRandom(RandomStream &random, double min, double max) {
     int minInteger = (int)(min * 10000);
     int maxInteger = (int)(max * 10000);
-    int randInteger = rand() * rand();
+    // 直接取 [0, diff) 的随机数，不再用 rand() * rand()（会溢出成负数）
     int diffInteger = maxInteger - minInteger;
-    int resultInteger = randInteger % diffInteger + minInteger;
+    int resultInteger = (int)random.Below((GLuint)diffInteger) + minInteger;
 
     return (resultInteger/10000.0);
 }
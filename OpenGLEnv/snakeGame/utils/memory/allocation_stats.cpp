@@ -0,0 +1,129 @@
+//
+//  allocation_stats.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/30.
+//
+
+#include "allocation_stats.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// 替换全局的 operator new 统计内存分配，每次分配只多几次原子加法
+// new[] 和 delete[] 默认会转到这里；带大小的 delete 也显式定义了，见下面
+static std::atomic<uint64_t> AllocationCount(0);
+static std::atomic<uint64_t> AllocationBytes(0);
+static std::atomic<uint64_t> UnexpectedCount(0);
+static std::atomic<uint64_t> LastUnexpectedCount(0);
+static std::atomic<uint64_t> WarningCount(0);
+static std::atomic<GLuint> CheckCount(0);
+static thread_local GLuint AllowDepth = 0;
+static thread_local AllocationCounter ThreadUnexpected(0);
+static thread_local AllocationCounter *ThreadCounter = nullptr;
+
+// 每块内存前面放一个头，记下大小和标签，释放时从对应标签上减掉
+// 16 字节保持 malloc 返回地址的对齐
+struct AllocationHeader {
+    uint64_t    Size;
+    uint32_t    Tag;
+    uint32_t    Padding;
+};
+static_assert(sizeof(AllocationHeader) == 16, "allocation header must keep 16-byte alignment");
+
+void *operator new(size_t size)
+{
+    AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    AllocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (AllowDepth == 0) {
+        UnexpectedCount.fetch_add(1, std::memory_order_relaxed);
+        CurrentAllocationCounter()->fetch_add(1, std::memory_order_relaxed);
+    }
+    AllocationHeader *header = static_cast<AllocationHeader *>(malloc(sizeof(AllocationHeader) + size));
+    if (!header) {
+        throw std::bad_alloc();
+    }
+    MemoryTag tag = MemoryTags::Current();
+    header->Size = size;
+    header->Tag = tag;
+    MemoryTags::CountAllocation(tag, size);
+    return header + 1;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    if (!pointer) {
+        return;
+    }
+    AllocationHeader *header = static_cast<AllocationHeader *>(pointer) - 1;
+    MemoryTags::CountFree(static_cast<MemoryTag>(header->Tag), header->Size);
+    free(header);
+}
+
+// 开了 -fsized-deallocation 时 delete 表达式调用带大小的版本，它要和上面的 new 配对：
+// 指针前面有 16 字节的头，要退回头部再释放并从标签上减掉，不能依赖运行库的默认实现转过来
+void operator delete(void *pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+AllocationStats AllocationStats::Now()
+{
+    AllocationStats stats;
+    stats.Count = AllocationCount.load(std::memory_order_relaxed);
+    stats.Bytes = AllocationBytes.load(std::memory_order_relaxed);
+    stats.Unexpected = UnexpectedCount.load(std::memory_order_relaxed);
+    return stats;
+}
+
+AllowAllocationScope::AllowAllocationScope()
+{
+    AllowDepth++;
+}
+
+AllowAllocationScope::~AllowAllocationScope()
+{
+    AllowDepth--;
+}
+
+AllocationCounter *CurrentAllocationCounter()
+{
+    return ThreadCounter ? ThreadCounter : &ThreadUnexpected;
+}
+
+void SetAllocationCounter(AllocationCounter *counter)
+{
+    ThreadCounter = counter;
+}
+
+FrameAllocationCheck::FrameAllocationCheck(const char *name, GLboolean strict) : Name(name), Strict(strict), Start(ThreadUnexpected.load(std::memory_order_relaxed))
+{
+
+}
+
+FrameAllocationCheck::~FrameAllocationCheck()
+{
+    // 任务在 ParallelFor 返回前都已经完成，这时计数器里已经包含了任务里的分配
+    uint64_t unexpected = ThreadUnexpected.load(std::memory_order_relaxed) - this->Start;
+    LastUnexpectedCount.store(unexpected, std::memory_order_relaxed);
+    if (CheckCount.fetch_add(1, std::memory_order_relaxed) < WarmupChecks || unexpected == 0) {
+        return;
+    }
+    WarningCount.fetch_add(1, std::memory_order_relaxed);
+#if DEBUG
+    fprintf(stderr, "%s: %llu unexpected heap allocations in one frame\n", this->Name, static_cast<unsigned long long>(unexpected));
+    assert(!this->Strict);
+#endif
+}
+
+uint64_t FrameAllocationCheck::LastUnexpected()
+{
+    return LastUnexpectedCount.load(std::memory_order_relaxed);
+}
+
+uint64_t FrameAllocationCheck::Warnings()
+{
+    return WarningCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,79 @@
+//
+//  allocation_stats.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/30.
+//
+
+#ifndef ALLOCATION_STATS_H
+#define ALLOCATION_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "memory_tags.h"
+
+// 进程里所有 operator new 的次数和字节数，基准测试用两次读数的差计算每次操作的内存分配
+// 按子系统分的当前占用见 MemoryTags
+struct AllocationStats {
+    uint64_t    Count;// 分配次数
+    uint64_t    Bytes;// 分配字节数
+    uint64_t    Unexpected;// 不在 AllowAllocationScope 里的分配次数
+
+    static AllocationStats Now();
+};
+
+// 作用域里当前线程的分配不算意外分配
+// 用在偶发的事件上（生成新蛇、蛇变长、补充食物）和复用缓冲区、帧内存池的扩容上，
+// 稳定运行时每帧的其他代码都不应该分配堆内存，临时数据放在帧内存池里
+class AllowAllocationScope
+{
+public:
+    AllowAllocationScope();
+    ~AllowAllocationScope();
+};
+
+// 意外分配计入的计数器，每个线程默认计入自己的
+// 任务系统执行任务时切换成提交任务的线程的计数器，任务里的分配就算在提交者的那一帧里
+typedef std::atomic<uint64_t> AllocationCounter;
+AllocationCounter *CurrentAllocationCounter();
+void SetAllocationCounter(AllocationCounter *counter);
+
+// 检查作用域里当前线程（和它提交的任务）没有意外分配，有的话计数，DEBUG 下打印，性能面板显示计数
+// strict 为 true 时 DEBUG 下还会断言，只用在稳定状态有保证的只做模拟的路径上（基准测试、回放）；
+// 正常游戏里偶发事件漏标了 AllowAllocationScope 不应该让调试中断，渲染帧里 GL 驱动自己也会分配内存（例如按状态编译着色器）
+// 开始的几帧在预热（第一次填充缓冲区、创建线程的内存池），不检查
+class FrameAllocationCheck
+{
+public:
+    static const GLuint WarmupChecks = 16;
+
+    FrameAllocationCheck(const char *name, GLboolean strict = GL_FALSE);
+    ~FrameAllocationCheck();
+
+    // 最近一次检查到的意外分配次数，性能面板显示
+    static uint64_t LastUnexpected();
+    // 预热之后有意外分配的检查次数
+    static uint64_t Warnings();
+
+private:
+    const char  *Name;
+    GLboolean   Strict;
+    uint64_t    Start;
+};
+
+// 复用的缓冲区 clear 之后不会释放内存，只有内容变多时才扩容，扩容不算意外分配
+// 多预留一半，避免世界慢慢变大时每帧都扩容
+template <typename Container>
+void ReserveReused(Container &container, size_t count)
+{
+    if (container.capacity() < count) {
+        AllowAllocationScope allow;
+        container.reserve(count + count / 2);
+    }
+}
+
+#endif /* allocation_stats_h */
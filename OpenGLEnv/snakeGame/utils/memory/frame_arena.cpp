@@ -0,0 +1,122 @@
+//
+//  frame_arena.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/30.
+//
+
+#include "frame_arena.h"
+#include "allocation_stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+FrameArena::FrameArena(size_t blockSize) : Current(0), Offset(0), Peak(0)
+{
+    this->AddBlock(blockSize);
+}
+
+FrameArena::~FrameArena()
+{
+    this->FreeBlocks();
+}
+
+void *FrameArena::Allocate(size_t size, size_t alignment)
+{
+    for (;;) {
+        Block &block = this->Blocks[this->Current];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.Data);
+        size_t offset = ((base + this->Offset + alignment - 1) & ~(alignment - 1)) - base;
+        if (offset + size <= block.Size) {
+            this->Offset = offset + size;
+            this->Peak = std::max(this->Peak, this->Used());
+            return block.Data + offset;
+        }
+        // 当前块放不下，换到下一块，没有下一块就申请一块足够大的
+        if (this->Current + 1 == this->Blocks.size()) {
+            this->AddBlock(std::max(block.Size, size + alignment));
+        }
+        this->Current++;
+        this->Offset = 0;
+    }
+}
+
+FrameArena::Marker FrameArena::Mark() const
+{
+    Marker marker;
+    marker.Block = this->Current;
+    marker.Offset = this->Offset;
+    return marker;
+}
+
+void FrameArena::Rewind(Marker marker)
+{
+    this->Current = marker.Block;
+    this->Offset = marker.Offset;
+}
+
+void FrameArena::Reset()
+{
+    // 这一帧用了多块，合并成一块，下一帧就不用再申请了
+    if (this->Blocks.size() > 1) {
+        size_t capacity = this->Capacity();
+        this->FreeBlocks();
+        this->AddBlock(capacity);
+    }
+    this->Current = 0;
+    this->Offset = 0;
+}
+
+size_t FrameArena::Used() const
+{
+    size_t used = this->Offset;
+    for (GLuint i = 0; i < this->Current; i++) {
+        used += this->Blocks[i].Size;
+    }
+    return used;
+}
+
+size_t FrameArena::PeakUsed() const
+{
+    return this->Peak;
+}
+
+size_t FrameArena::Capacity() const
+{
+    size_t capacity = 0;
+    for (const Block &block : this->Blocks) {
+        capacity += block.Size;
+    }
+    return capacity;
+}
+
+FrameArena &FrameArena::ThreadLocal()
+{
+    // 第一次使用时创建，不算意外分配
+    static thread_local FrameArena *arena = nullptr;
+    if (!arena) {
+        AllowAllocationScope allow;
+        static thread_local FrameArena threadArena;
+        arena = &threadArena;
+    }
+    return *arena;
+}
+
+void FrameArena::AddBlock(size_t size)
+{
+    AllowAllocationScope allow;
+    MemoryTagScope tag(MEMORY_TAG_FRAME_ARENA);
+    Block block;
+    block.Data = static_cast<char *>(::operator new(size));
+    block.Size = size;
+    this->Blocks.push_back(block);
+}
+
+void FrameArena::FreeBlocks()
+{
+    for (Block &block : this->Blocks) {
+        ::operator delete(block.Data);
+    }
+    this->Blocks.clear();
+}
@@ -0,0 +1,113 @@
+//
+//  frame_arena.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/30.
+//
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+// 帧内存池（线性分配器）
+// 每帧的临时数据从这里分配，分配只是移动一下偏移，不需要释放，帧结束时 Reset 整体回收。
+// 每个线程有自己的内存池（ThreadLocal），所以分配不需要加锁，但是分配出去的内存不能交给别的线程再分配。
+// 一块用完了会再申请一块，Reset 时把所有块合并成一块，所以跑几帧之后就不会再申请内存了。
+class FrameArena
+{
+public:
+    static const size_t DefaultBlockSize = 1 << 20;// 1MB
+
+    // 位置标记，Rewind 回到标记的位置，标记之后分配的内存都被回收
+    struct Marker {
+        GLuint  Block;
+        size_t  Offset;
+    };
+
+    FrameArena(size_t blockSize = DefaultBlockSize);
+    ~FrameArena();
+
+    // 分配 size 字节，alignment 必须是 2 的幂
+    void *Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    // 分配 count 个 T，不会调用构造函数
+    template <typename T>
+    T *Allocate(size_t count)
+    {
+        return static_cast<T *>(this->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    Marker Mark() const;
+    void Rewind(Marker marker);
+    // 帧结束时调用，回收所有内存
+    void Reset();
+
+    size_t Used() const;// 当前已经分配的字节数
+    size_t PeakUsed() const;// 最多分配过的字节数
+    size_t Capacity() const;// 所有块的总大小
+
+    // 当前线程的内存池，第一次调用时创建
+    static FrameArena &ThreadLocal();
+
+private:
+    struct Block {
+        char    *Data;
+        size_t  Size;
+    };
+
+    std::vector<Block>  Blocks;
+    GLuint              Current;// 正在分配的块
+    size_t              Offset;// 在当前块里的偏移
+    size_t              Peak;
+
+    void AddBlock(size_t size);
+    void FreeBlocks();
+};
+
+// 作用域结束时回到进入作用域时的位置，用于没有“帧结束”的工作线程任务和嵌套的临时数据
+class FrameArenaScope
+{
+public:
+    FrameArenaScope(FrameArena &arena = FrameArena::ThreadLocal()) : Arena(arena), Start(arena.Mark()) { }
+    ~FrameArenaScope() { this->Arena.Rewind(this->Start); }
+
+private:
+    FrameArena          &Arena;
+    FrameArena::Marker  Start;
+};
+
+// 给 STL 容器用的分配器，默认使用当前线程的帧内存池
+// 释放什么也不做，内存在 Reset 或者 Rewind 时统一回收，所以容器不能活过所在的帧或者作用域
+template <typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameAllocator() : Arena(&FrameArena::ThreadLocal()) { }
+    FrameAllocator(FrameArena &arena) : Arena(&arena) { }
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U> &other) : Arena(other.Arena) { }
+
+    T *allocate(size_t count) { return this->Arena->template Allocate<T>(count); }
+    void deallocate(T *, size_t) { }
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U> &other) const { return this->Arena == other.Arena; }
+    template <typename U>
+    bool operator!=(const FrameAllocator<U> &other) const { return this->Arena != other.Arena; }
+
+private:
+    template <typename U> friend class FrameAllocator;
+
+    FrameArena  *Arena;
+};
+
+// 分配在帧内存池里的数组
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif /* frame_arena_h */
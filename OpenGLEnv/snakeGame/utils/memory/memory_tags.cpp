@@ -0,0 +1,85 @@
+//
+//  memory_tags.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "memory_tags.h"
+
+#include <atomic>
+
+static std::atomic<uint64_t> TagBytes[MEMORY_TAG_COUNT];
+static std::atomic<uint64_t> TagPeakBytes[MEMORY_TAG_COUNT];
+static std::atomic<uint64_t> TagAllocations[MEMORY_TAG_COUNT];
+static thread_local MemoryTag CurrentTag = MEMORY_TAG_GENERAL;
+
+static const char *TagNames[MEMORY_TAG_COUNT] = {
+    "general",
+    "simulation",
+    "spatial",
+    "render",
+    "text",
+    "resources",
+    "frame arena",
+    "jobs",
+    "profiler"
+};
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) : Previous(CurrentTag)
+{
+    CurrentTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope()
+{
+    CurrentTag = this->Previous;
+}
+
+MemoryTag MemoryTags::Current()
+{
+    return CurrentTag;
+}
+
+void MemoryTags::SetCurrent(MemoryTag tag)
+{
+    CurrentTag = tag;
+}
+
+const char *MemoryTags::Name(MemoryTag tag)
+{
+    return tag < MEMORY_TAG_COUNT ? TagNames[tag] : "unknown";
+}
+
+MemoryTagStats MemoryTags::Stats(MemoryTag tag)
+{
+    MemoryTagStats stats;
+    stats.Bytes = TagBytes[tag].load(std::memory_order_relaxed);
+    stats.PeakBytes = TagPeakBytes[tag].load(std::memory_order_relaxed);
+    stats.Allocations = TagAllocations[tag].load(std::memory_order_relaxed);
+    return stats;
+}
+
+uint64_t MemoryTags::TotalBytes()
+{
+    uint64_t total = 0;
+    for (GLuint i = 0; i < MEMORY_TAG_COUNT; i++) {
+        total += TagBytes[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void MemoryTags::CountAllocation(MemoryTag tag, size_t size)
+{
+    TagAllocations[tag].fetch_add(1, std::memory_order_relaxed);
+    uint64_t bytes = TagBytes[tag].fetch_add(size, std::memory_order_relaxed) + size;
+    // 峰值只在变大时写，多线程同时分配时最多少记一点
+    if (bytes > TagPeakBytes[tag].load(std::memory_order_relaxed)) {
+        TagPeakBytes[tag].store(bytes, std::memory_order_relaxed);
+    }
+}
+
+void MemoryTags::CountFree(MemoryTag tag, size_t size)
+{
+    TagBytes[tag].fetch_sub(size, std::memory_order_relaxed);
+}
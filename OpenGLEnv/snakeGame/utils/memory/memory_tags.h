@@ -0,0 +1,67 @@
+//
+//  memory_tags.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef MEMORY_TAGS_H
+#define MEMORY_TAGS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+// 内存按子系统记账，CPU 的堆分配和 GPU 的纹理、缓冲区都记在当前线程的标签上
+enum MemoryTag {
+    MEMORY_TAG_GENERAL,// 没有设置标签的分配
+    MEMORY_TAG_SIMULATION,// 蛇、食物、回放
+    MEMORY_TAG_SPATIAL,// 空间网格、占用网格
+    MEMORY_TAG_RENDER,// 渲染器、快照、帧缓冲
+    MEMORY_TAG_TEXT,// 字形
+    MEMORY_TAG_RESOURCES,// 纹理和着色器资源
+    MEMORY_TAG_FRAME_ARENA,// 帧内存池的内存块
+    MEMORY_TAG_JOBS,// 任务队列
+    MEMORY_TAG_PROFILER,// 性能分析缓冲区
+    MEMORY_TAG_COUNT
+};
+
+// 一个标签的 CPU 内存
+struct MemoryTagStats {
+    uint64_t    Bytes;// 当前占用的字节数
+    uint64_t    PeakBytes;// 最高占用
+    uint64_t    Allocations;// 累计分配次数
+};
+
+// 作用域里当前线程的分配记在 tag 上，可以嵌套，退出时恢复外层的标签
+// 任务系统执行任务时会切换成提交任务时的标签
+class MemoryTagScope
+{
+public:
+    explicit MemoryTagScope(MemoryTag tag);
+    ~MemoryTagScope();
+
+private:
+    MemoryTag   Previous;
+};
+
+class MemoryTags
+{
+public:
+    // 当前线程的标签
+    static MemoryTag Current();
+    static void SetCurrent(MemoryTag tag);
+    static const char *Name(MemoryTag tag);
+    static MemoryTagStats Stats(MemoryTag tag);
+    // 所有标签当前占用的字节数
+    static uint64_t TotalBytes();
+
+    // 只有全局的 operator new / delete 调用，几次原子操作
+    static void CountAllocation(MemoryTag tag, size_t size);
+    static void CountFree(MemoryTag tag, size_t size);
+private:
+    MemoryTags() { }
+};
+
+#endif /* memory_tags_h */
@@ -0,0 +1,168 @@
+//
+//  gpu_profiler.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/29.
+//
+
+#include "gpu_profiler.h"
+
+// 每组查询对象：0 和 1 是整帧的开始和结束，后面每个 pass 两个
+static const GLuint QueriesPerFrame = 2 + GPUProfiler::MaxPasses * 2;
+
+struct GPUFrame {
+    GLuint      Queries[QueriesPerFrame];
+    const char  *Names[GPUProfiler::MaxPasses];
+    GLuint      Depths[GPUProfiler::MaxPasses];
+    GLuint      PassCount;
+    GLboolean   Pending;// 已经提交，还没读回
+};
+
+static GPUFrame Frames[GPUProfiler::FrameLatency];
+static GLboolean Initialized = GL_FALSE;
+static GLboolean InFrame = GL_FALSE;
+static GLuint FrameIndex = 0;
+static GLuint OpenPasses[GPUProfiler::MaxPasses];// 还没结束的 pass，栈
+static GLuint OpenCount = 0;
+static GLint64 ClockOffset = 0;// CPU 时间（Profiler::Now）减 GPU 时间戳
+static ProfileBuffer *Track = nullptr;
+static std::vector<GPUPassTiming> Passes;
+static GLdouble FrameMilliseconds = 0.0;
+static GLuint Dropped = 0;
+
+// 读回一帧的结果，frame 的最后一个查询已经可以读了
+static void Resolve(GPUFrame &frame)
+{
+    GLuint64 frameBegin, frameEnd;
+    glGetQueryObjectui64v(frame.Queries[0], GL_QUERY_RESULT, &frameBegin);
+    glGetQueryObjectui64v(frame.Queries[1], GL_QUERY_RESULT, &frameEnd);
+    FrameMilliseconds = (frameEnd - frameBegin) / 1e6;
+    Profiler::Record(Track, "GPU Frame", frameBegin + ClockOffset, frameEnd + ClockOffset);
+    
+    Passes.clear();
+    for (GLuint i = 0; i < frame.PassCount; i++) {
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(frame.Queries[2 + i * 2], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame.Queries[3 + i * 2], GL_QUERY_RESULT, &end);
+        GPUPassTiming timing;
+        timing.Name = frame.Names[i];
+        timing.Depth = frame.Depths[i];
+        timing.Milliseconds = (end - begin) / 1e6;
+        Passes.push_back(timing);
+        Profiler::Record(Track, frame.Names[i], begin + ClockOffset, end + ClockOffset);
+    }
+}
+
+void GPUProfiler::BeginFrame()
+{
+#if PROFILER_ENABLED
+    if (!Initialized) {
+        for (GPUFrame &frame : Frames) {
+            glGenQueries(QueriesPerFrame, frame.Queries);
+            frame.PassCount = 0;
+            frame.Pending = GL_FALSE;
+        }
+        Passes.reserve(MaxPasses);
+        if (!Track) {
+            Track = Profiler::CreateTrack("GPU");
+        }
+        // GPU 时间戳和 CPU 时钟的起点不同，对齐一次，之后两边的区间可以直接比较
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        ClockOffset = static_cast<GLint64>(Profiler::Now()) - gpuNow;
+        Initialized = GL_TRUE;
+    }
+    
+    GPUFrame &frame = Frames[FrameIndex % FrameLatency];
+    if (frame.Pending) {
+        GLint available = 0;
+        glGetQueryObjectiv(frame.Queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            Resolve(frame);
+        } else {
+            Dropped++;
+        }
+        frame.Pending = GL_FALSE;
+    }
+    
+    frame.PassCount = 0;
+    OpenCount = 0;
+    glQueryCounter(frame.Queries[0], GL_TIMESTAMP);
+    InFrame = GL_TRUE;
+#endif
+}
+
+void GPUProfiler::EndFrame()
+{
+    if (!InFrame) {
+        return;
+    }
+    // 没有结束的 pass 在帧结束时一起结束
+    while (OpenCount > 0) {
+        EndPass();
+    }
+    GPUFrame &frame = Frames[FrameIndex % FrameLatency];
+    glQueryCounter(frame.Queries[1], GL_TIMESTAMP);
+    frame.Pending = GL_TRUE;
+    FrameIndex++;
+    InFrame = GL_FALSE;
+}
+
+void GPUProfiler::BeginPass(const char *name)
+{
+    if (!InFrame) {
+        return;
+    }
+    GPUFrame &frame = Frames[FrameIndex % FrameLatency];
+    if (frame.PassCount == MaxPasses) {
+        // pass 太多，后面的不记录，但是要保持 Begin / End 配对
+        OpenPasses[OpenCount++ % MaxPasses] = MaxPasses;
+        return;
+    }
+    GLuint pass = frame.PassCount++;
+    frame.Names[pass] = name;
+    frame.Depths[pass] = OpenCount;
+    OpenPasses[OpenCount++ % MaxPasses] = pass;
+    glQueryCounter(frame.Queries[2 + pass * 2], GL_TIMESTAMP);
+}
+
+void GPUProfiler::EndPass()
+{
+    if (!InFrame || OpenCount == 0) {
+        return;
+    }
+    GLuint pass = OpenPasses[--OpenCount % MaxPasses];
+    if (pass < MaxPasses) {
+        glQueryCounter(Frames[FrameIndex % FrameLatency].Queries[3 + pass * 2], GL_TIMESTAMP);
+    }
+}
+
+const std::vector<GPUPassTiming> &GPUProfiler::LastPasses()
+{
+    return Passes;
+}
+
+GLdouble GPUProfiler::LastFrameMilliseconds()
+{
+    return FrameMilliseconds;
+}
+
+GLuint GPUProfiler::DroppedFrames()
+{
+    return Dropped;
+}
+
+void GPUProfiler::Release()
+{
+    if (!Initialized) {
+        return;
+    }
+    for (GPUFrame &frame : Frames) {
+        glDeleteQueries(QueriesPerFrame, frame.Queries);
+        frame.Pending = GL_FALSE;
+    }
+    Passes.clear();
+    FrameIndex = 0;
+    InFrame = GL_FALSE;
+    Initialized = GL_FALSE;
+}
@@ -0,0 +1,73 @@
+//
+//  gpu_profiler.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/29.
+//
+
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "profiler.h"
+
+// 一个渲染 pass 在 GPU 上的耗时
+struct GPUPassTiming {
+    const char  *Name;// pass 名，字符串字面量
+    GLuint      Depth;// 嵌套层数，最外层是 0
+    GLdouble    Milliseconds;
+};
+
+// GPU 性能分析器，只能在有 OpenGL 上下文的渲染线程里调用
+// 每个 pass 的开始和结束各放一个 GL_TIMESTAMP 查询（时间戳查询可以嵌套，GL_TIME_ELAPSED 不行），
+// 查询对象按帧轮换使用，FrameLatency 帧之后才读结果，这时 GPU 早就画完了，读结果不会等待。
+// 轮到的时候结果还没出来（GPU 落后太多）就丢掉那一帧，而不是等 GPU。
+// 读回的耗时按 CPU 时钟对齐后写进 Profiler 的 "GPU" 轨道，和 CPU 区间出现在同一个 trace 里。
+class GPUProfiler
+{
+public:
+    // 读回延迟的帧数，也是查询对象的组数
+    static const GLuint FrameLatency = 4;
+    // 每帧最多记录的 pass 数（包括嵌套的）
+    static const GLuint MaxPasses = 32;
+
+    // 一帧的开始和结束，开始时读回 FrameLatency 帧之前的结果
+    static void BeginFrame();
+    static void EndFrame();
+    // 一个 pass 的开始和结束，可以嵌套，不在 BeginFrame 和 EndFrame 之间时什么都不做
+    static void BeginPass(const char *name);
+    static void EndPass();
+
+    // 最近读回的一帧里每个 pass 的耗时，按开始顺序排列
+    static const std::vector<GPUPassTiming> &LastPasses();
+    // 最近读回的一帧从 BeginFrame 到 EndFrame 的 GPU 耗时
+    static GLdouble LastFrameMilliseconds();
+    // 结果没来得及读回被丢掉的帧数
+    static GLuint DroppedFrames();
+
+    // 删除查询对象，在销毁 OpenGL 上下文之前调用
+    static void Release();
+
+private:
+    GPUProfiler() { }
+};
+
+// RAII GPU pass
+class GPUZone
+{
+public:
+    explicit GPUZone(const char *name) { GPUProfiler::BeginPass(name); }
+    ~GPUZone() { GPUProfiler::EndPass(); }
+};
+
+#if PROFILER_ENABLED
+// 从这里到作用域结束算一个 GPU pass，只能传字符串字面量
+#define PROFILE_GPU_SCOPE(name) GPUZone PROFILE_CONCAT(gpuZone, __LINE__)("" name)
+#else
+#define PROFILE_GPU_SCOPE(name)
+#endif
+
+#endif /* gpu_profiler_h */
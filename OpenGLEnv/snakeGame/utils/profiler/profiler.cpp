@@ -0,0 +1,142 @@
+//
+//  profiler.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/29.
+//
+
+#include "profiler.h"
+#include "memory_tags.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// 环形缓冲区里的一条记录。导出线程读的时候所属线程可能正在覆盖它，字段都是原子变量，
+// 用 relaxed 读写（和普通读写一样快），读到的是不是完整的记录靠 Head 判断
+struct ProfileSlot {
+    std::atomic<const char *>   Name;
+    std::atomic<uint64_t>       Start;
+    std::atomic<uint64_t>       End;
+};
+
+// 一个线程的记录，Head 是已经写入的记录总数，只有所属线程修改
+// 读写的顺序和顺序锁一样：写之前先有一个 release 栅栏，读完之后有一个 acquire 栅栏再读 Head，
+// 读到了下标为 h 的新记录里的任何字段，之后读到的 Head 至少是 h，这条记录就会被判断为已覆盖
+struct ProfileBuffer {
+    ProfileSlot             Events[Profiler::BufferCapacity];
+    std::atomic<uint64_t>   Head;
+    std::atomic<const char *> ThreadName;
+    GLuint                  ThreadID;// trace 里的 tid，按注册顺序从 1 开始
+    ProfileBuffer           *Next;// 所有缓冲区串成一个链表，只在头部插入，不会删除
+
+    ProfileBuffer() : Head(0), ThreadName(nullptr), ThreadID(0), Next(nullptr) { }
+};
+
+static const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+static std::atomic<ProfileBuffer *> Buffers(nullptr);
+static std::atomic<GLuint> BufferCount(0);
+static thread_local ProfileBuffer *CurrentBuffer = nullptr;
+
+// 新建一个缓冲区并无锁地插入链表头部，缓冲区不会释放，线程退出后导出时还能看到它的记录
+static ProfileBuffer *NewBuffer(const char *name)
+{
+    MemoryTagScope tag(MEMORY_TAG_PROFILER);
+    ProfileBuffer *buffer = new ProfileBuffer();
+    buffer->ThreadName.store(name, std::memory_order_relaxed);
+    buffer->ThreadID = BufferCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    ProfileBuffer *head = Buffers.load(std::memory_order_relaxed);
+    do {
+        buffer->Next = head;
+    } while (!Buffers.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+    return buffer;
+}
+
+// 当前线程的缓冲区，第一次调用时创建
+static ProfileBuffer *ThreadBuffer()
+{
+    if (!CurrentBuffer) {
+        CurrentBuffer = NewBuffer(nullptr);
+    }
+    return CurrentBuffer;
+}
+
+uint64_t Profiler::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch).count();
+}
+
+void Profiler::Record(const char *name, uint64_t start, uint64_t end)
+{
+    Record(ThreadBuffer(), name, start, end);
+}
+
+void Profiler::Record(ProfileBuffer *buffer, const char *name, uint64_t start, uint64_t end)
+{
+    uint64_t head = buffer->Head.load(std::memory_order_relaxed);
+    ProfileSlot &slot = buffer->Events[head & (BufferCapacity - 1)];
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.Name.store(name, std::memory_order_relaxed);
+    slot.Start.store(start, std::memory_order_relaxed);
+    slot.End.store(end, std::memory_order_relaxed);
+    buffer->Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char *name)
+{
+    ThreadBuffer()->ThreadName.store(name, std::memory_order_release);
+}
+
+ProfileBuffer *Profiler::CreateTrack(const char *name)
+{
+    return NewBuffer(name);
+}
+
+GLboolean Profiler::WriteChromeTrace(const std::string &path)
+{
+    std::ofstream stream(path, std::ios::trunc);
+    if (!stream.is_open()) {
+        std::cout << "ERROR::PROFILER: Failed to open " << path << std::endl;
+        return GL_FALSE;
+    }
+    
+    // 区间名和线程名都是代码里的字面量，不需要转义；时间单位是微秒，保留到纳秒
+    stream.setf(std::ios::fixed);
+    stream.precision(3);
+    stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    GLboolean first = GL_TRUE;
+    std::vector<ProfileEvent> events;
+    for (ProfileBuffer *buffer = Buffers.load(std::memory_order_acquire); buffer; buffer = buffer->Next) {
+        // 先读出最近的记录，再看读的过程中写入了多少条，被覆盖的那些丢掉。
+        // 写线程在发布 Head 之前就开始写下标为 Head 的槽位，它和 Head - BufferCapacity 是同一个槽位，也要丢掉
+        uint64_t head = buffer->Head.load(std::memory_order_acquire);
+        uint64_t begin = head > BufferCapacity ? head - BufferCapacity : 0;
+        events.clear();
+        for (uint64_t i = begin; i < head; i++) {
+            const ProfileSlot &slot = buffer->Events[i & (BufferCapacity - 1)];
+            ProfileEvent event;
+            event.Name = slot.Name.load(std::memory_order_relaxed);
+            event.Start = slot.Start.load(std::memory_order_relaxed);
+            event.End = slot.End.load(std::memory_order_relaxed);
+            events.push_back(event);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t written = buffer->Head.load(std::memory_order_acquire);
+        uint64_t valid = written + 1 > BufferCapacity ? written + 1 - BufferCapacity : 0;
+        
+        const char *threadName = buffer->ThreadName.load(std::memory_order_acquire);
+        if (threadName) {
+            stream << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->ThreadID << ", \"args\": {\"name\": \"" << threadName << "\"}}";
+            first = GL_FALSE;
+        }
+        for (uint64_t i = valid > begin ? valid - begin : 0; i < events.size(); i++) {
+            const ProfileEvent &event = events[i];
+            stream << (first ? "" : ",\n") << "{\"name\": \"" << event.Name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->ThreadID
+                << ", \"ts\": " << event.Start / 1000.0 << ", \"dur\": " << (event.End - event.Start) / 1000.0 << "}";
+            first = GL_FALSE;
+        }
+    }
+    stream << "\n]}\n";
+    return GL_TRUE;
+}
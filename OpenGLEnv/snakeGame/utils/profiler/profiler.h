@@ -0,0 +1,82 @@
+//
+//  profiler.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/29.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+// 编译时开关，定义成 0 时 PROFILE_SCOPE 展开为空，不产生任何代码
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// 一次计时区间，时间是相对 Profiler 启动时刻的纳秒数
+struct ProfileEvent {
+    const char  *Name;// 区间名，必须是字符串字面量
+    uint64_t    Start;
+    uint64_t    End;
+};
+
+// 一条记录轨道，每个线程一条，GPU 之类不属于线程的记录也可以有自己的轨道
+struct ProfileBuffer;
+
+// CPU 性能分析器
+// 每个线程第一次记录时分配一个自己的环形缓冲区，只有这个线程写，写满了覆盖最早的记录，写入不加锁也不等待。
+// 导出时从所有线程的缓冲区读出最近的记录（读的同时可能正在写，被覆盖的记录会被丢掉），
+// 写成 Chrome trace-event JSON，用 chrome://tracing 或者 Perfetto 打开。
+class Profiler
+{
+public:
+    // 每个线程最多保留的记录数，必须是 2 的幂
+    static const GLuint BufferCapacity = 1 << 16;
+
+    // 当前时刻，相对 Profiler 启动时刻的纳秒数
+    static uint64_t Now();
+    // 在当前线程的缓冲区里记录一个区间
+    static void Record(const char *name, uint64_t start, uint64_t end);
+    // 设置当前线程在 trace 里显示的名字，必须是字符串字面量
+    static void SetThreadName(const char *name);
+    // 新建一条不属于任何线程的轨道（比如 GPU 耗时），同一时间只能有一个线程往里写
+    static ProfileBuffer *CreateTrack(const char *name);
+    // 在指定轨道里记录一个区间
+    static void Record(ProfileBuffer *track, const char *name, uint64_t start, uint64_t end);
+    // 把所有线程最近的记录写成 Chrome trace-event JSON
+    static GLboolean WriteChromeTrace(const std::string &path);
+
+private:
+    Profiler() { }
+};
+
+// RAII 计时区间，构造时开始计时，析构时记录
+class ProfileZone
+{
+public:
+    explicit ProfileZone(const char *name) : Name(name), Start(Profiler::Now()) { }
+    ~ProfileZone() { Profiler::Record(this->Name, this->Start, Profiler::Now()); }
+
+private:
+    const char  *Name;
+    uint64_t    Start;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// 从这里到作用域结束计时，name 和 "" 拼接，只能传字符串字面量，记录时只保存指针
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)("" name)
+#define PROFILE_THREAD(name) Profiler::SetThreadName("" name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD(name)
+#endif
+
+#endif /* profiler_h */
@@ -0,0 +1,198 @@
+//
+//  asset_loader.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "asset_loader.h"
+#include "resource_manager.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
+#include "profiler.h"
+#include "allocation_stats.h"
+#include "vfs.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stb_image.h>
+
+AssetLoader::AssetLoader(JobSystem &jobs) : Jobs(jobs), PBO(0), PBOSize(0)
+{
+    glGenBuffers(1, &this->PBO);
+}
+
+AssetLoader::~AssetLoader()
+{
+    // 映射和解码结果随 asset 一起释放
+    for (std::shared_ptr<TextureAsset> &asset : this->Pending) {
+        this->Jobs.Wait(asset->Decoded);
+    }
+    GPUMemory::Release(GPU_BUFFER, this->PBO);
+    glDeleteBuffers(1, &this->PBO);
+}
+
+TextureFuture AssetLoader::LoadTexture(const GLchar *file, const std::string &name, GLboolean flipYAxis)
+{
+    MemoryTagScope tag(MEMORY_TAG_RESOURCES);
+    std::shared_ptr<TextureAsset> asset = std::make_shared<TextureAsset>();
+    asset->File = file;
+    asset->Name = name;
+    asset->FlipYAxis = flipYAxis;
+
+    // 先放一个 1x1 的透明占位图，纹理是完整的，加载完成前画出来是透明的
+    const unsigned char placeholder[4] = { 0, 0, 0, 0 };
+    asset->Texture.Internal_Format = GL_RGBA;
+    asset->Texture.Image_Format = GL_RGBA;
+    asset->Texture.Generate(1, 1, const_cast<unsigned char *>(placeholder));
+    ResourceManager::Textures[name] = asset->Texture;
+
+    // 任务只捕获裸指针，放得进 std::function 的内部缓冲区；Pending 里的 shared_ptr 可能是唯一的引用，
+    // Update 要等任务的计数器归零（工作线程已经不再碰 asset）才把它移出 Pending
+    TextureAsset *decoding = asset.get();
+    // 解码放在后台队列，模拟线程等待 ParallelFor 时不会顺手执行它
+    this->Jobs.RunBackground([decoding]() {
+        Decode(*decoding);
+    }, &asset->Decoded);
+    this->Pending.push_back(asset);
+    return TextureFuture(asset);
+}
+
+void AssetLoader::Decode(TextureAsset &asset)
+{
+    PROFILE_SCOPE("AssetLoader::Decode");
+    // 加载是偶发的事件，不算意外分配
+    AllowAllocationScope allow;
+    std::vector<unsigned char> source;
+    if (!VFS::ReadFile(asset.File, source)) {
+        asset.State.store(ASSET_FAILED, std::memory_order_release);
+        return;
+    }
+    
+    // 1. 缓存文件的哈希对得上就直接用映射，不用解压
+    uint64_t hash = TextureCache::Hash(source.data(), source.size());
+    uint32_t flags = asset.FlipYAxis ? TEXTURE_CACHE_FLIPPED : 0;
+    std::string cachePath = TextureCache::PathFor(asset.File);
+    if (TextureCache::Enabled && asset.Cached.Open(cachePath, hash, flags)) {
+        asset.Width = asset.Cached.Header->Width;
+        asset.Height = asset.Cached.Header->Height;
+        asset.Levels = asset.Cached.Header->Levels;
+        asset.Pixels = asset.Cached.Pixels;
+        asset.State.store(ASSET_DECODED, std::memory_order_release);
+        return;
+    }
+    
+    // 2. 解码成 RGBA8，生成 mipmap 链；翻转设置是线程局部的，工作线程之间互不影响
+    stbi_set_flip_vertically_on_load_thread(asset.FlipYAxis);
+    int width, height, components;
+    unsigned char *pixels = stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &components, 4);
+    if (!pixels) {
+        asset.State.store(ASSET_FAILED, std::memory_order_release);
+        return;
+    }
+    asset.Width = width;
+    asset.Height = height;
+    asset.Levels = TextureCache::LevelCount(width, height);
+    asset.DecodedPixels.resize(TextureCache::ChainBytes(width, height, asset.Levels));
+    memcpy(asset.DecodedPixels.data(), pixels, static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+    TextureCache::BuildMipChain(asset.DecodedPixels.data(), width, height, asset.Levels);
+    asset.Pixels = asset.DecodedPixels.data();
+    
+    // 3. 写缓存，失败（比如目录只读）时只是下次还要解码
+    if (TextureCache::Enabled && !TextureCache::Write(cachePath, TextureCache::MakeHeader(hash, width, height, flags), asset.Pixels)) {
+        std::cout << "WARNING::ASSET_LOADER: Failed to write texture cache " << cachePath << std::endl;
+    }
+    asset.State.store(ASSET_DECODED, std::memory_order_release);
+}
+
+GLuint AssetLoader::Update(GLuint maxUploads)
+{
+    GLuint uploads = 0;
+    for (GLuint i = 0; i < this->Pending.size() && uploads < maxUploads;) {
+        TextureAsset &asset = *this->Pending[i];
+        // State 在任务函数返回前就写好了，之后工作线程还要递减 asset 里的 Decoded，
+        // 只看 State 就移出 Pending 的话 asset 可能在递减之前被释放
+        if (!asset.Decoded.IsDone()) {
+            i++;
+            continue;
+        }
+        GLint state = asset.State.load(std::memory_order_acquire);
+        if (state == ASSET_DECODING) {
+            i++;
+            continue;
+        }
+        if (state == ASSET_DECODED) {
+            this->Upload(asset);
+            uploads++;
+        } else {
+            std::cout << "Texture failed to load at path: " << asset.File << std::endl;
+        }
+        // 顺序无关，用最后一个填上空位
+        this->Pending[i] = this->Pending.back();
+        this->Pending.pop_back();
+    }
+    return uploads;
+}
+
+void AssetLoader::Upload(TextureAsset &asset)
+{
+    PROFILE_SCOPE("AssetLoader::Upload");
+    GLsizeiptr size = static_cast<GLsizeiptr>(TextureCache::ChainBytes(asset.Width, asset.Height, asset.Levels));
+
+    // 每次重新分配 PBO 的存储（orphan），驱动还在用上一张图时不用等它，直接给一块新的内存
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, this->PBO);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        memcpy(mapped, asset.Pixels, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+        // 映射失败时直接从内存上传
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    this->PBOSize = std::max(this->PBOSize, size);
+    GPUMemory::Track(GPU_BUFFER, this->PBO, this->PBOSize);
+
+    // 绑定了 PBO 时 glTexImage2D 的数据指针是 PBO 里的偏移
+    // 1x1、2x1 这些小的级的行不是 4 字节对齐的
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    asset.Texture.Internal_Format = GL_RGBA;
+    asset.Texture.Image_Format = GL_RGBA;
+    asset.Texture.GenerateLevels(asset.Width, asset.Height, asset.Levels, mapped ? nullptr : asset.Pixels);
+    if (mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    asset.Pixels = nullptr;
+    asset.Cached.Close();
+    std::vector<unsigned char>().swap(asset.DecodedPixels);
+    ResourceManager::Textures[asset.Name] = asset.Texture;
+    asset.State.store(ASSET_RESIDENT, std::memory_order_release);
+}
+
+void AssetLoader::Wait(const TextureFuture &future)
+{
+    if (!future.Asset) {
+        return;
+    }
+    // 等待期间帮忙执行解码任务
+    this->Jobs.Wait(future.Asset->Decoded);
+    while (future.Asset->State.load(std::memory_order_acquire) == ASSET_DECODED) {
+        this->Update();
+    }
+}
+
+void AssetLoader::WaitAll()
+{
+    while (!this->Pending.empty()) {
+        this->Jobs.Wait(this->Pending.back()->Decoded);
+        this->Update();
+    }
+}
+
+GLuint AssetLoader::PendingCount() const
+{
+    return static_cast<GLuint>(this->Pending.size());
+}
@@ -0,0 +1,99 @@
+//
+//  asset_loader.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "texture.h"
+#include "texture_cache.h"
+#include "job_system.h"
+
+// 异步加载的资源的状态
+enum AssetState {
+    ASSET_DECODING,// 在工作线程里读缓存或者解码
+    ASSET_DECODED,// 解码完成，等 GL 线程上传
+    ASSET_RESIDENT,// 已经上传到 GPU
+    ASSET_FAILED// 文件读取或者解码失败，纹理保持占位图
+};
+
+// 一个异步加载的纹理，加载器和 TextureFuture 共享
+struct TextureAsset {
+    std::string                 File;
+    std::string                 Name;
+    GLboolean                   FlipYAxis;
+    Texture2D                   Texture;// 请求时就创建了纹理对象，名字在加载期间不变
+    const unsigned char         *Pixels;// 整条 mipmap 链（RGBA8），指向缓存文件的映射或者 DecodedPixels，上传后释放
+    std::vector<unsigned char>  DecodedPixels;// 没有可用的缓存时解码 PNG 得到的 mipmap 链
+    TextureCacheFile            Cached;
+    GLuint                      Width, Height, Levels;
+    std::atomic<GLint>          State;
+    JobCounter                  Decoded;// 解码任务完成后归零
+
+    TextureAsset() : FlipYAxis(GL_FALSE), Pixels(nullptr), Width(0), Height(0), Levels(0), State(ASSET_DECODING) { }
+};
+
+// 一个纹理的加载结果，可以在任何线程里查询
+class TextureFuture
+{
+public:
+    TextureFuture() { }
+    explicit TextureFuture(std::shared_ptr<TextureAsset> asset) : Asset(asset) { }
+
+    GLboolean IsReady() const { return this->Asset && this->Asset->State.load(std::memory_order_acquire) == ASSET_RESIDENT; }
+    GLboolean IsFailed() const { return this->Asset && this->Asset->State.load(std::memory_order_acquire) == ASSET_FAILED; }
+    // 纹理对象，没有加载完成时是 1x1 的透明占位图
+    const Texture2D &Texture() const { return this->Asset->Texture; }
+
+private:
+    std::shared_ptr<TextureAsset> Asset;
+
+    friend class AssetLoader;
+};
+
+// 异步资源加载器
+// 请求纹理时在 GL 线程上马上创建纹理对象（1x1 透明占位图）并登记到 ResourceManager，精灵可以先拿着它的 ID；
+// PNG 解码交给任务系统在工作线程里并行执行；GL 线程每帧调用 Update，
+// 把解码完成的图片写进像素缓冲对象（PBO），再从 PBO 更新纹理，驱动可以异步拷贝，不用等 glTexImage2D 读完内存。
+// 解码结果连同 mipmap 链写进纹理缓存（见 texture_cache.h），下次启动时 PNG 没变就直接映射缓存文件，只剩读文件的开销。
+// 所有纹理都是 RGBA8。
+// 除了 TextureFuture 的查询，所有函数都只能在 GL 线程调用。
+class AssetLoader
+{
+public:
+    explicit AssetLoader(JobSystem &jobs);
+    // 等还在解码的任务结束，释放没有上传的图片和 PBO
+    ~AssetLoader();
+
+    // 请求加载一个纹理，名字和 ResourceManager::LoadTexture 的一样
+    TextureFuture LoadTexture(const GLchar *file, const std::string &name, GLboolean flipYAxis = GL_FALSE);
+    // 上传解码完成的纹理，每次最多 maxUploads 个，避免一帧里上传太多卡顿，返回上传的个数
+    GLuint Update(GLuint maxUploads = ~0u);
+    // 等一个纹理加载完成，等待时帮忙解码并上传
+    void Wait(const TextureFuture &future);
+    // 等所有纹理加载完成
+    void WaitAll();
+    // 还没有上传完的纹理个数
+    GLuint PendingCount() const;
+
+private:
+    JobSystem                                   &Jobs;
+    std::vector<std::shared_ptr<TextureAsset>>  Pending;// 还没有上传的纹理
+    GLuint                                      PBO;
+    GLsizeiptr                                  PBOSize;
+
+    void Upload(TextureAsset &asset);
+    static void Decode(TextureAsset &asset);
+};
+
+#endif /* asset_loader_h */
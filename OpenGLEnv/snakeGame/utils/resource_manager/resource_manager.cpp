@@ -6,35 +6,55 @@
 //
 
 #include "resource_manager.h"
+#include "gpu_memory.h"
+#include "vfs.h"
 
 #include <iostream>
-#include <sstream>
-#include <fstream>
+#include <vector>
 #include <stb_image.h>
 
 // Instantiate static variables
 std::map<std::string, Texture2D>    ResourceManager::Textures;
 std::map<std::string, Shader>       ResourceManager::Shaders;
+std::map<std::string, ShaderVariants> ResourceManager::Variants;
 
 
 Shader ResourceManager::LoadShader(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile, std::string name)
 {
+    MemoryTagScope tag(MEMORY_TAG_RESOURCES);
     Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
     return Shaders[name];
 }
 
-Shader ResourceManager::GetShader(std::string name)
+Shader ResourceManager::GetShader(const std::string &name)
 {
     return Shaders[name];
 }
 
+ShaderVariants &ResourceManager::LoadShaderVariants(const GLchar *vShaderFile, const GLchar *fShaderFile, const std::vector<std::string> &features, std::string name)
+{
+    MemoryTagScope tag(MEMORY_TAG_RESOURCES);
+    std::string vertexCode, fragmentCode;
+    if (!VFS::ReadText(vShaderFile, vertexCode) || !VFS::ReadText(fShaderFile, fragmentCode))
+        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+    Variants[name].Clear();
+    Variants[name] = ShaderVariants(vertexCode, fragmentCode, features);
+    return Variants[name];
+}
+
+ShaderVariants &ResourceManager::GetShaderVariants(const std::string &name)
+{
+    return Variants[name];
+}
+
 Texture2D ResourceManager::LoadTexture(const GLchar *file, GLboolean alpha, std::string name, GLboolean flipYAxis)
 {
+    MemoryTagScope tag(MEMORY_TAG_RESOURCES);
     Textures[name] = loadTextureFromFile(file, alpha, flipYAxis);
     return Textures[name];
 }
 
-Texture2D ResourceManager::GetTexture(std::string name)
+Texture2D ResourceManager::GetTexture(const std::string &name)
 {
     return Textures[name];
 }
@@ -58,9 +78,17 @@ void ResourceManager::Clear()
     // (Properly) delete all shaders
     for (auto iter : Shaders)
         glDeleteProgram(iter.second.ID);
+    for (auto &iter : Variants)
+        iter.second.Clear();
     // (Properly) delete all textures
-    for (auto iter : Textures)
+    for (auto iter : Textures) {
+        GPUMemory::Release(GPU_TEXTURE, iter.second.ID);
         glDeleteTextures(1, &iter.second.ID);
+    }
+    // 对象已经删除，名字不能再拿到它们
+    Shaders.clear();
+    Variants.clear();
+    Textures.clear();
 }
 
 Shader ResourceManager::loadShaderFromFile(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile)
@@ -69,32 +97,9 @@ Shader ResourceManager::loadShaderFromFile(const GLchar *vShaderFile, const GLch
     std::string vertexCode;
     std::string fragmentCode;
     std::string geometryCode;
-    try
-    {
-        // Open files
-        std::ifstream vertexShaderFile(vShaderFile);
-        std::ifstream fragmentShaderFile(fShaderFile);
-        std::stringstream vShaderStream, fShaderStream;
-        // Read file's buffer contents into streams
-        vShaderStream << vertexShaderFile.rdbuf();
-        fShaderStream << fragmentShaderFile.rdbuf();
-        // close file handlers
-        vertexShaderFile.close();
-        fragmentShaderFile.close();
-        // Convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-        // If geometry shader path is present, also load a geometry shader
-        if (gShaderFile != nullptr)
-        {
-            std::ifstream geometryShaderFile(gShaderFile);
-            std::stringstream gShaderStream;
-            gShaderStream << geometryShaderFile.rdbuf();
-            geometryShaderFile.close();
-            geometryCode = gShaderStream.str();
-        }
-    }
-    catch (std::exception e)
+    // 着色器源码通过 VFS 读，挂载了资源包时从资源包里解压
+    if (!VFS::ReadText(vShaderFile, vertexCode) || !VFS::ReadText(fShaderFile, fragmentCode)
+        || (gShaderFile != nullptr && !VFS::ReadText(gShaderFile, geometryCode)))
     {
         std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
     }
@@ -116,7 +121,10 @@ Texture2D ResourceManager::loadTextureFromFile(const GLchar *file, GLboolean alp
     if (flipYAxis) {
         stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
     }
-    unsigned char *data = stbi_load(file, &width, &height, &nrComponents, 0);
+    std::vector<unsigned char> source;
+    unsigned char *data = nullptr;
+    if (VFS::ReadFile(file, source))
+        data = stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &nrComponents, 0);
     if (data)
     {
         GLenum format = GL_RGB;
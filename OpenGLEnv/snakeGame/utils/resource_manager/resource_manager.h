@@ -10,11 +10,13 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 
 #include "texture.h"
 #include "shader.h"
+#include "shader_variants.h"
 
 
 // A static singleton ResourceManager class that hosts several
@@ -26,16 +28,21 @@ class ResourceManager
 {
 public:
     // Resource storage
+    // 没有加锁，只能在 GL 线程里访问；模拟线程要用的纹理在初始化时取好传过去
     static std::map<std::string, Shader>    Shaders;
     static std::map<std::string, Texture2D> Textures;
+    static std::map<std::string, ShaderVariants> Variants;
     // Loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
     static Shader   LoadShader(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile, std::string name);
     // Retrieves a stored sader
-    static Shader   GetShader(std::string name);
+    static Shader   GetShader(const std::string &name);
+    // 读入着色器源码，建立按 features 编译的变体组，变体在用到时才编译
+    static ShaderVariants &LoadShaderVariants(const GLchar *vShaderFile, const GLchar *fShaderFile, const std::vector<std::string> &features, std::string name);
+    static ShaderVariants &GetShaderVariants(const std::string &name);
     // Loads (and generates) a texture from file
     static Texture2D LoadTexture(const GLchar *file, GLboolean alpha, std::string name, GLboolean flipYAxis = GL_FALSE);
     // Retrieves a stored texture
-    static Texture2D GetTexture(std::string name);
+    static Texture2D GetTexture(const std::string &name);
     // 加载一个空的纹理
     static Texture2D LoadEmptyTexture();
     // 获取一个空的纹理
@@ -0,0 +1,154 @@
+//
+//  program_cache.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "program_cache.h"
+#include "profiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <sys/stat.h>
+
+static const char       PROGRAM_CACHE_MAGIC[4] = { 'S', 'N', 'K', 'S' };
+static const uint32_t   PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    char        Magic[4];
+    uint32_t    Version;
+    uint64_t    Key;
+    uint32_t    Format;
+    uint32_t    Length;
+};
+static_assert(sizeof(ProgramCacheHeader) == 24, "program cache header layout changed");
+
+std::string ProgramCache::Directory = "shader_cache";
+GLboolean ProgramCache::Enabled = GL_TRUE;
+GLuint ProgramCache::Hits = 0;
+GLuint ProgramCache::Misses = 0;
+
+GLboolean ProgramCache::Supported()
+{
+    if (!GLAD_GL_VERSION_4_1) {
+        return GL_FALSE;
+    }
+    // 驱动可以一种格式都不支持，这时 glGetProgramBinary 拿不到东西
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// FNV-1a 64，每段后面加一个 0，"ab" + "c" 和 "a" + "bc" 的哈希不同
+static uint64_t HashString(uint64_t hash, const char *text)
+{
+    if (text) {
+        for (const unsigned char *c = reinterpret_cast<const unsigned char *>(text); *c; c++) {
+            hash = (hash ^ *c) * 1099511628211ull;
+        }
+    }
+    return hash * 1099511628211ull;
+}
+
+uint64_t ProgramCache::Key(const GLchar *vertexSource, const GLchar *fragmentSource, const GLchar *geometrySource)
+{
+    uint64_t hash = 1469598103934665603ull;
+    hash = HashString(hash, reinterpret_cast<const char *>(glGetString(GL_VENDOR)));
+    hash = HashString(hash, reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+    hash = HashString(hash, reinterpret_cast<const char *>(glGetString(GL_VERSION)));
+    hash = HashString(hash, vertexSource);
+    hash = HashString(hash, fragmentSource);
+    // 没有几何着色器和几何着色器是空字符串要区分开
+    hash = HashString(hash, geometrySource ? geometrySource : "\x01");
+    return hash;
+}
+
+std::string ProgramCache::PathFor(uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return Directory + "/" + name;
+}
+
+GLboolean ProgramCache::Load(GLuint program, uint64_t key)
+{
+    if (!Enabled || !Supported()) {
+        return GL_FALSE;
+    }
+    PROFILE_SCOPE("ProgramCache::Load");
+    std::string path = PathFor(key);
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        Misses++;
+        return GL_FALSE;
+    }
+    ProgramCacheHeader header;
+    std::vector<unsigned char> binary;
+    GLboolean read = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) == 0
+        && header.Version == PROGRAM_CACHE_VERSION
+        && header.Key == key;
+    if (read) {
+        binary.resize(header.Length);
+        read = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    GLint linked = GL_FALSE;
+    if (read) {
+        glProgramBinary(program, header.Format, binary.data(), static_cast<GLsizei>(binary.size()));
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+    if (!linked) {
+        // 文件坏了或者驱动不认这个二进制，删掉，下次链接后重新保存
+        // 驱动不认的格式会产生 GL_INVALID_ENUM，这是预期的，清掉免得算到后面的调用头上
+        while (read && glGetError() != GL_NO_ERROR) { }
+        remove(path.c_str());
+        Misses++;
+        return GL_FALSE;
+    }
+    Hits++;
+    return GL_TRUE;
+}
+
+void ProgramCache::Save(GLuint program, uint64_t key)
+{
+    if (!Enabled || !Supported()) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    ProgramCacheHeader header;
+    memcpy(header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+    header.Version = PROGRAM_CACHE_VERSION;
+    header.Key = key;
+    std::vector<unsigned char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    header.Format = format;
+    header.Length = static_cast<uint32_t>(written);
+
+    // 目录已经存在时 mkdir 失败，不影响后面的写入；先写临时文件再改名，不会读到写了一半的文件
+    mkdir(Directory.c_str(), 0755);
+    std::string path = PathFor(key);
+    std::string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+    GLboolean ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, header.Length, file) == header.Length;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+    }
+}
@@ -0,0 +1,54 @@
+//
+//  program_cache.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+/**
+ 着色器程序的二进制缓存，第一次链接后把 glGetProgramBinary 的结果存下来，下次启动直接 glProgramBinary，不用再编译
+
+ 缓存文件 <Directory>/<key>.bin（小端）：
+    4 字节魔数 "SNKS"
+    uint32 版本
+    uint64 key，各阶段源码和驱动的 GL_VENDOR、GL_RENDERER、GL_VERSION 一起算的哈希（FNV-1a 64）
+    uint32 二进制格式（glGetProgramBinary 返回的 binaryFormat）
+    uint32 二进制的字节数
+ 然后是程序的二进制。
+ 源码改了或者换了驱动 key 就变了；驱动拒绝二进制（比如驱动升级后 GL_VERSION 没变）时删掉缓存文件，回退到编译源码。
+ */
+class ProgramCache
+{
+public:
+    // 缓存目录，相对于工作目录，第一次写入时创建
+    static std::string Directory;
+    // 为 false 时不读也不写缓存
+    static GLboolean Enabled;
+
+    // 驱动支持读取程序二进制（OpenGL 4.1 并且至少有一种二进制格式）
+    static GLboolean Supported();
+    // 着色器源码和驱动一起算的 key，geometrySource 可以为空
+    static uint64_t Key(const GLchar *vertexSource, const GLchar *fragmentSource, const GLchar *geometrySource);
+    // 用缓存的二进制链接 program，没有缓存或者驱动拒绝时返回 false，program 可以再用来编译源码
+    static GLboolean Load(GLuint program, uint64_t key);
+    // 链接成功后保存程序的二进制，链接前要设置 GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    static void Save(GLuint program, uint64_t key);
+
+    // 本次运行命中和未命中缓存的次数
+    static GLuint Hits, Misses;
+
+private:
+    ProgramCache() { }
+
+    static std::string PathFor(uint64_t key);
+};
+
+#endif /* program_cache_h */
@@ -6,15 +6,24 @@
 //
 
 #include "shader.h"
+#include "render_stats.h"
+#include "program_cache.h"
 
 Shader &Shader::Use()
 {
     glUseProgram(this->ID);
+    RenderStats::CountStateChange();
     return *this;
 }
 
 void Shader::Compile(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar* geometrySource)
 {
+    // 源码和驱动都没变时直接用缓存的程序二进制，跳过编译和链接
+    uint64_t cacheKey = ProgramCache::Key(vertexSource, fragmentSource, geometrySource);
+    this->ID = glCreateProgram();
+    if (ProgramCache::Load(this->ID, cacheKey))
+        return;
+    
     GLuint sVertex, sFragment, gShader = 0;
     // Vertex Shader
     sVertex = glCreateShader(GL_VERTEX_SHADER);
@@ -35,13 +44,17 @@ void Shader::Compile(const GLchar* vertexSource, const GLchar* fragmentSource, c
         CheckCompileErrors(gShader, "GEOMETRY");
     }
     // Shader Program
-    this->ID = glCreateProgram();
     glAttachShader(this->ID, sVertex);
     glAttachShader(this->ID, sFragment);
     if (geometrySource != nullptr)
         glAttachShader(this->ID, gShader);
+    // 告诉驱动链接后要取二进制，有的驱动不设置就不保留；
+    // 4.1 以下的上下文（比如 3.3）里这个函数指针是空的，直接调用会崩溃
+    if (ProgramCache::Supported())
+        glProgramParameteri(this->ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(this->ID);
-    CheckCompileErrors(this->ID, "PROGRAM");
+    if (CheckCompileErrors(this->ID, "PROGRAM"))
+        ProgramCache::Save(this->ID, cacheKey);
     // Delete the shaders as they're linked into our program now and no longer necessery
     glDeleteShader(sVertex);
     glDeleteShader(sFragment);
@@ -54,63 +67,73 @@ void Shader::SetFloat(const GLchar *name, GLfloat value, GLboolean useShader)
     if (useShader)
         this->Use();
     glUniform1f(glGetUniformLocation(this->ID, name), value);
+    RenderStats::CountUniformUpload(sizeof(GLfloat));
 }
 void Shader::SetInteger(const GLchar *name, GLint value, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniform1i(glGetUniformLocation(this->ID, name), value);
+    RenderStats::CountUniformUpload(sizeof(GLint));
 }
 void Shader::SetIntegers(const GLchar *name, GLint count, const GLint *value, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniform1iv(glGetUniformLocation(this->ID, name), count, value);
+    RenderStats::CountUniformUpload(count * sizeof(GLint));
 }
 void Shader::SetVector2f(const GLchar *name, GLfloat x, GLfloat y, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniform2f(glGetUniformLocation(this->ID, name), x, y);
+    RenderStats::CountUniformUpload(2 * sizeof(GLfloat));
 }
 void Shader::SetVector2f(const GLchar *name, const glm::vec2 &value, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniform2f(glGetUniformLocation(this->ID, name), value.x, value.y);
+    RenderStats::CountUniformUpload(2 * sizeof(GLfloat));
 }
 void Shader::SetVector3f(const GLchar *name, GLfloat x, GLfloat y, GLfloat z, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniform3f(glGetUniformLocation(this->ID, name), x, y, z);
+    RenderStats::CountUniformUpload(3 * sizeof(GLfloat));
 }
 void Shader::SetVector3f(const GLchar *name, const glm::vec3 &value, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniform3f(glGetUniformLocation(this->ID, name), value.x, value.y, value.z);
+    RenderStats::CountUniformUpload(3 * sizeof(GLfloat));
 }
 void Shader::SetVector4f(const GLchar *name, GLfloat x, GLfloat y, GLfloat z, GLfloat w, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniform4f(glGetUniformLocation(this->ID, name), x, y, z, w);
+    RenderStats::CountUniformUpload(4 * sizeof(GLfloat));
 }
 void Shader::SetVector4f(const GLchar *name, const glm::vec4 &value, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniform4f(glGetUniformLocation(this->ID, name), value.x, value.y, value.z, value.w);
+    RenderStats::CountUniformUpload(4 * sizeof(GLfloat));
 }
 void Shader::SetMatrix4(const GLchar *name, const glm::mat4 &matrix, GLboolean useShader)
 {
     if (useShader)
         this->Use();
     glUniformMatrix4fv(glGetUniformLocation(this->ID, name), 1, GL_FALSE, &matrix[0][0]);
+    RenderStats::CountUniformUpload(sizeof(glm::mat4));
 }
 
-void Shader::CheckCompileErrors(GLuint object, std::string type)
+GLboolean Shader::CheckCompileErrors(GLuint object, std::string type)
 {
     GLint success;
     GLchar infoLog[1024];
@@ -136,4 +159,5 @@ void Shader::CheckCompileErrors(GLuint object, std::string type)
                 << std::endl;
         }
     }
+    return success ? GL_TRUE : GL_FALSE;
 }
@@ -43,7 +43,8 @@ public:
     void    SetMatrix4  (const GLchar *name, const glm::mat4 &matrix, GLboolean useShader = false);
 private:
     // Checks if compilation or linking failed and if so, print the error logs
-    void    CheckCompileErrors(GLuint object, std::string type);
+    // 成功时返回 true
+    GLboolean CheckCompileErrors(GLuint object, std::string type);
 };
 
 #endif
@@ -0,0 +1,64 @@
+//
+//  shader_variants.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "shader_variants.h"
+#include "allocation_stats.h"
+#include "memory_tags.h"
+#include "profiler.h"
+
+ShaderVariants::ShaderVariants(const std::string &vertexSource, const std::string &fragmentSource, const std::vector<std::string> &features)
+    : Features(features), VertexSource(vertexSource), FragmentSource(fragmentSource)
+{
+
+}
+
+Shader &ShaderVariants::Get(GLuint mask)
+{
+    std::map<GLuint, Shader>::iterator it = this->Variants.find(mask);
+    if (it != this->Variants.end()) {
+        return it->second;
+    }
+
+    // 第一次用到这个变体，编译是偶发的事件，不算意外分配
+    PROFILE_SCOPE("ShaderVariants::Compile");
+    AllowAllocationScope allow;
+    MemoryTagScope tag(MEMORY_TAG_RESOURCES);
+    std::string vertexCode = this->Preprocess(this->VertexSource, mask);
+    std::string fragmentCode = this->Preprocess(this->FragmentSource, mask);
+    Shader &shader = this->Variants[mask];
+    shader.Compile(vertexCode.c_str(), fragmentCode.c_str());
+    if (this->Setup) {
+        shader.Use();
+        this->Setup(shader);
+    }
+    return shader;
+}
+
+void ShaderVariants::Clear()
+{
+    for (auto &iter : this->Variants)
+        glDeleteProgram(iter.second.ID);
+    this->Variants.clear();
+}
+
+std::string ShaderVariants::Preprocess(const std::string &source, GLuint mask) const
+{
+    std::string defines;
+    for (GLuint i = 0; i < this->Features.size(); i++) {
+        if (mask & (1u << i)) {
+            defines += "#define " + this->Features[i] + " 1\n";
+        }
+    }
+    // #version 必须是第一行，宏放在它后面
+    size_t version = source.find("#version");
+    size_t line = version == std::string::npos ? 0 : source.find('\n', version);
+    if (line == std::string::npos) {
+        return source + "\n" + defines;
+    }
+    size_t insert = version == std::string::npos ? 0 : line + 1;
+    return source.substr(0, insert) + defines + source.substr(insert);
+}
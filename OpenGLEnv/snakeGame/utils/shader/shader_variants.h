@@ -0,0 +1,49 @@
+//
+//  shader_variants.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "shader.h"
+
+// 一组着色器变体：同一份源码，按特性位掩码在 #version 后面加上 #define 编译出不同的程序
+// 着色器里用 #if defined(特性名) 代替运行时的 uniform bool 分支，每个变体只包含自己用到的代码
+// 变体在第一次用到时才编译，编译走 Shader::Compile，有程序二进制缓存时直接加载
+class ShaderVariants
+{
+public:
+    // 每一位对应的宏名，第 i 位对应 Features[i]
+    std::vector<std::string>        Features;
+    // 新编译出一个变体后调用，用来设置不随帧变化的 uniform
+    std::function<void(Shader &)>   Setup;
+
+    ShaderVariants() { }
+    ShaderVariants(const std::string &vertexSource, const std::string &fragmentSource, const std::vector<std::string> &features);
+
+    // 取掩码对应的变体，还没有编译就编译
+    Shader &Get(GLuint mask);
+    // 已经编译的变体个数
+    GLuint CompiledCount() const { return static_cast<GLuint>(this->Variants.size()); }
+    // 删除所有编译好的程序
+    void Clear();
+
+    // 在源码的 #version 行后面插入 mask 对应的 #define
+    std::string Preprocess(const std::string &source, GLuint mask) const;
+
+private:
+    std::string                 VertexSource, FragmentSource;
+    std::map<GLuint, Shader>    Variants;
+};
+
+#endif /* shader_variants_h */
@@ -0,0 +1,202 @@
+//
+//  occupancy_grid.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/25.
+//
+
+#include "occupancy_grid.h"
+#include "memory_tags.h"
+
+// 每块的字数，一块正好是一条缓存行，树状数组小到可以放在一级缓存里
+static const GLuint BLOCK_WORDS = 8;
+
+// 一个字里的第 rank 个 1（从 0 开始），按 32、16、8、4、2、1 位二分，没有分支
+static GLuint SelectBit(uint64_t bits, GLuint rank)
+{
+    GLuint position = 0;
+    for (GLuint width = 32; width > 0; width >>= 1) {
+        GLuint count = static_cast<GLuint>(__builtin_popcountll((bits >> position) & ((1ull << width) - 1)));
+        GLuint skip = rank >= count;
+        position += skip * width;
+        rank -= skip * count;
+    }
+    return position;
+}
+
+OccupancyGrid::OccupancyGrid()
+    : Origin(0.0f), Size(0.0f), CellSize(1.0f), Columns(0), Rows(0), BlockCount(0), TreeTop(0), Free(0)
+{
+
+}
+
+OccupancyGrid::OccupancyGrid(glm::vec2 origin, glm::vec2 size, GLfloat cellSize)
+    : Origin(origin), Size(size), CellSize(cellSize)
+{
+    MemoryTagScope tag(MEMORY_TAG_SPATIAL);
+    this->Columns = glm::max(1u, static_cast<GLuint>(glm::ceil(size.x / cellSize)));
+    this->Rows = glm::max(1u, static_cast<GLuint>(glm::ceil(size.y / cellSize)));
+    GLuint cellCount = this->Columns * this->Rows;
+    GLuint wordCount = (cellCount + 63) / 64;
+    this->BlockCount = (wordCount + BLOCK_WORDS - 1) / BLOCK_WORDS;
+    this->Counts.assign(cellCount, 0);
+    // 最后一块里超出格子数的位当作被占用，这样它们不会被选中
+    this->Words.assign(this->BlockCount * BLOCK_WORDS, ~0ull);
+    for (GLuint word = 0; word < wordCount; word++) {
+        this->Words[word] = 0;
+    }
+    GLuint tail = cellCount % 64;
+    if (tail != 0) {
+        this->Words[wordCount - 1] = ~0ull << tail;
+    }
+    this->Free = cellCount;
+
+    // 树状数组的大小补齐到 2 的幂，补出来的块没有空闲格子，二分时不用判断越界
+    this->TreeTop = 1;
+    while (this->TreeTop < this->BlockCount) {
+        this->TreeTop *= 2;
+    }
+    // 线性时间建树：先放每块自己的空闲数，再加到父节点上
+    this->FreeTree.assign(this->TreeTop + 1, 0);
+    for (GLuint block = 1; block <= this->TreeTop; block++) {
+        for (GLuint i = 0; block <= this->BlockCount && i < BLOCK_WORDS; i++) {
+            this->FreeTree[block] += static_cast<GLuint>(64 - __builtin_popcountll(this->Words[(block - 1) * BLOCK_WORDS + i]));
+        }
+        GLuint parent = block + (block & (0 - block));
+        if (parent <= this->TreeTop) {
+            this->FreeTree[parent] += this->FreeTree[block];
+        }
+    }
+}
+
+void OccupancyGrid::Add(glm::vec2 position, glm::vec2 size)
+{
+    GLuint col0, row0, col1, row1;
+    this->Footprint(position, size, col0, row0, col1, row1);
+    for (GLuint row = row0; row <= row1; row++) {
+        for (GLuint col = col0; col <= col1; col++) {
+            this->Increment(row * this->Columns + col);
+        }
+    }
+}
+
+void OccupancyGrid::Remove(glm::vec2 position, glm::vec2 size)
+{
+    GLuint col0, row0, col1, row1;
+    this->Footprint(position, size, col0, row0, col1, row1);
+    for (GLuint row = row0; row <= row1; row++) {
+        for (GLuint col = col0; col <= col1; col++) {
+            this->Decrement(row * this->Columns + col);
+        }
+    }
+}
+
+void OccupancyGrid::Move(glm::vec2 oldPosition, glm::vec2 newPosition, glm::vec2 size)
+{
+    GLuint oldCol0, oldRow0, oldCol1, oldRow1;
+    GLuint newCol0, newRow0, newCol1, newRow1;
+    this->Footprint(oldPosition, size, oldCol0, oldRow0, oldCol1, oldRow1);
+    this->Footprint(newPosition, size, newCol0, newRow0, newCol1, newRow1);
+    // 大部分物体每帧只移动几个像素，覆盖的格子不变
+    if (oldCol0 == newCol0 && oldRow0 == newRow0 && oldCol1 == newCol1 && oldRow1 == newRow1) {
+        return;
+    }
+    // 先加后减，两边都覆盖的格子计数不会短暂归零
+    for (GLuint row = newRow0; row <= newRow1; row++) {
+        for (GLuint col = newCol0; col <= newCol1; col++) {
+            this->Increment(row * this->Columns + col);
+        }
+    }
+    for (GLuint row = oldRow0; row <= oldRow1; row++) {
+        for (GLuint col = oldCol0; col <= oldCol1; col++) {
+            this->Decrement(row * this->Columns + col);
+        }
+    }
+}
+
+GLboolean OccupancyGrid::IsFree(GLuint cell) const
+{
+    return this->Counts[cell] == 0;
+}
+
+GLuint OccupancyGrid::SelectFree(GLuint rank) const
+{
+    // 随机的 rank 让分支很难预测，下面都写成没有分支的形式
+    // 1. 在树状数组里二分，找到第 rank 个空闲格子所在的块
+    GLuint block = 0;
+    for (GLuint step = this->TreeTop; step > 0; step >>= 1) {
+        GLuint free = this->FreeTree[block + step];
+        GLuint skip = free <= rank;
+        block += skip * step;
+        rank -= skip * free;
+    }
+    // 2. 在块里按字跳过，跳到第一个空闲数大于 rank 的字就停下
+    GLuint word = block * BLOCK_WORDS;
+    GLuint stop = 0;
+    for (GLuint i = 0; i + 1 < BLOCK_WORDS; i++) {
+        GLuint free = static_cast<GLuint>(64 - __builtin_popcountll(this->Words[word]));
+        stop |= rank < free;
+        GLuint skip = stop ^ 1;
+        word += skip;
+        rank -= skip * free;
+    }
+    // 3. 在字里找到第 rank 个 0
+    return word * 64 + SelectBit(~this->Words[word], rank);
+}
+
+GLboolean OccupancyGrid::RandomFreeCell(GLuint random, GLuint &cell) const
+{
+    if (this->Free == 0) {
+        return GL_FALSE;
+    }
+    GLuint rank = static_cast<GLuint>((static_cast<uint64_t>(random) * this->Free) >> 32);
+    cell = this->SelectFree(rank);
+    return GL_TRUE;
+}
+
+glm::vec2 OccupancyGrid::CellPosition(GLuint cell) const
+{
+    GLuint col = cell % this->Columns;
+    GLuint row = cell / this->Columns;
+    return this->Origin + glm::vec2(col, row) * this->CellSize;
+}
+
+void OccupancyGrid::Footprint(glm::vec2 position, glm::vec2 size, GLuint &col0, GLuint &row0, GLuint &col1, GLuint &row1) const
+{
+    // 右下边缘刚好落在格子线上时不算覆盖下一个格子
+    glm::vec2 min = glm::floor((position - this->Origin) / this->CellSize);
+    glm::vec2 max = glm::ceil((position + size - this->Origin) / this->CellSize) - 1.0f;
+    GLfloat maxCol = static_cast<GLfloat>(this->Columns - 1), maxRow = static_cast<GLfloat>(this->Rows - 1);
+    col0 = static_cast<GLuint>(glm::clamp(min.x, 0.0f, maxCol));
+    row0 = static_cast<GLuint>(glm::clamp(min.y, 0.0f, maxRow));
+    col1 = static_cast<GLuint>(glm::clamp(glm::max(max.x, min.x), 0.0f, maxCol));
+    row1 = static_cast<GLuint>(glm::clamp(glm::max(max.y, min.y), 0.0f, maxRow));
+}
+
+void OccupancyGrid::Increment(GLuint cell)
+{
+    if (this->Counts[cell]++ == 0) {
+        this->Words[cell / 64] |= 1ull << (cell % 64);
+        this->UpdateTree(cell / 64 / BLOCK_WORDS, -1);
+        this->Free--;
+    }
+}
+
+void OccupancyGrid::Decrement(GLuint cell)
+{
+    if (this->Counts[cell] == 0) {
+        return;
+    }
+    if (--this->Counts[cell] == 0) {
+        this->Words[cell / 64] &= ~(1ull << (cell % 64));
+        this->UpdateTree(cell / 64 / BLOCK_WORDS, 1);
+        this->Free++;
+    }
+}
+
+void OccupancyGrid::UpdateTree(GLuint block, GLint delta)
+{
+    for (GLuint i = block + 1; i <= this->TreeTop; i += i & (0 - i)) {
+        this->FreeTree[i] += delta;
+    }
+}
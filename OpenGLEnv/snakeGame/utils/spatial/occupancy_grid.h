@@ -0,0 +1,66 @@
+//
+//  occupancy_grid.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/25.
+//
+
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// 占用网格，记录地图上每个格子有没有被蛇、食物（以后还有墙）占用
+// 每个格子有一个占用计数，计数不为 0 的格子在位图里是 1，位图按 64 位一个字紧凑存放。
+// 每 8 个字（512 个格子）为一块，每块的空闲格子数放在树状数组里，第 k 个空闲格子可以在 O(log 块数) 内找到：
+// 先在树状数组里找到它所在的块，再用 popcount 找到块里的字和字里的位。
+// 物体移动时只更新新旧位置覆盖的格子，不需要每帧重建。
+class OccupancyGrid
+{
+public:
+    glm::vec2   Origin, Size;// 网格覆盖的区域
+    GLfloat     CellSize;// 格子大小
+    GLuint      Columns, Rows;// 格子列数和行数
+
+    OccupancyGrid();
+    OccupancyGrid(glm::vec2 origin, glm::vec2 size, GLfloat cellSize);
+
+    // 登记 / 移除一个物体，物体覆盖的格子占用计数加一 / 减一
+    void Add(glm::vec2 position, glm::vec2 size);
+    void Remove(glm::vec2 position, glm::vec2 size);
+    // 物体从 oldPosition 移动到 newPosition，覆盖的格子没变时什么都不做
+    void Move(glm::vec2 oldPosition, glm::vec2 newPosition, glm::vec2 size);
+
+    // 格子总数
+    GLuint CellCount() const { return this->Columns * this->Rows; }
+    // 空闲格子数
+    GLuint FreeCount() const { return this->Free; }
+    // 格子是否空闲
+    GLboolean IsFree(GLuint cell) const;
+    // 按行优先顺序的第 rank 个空闲格子（从 0 开始），rank 必须小于 FreeCount
+    GLuint SelectFree(GLuint rank) const;
+    // 用一个 32 位随机数均匀地选一个空闲格子，没有空闲格子返回 false
+    GLboolean RandomFreeCell(GLuint random, GLuint &cell) const;
+    // 格子左上角的位置
+    glm::vec2 CellPosition(GLuint cell) const;
+
+private:
+    std::vector<GLushort>   Counts;// 每个格子的占用计数
+    std::vector<uint64_t>   Words;// 占用位图，1 表示被占用，最后一个字多出来的位一直是 1
+    std::vector<GLuint>     FreeTree;// 每块空闲格子数的树状数组，下标从 1 开始
+    GLuint                  BlockCount;// 块数
+    GLuint                  TreeTop;// 不小于块数的最小的 2 的幂，也是树状数组的大小
+    GLuint                  Free;// 空闲格子数
+
+    // 物体覆盖的格子范围，超出地图的部分被夹到边上的格子
+    void Footprint(glm::vec2 position, glm::vec2 size, GLuint &col0, GLuint &row0, GLuint &col1, GLuint &row1) const;
+    void Increment(GLuint cell);
+    void Decrement(GLuint cell);
+    void UpdateTree(GLuint block, GLint delta);
+};
+
+#endif /* occupancy_grid_h */
@@ -0,0 +1,79 @@
+//
+//  spatial_grid.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/12.
+//
+
+#include <algorithm>
+
+#include "spatial_grid.h"
+#include "allocation_stats.h"
+
+SpatialGrid::SpatialGrid()
+    : Origin(0.0f), Size(0.0f), CellSize(1.0f), Columns(0), Rows(0)
+{
+
+}
+
+SpatialGrid::SpatialGrid(glm::vec2 origin, glm::vec2 size, GLfloat cellSize)
+    : Origin(origin), Size(size), CellSize(cellSize)
+{
+    MemoryTagScope tag(MEMORY_TAG_SPATIAL);
+    this->Columns = glm::max(1u, static_cast<GLuint>(glm::ceil(size.x / cellSize)));
+    this->Rows = glm::max(1u, static_cast<GLuint>(glm::ceil(size.y / cellSize)));
+    this->CellStart.assign(this->Columns * this->Rows + 1, 0);
+}
+
+void SpatialGrid::Build(const std::vector<glm::vec2> &positions)
+{
+    MemoryTagScope tag(MEMORY_TAG_SPATIAL);
+    GLuint count = static_cast<GLuint>(positions.size());
+    GLuint cellCount = this->Columns * this->Rows;
+
+    // 1. 统计每个格子的元素个数
+    std::fill(this->CellStart.begin(), this->CellStart.end(), 0);
+    ReserveReused(this->ItemCells, count);
+    this->ItemCells.resize(count);
+    for (GLuint i = 0; i < count; i++) {
+        GLuint cell = this->Cell(positions[i]);
+        this->ItemCells[i] = cell;
+        this->CellStart[cell + 1]++;
+    }
+
+    // 2. 前缀和得到每个格子的起始位置
+    for (GLuint cell = 0; cell < cellCount; cell++) {
+        this->CellStart[cell + 1] += this->CellStart[cell];
+    }
+
+    // 3. 把元素下标放到各自格子的区间里，同一个格子里的元素保持原来的顺序
+    ReserveReused(this->Items, count);
+    this->Items.resize(count);
+    for (GLuint i = 0; i < count; i++) {
+        GLuint cell = this->ItemCells[i];
+        this->Items[this->CellStart[cell]++] = i;
+    }
+
+    // 第 3 步把起始位置往后挪到了下一个格子的起始位置，往回挪一格
+    for (GLuint cell = cellCount; cell > 0; cell--) {
+        this->CellStart[cell] = this->CellStart[cell - 1];
+    }
+    this->CellStart[0] = 0;
+}
+
+GLuint SpatialGrid::Column(GLfloat x) const
+{
+    GLint col = static_cast<GLint>(glm::floor((x - this->Origin.x) / this->CellSize));
+    return static_cast<GLuint>(glm::clamp(col, 0, static_cast<GLint>(this->Columns) - 1));
+}
+
+GLuint SpatialGrid::Row(GLfloat y) const
+{
+    GLint row = static_cast<GLint>(glm::floor((y - this->Origin.y) / this->CellSize));
+    return static_cast<GLuint>(glm::clamp(row, 0, static_cast<GLint>(this->Rows) - 1));
+}
+
+GLuint SpatialGrid::Cell(glm::vec2 position) const
+{
+    return this->Row(position.y) * this->Columns + this->Column(position.x);
+}
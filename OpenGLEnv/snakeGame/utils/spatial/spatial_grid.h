@@ -0,0 +1,74 @@
+//
+//  spatial_grid.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/12.
+//
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// 均匀网格空间索引
+// 每次用计数排序整体重建：先统计每个格子的元素个数，再求前缀和，最后把元素下标放到各自格子的区间里。
+// 查询时只遍历和查询范围相交的格子，复杂度和元素总数无关。
+class SpatialGrid
+{
+public:
+    glm::vec2   Origin, Size;// 网格覆盖的区域
+    GLfloat     CellSize;// 格子大小
+    GLuint      Columns, Rows;// 格子列数和行数
+
+    SpatialGrid();
+    SpatialGrid(glm::vec2 origin, glm::vec2 size, GLfloat cellSize);
+
+    // 用所有元素的位置重建网格，元素下标就是 positions 的下标
+    void Build(const std::vector<glm::vec2> &positions);
+
+    // 遍历和 [min, max] 相交的格子里的所有元素下标
+    template <typename Func>
+    void Query(glm::vec2 min, glm::vec2 max, Func func) const
+    {
+        if (this->Columns == 0 || this->Rows == 0) {
+            return;
+        }
+        GLuint col0 = this->Column(min.x), col1 = this->Column(max.x);
+        GLuint row0 = this->Row(min.y), row1 = this->Row(max.y);
+        for (GLuint row = row0; row <= row1; row++) {
+            for (GLuint col = col0; col <= col1; col++) {
+                GLuint cell = row * this->Columns + col;
+                for (GLuint i = this->CellStart[cell]; i < this->CellStart[cell + 1]; i++) {
+                    func(this->Items[i]);
+                }
+            }
+        }
+    }
+
+    // 遍历一个格子里的所有元素下标，用于按格子划分并行任务
+    template <typename Func>
+    void ForEachInCell(GLuint cell, Func func) const
+    {
+        for (GLuint i = this->CellStart[cell]; i < this->CellStart[cell + 1]; i++) {
+            func(this->Items[i]);
+        }
+    }
+    
+    // 格子总数
+    GLuint CellCount() const { return this->Columns * this->Rows; }
+    
+    // 位置所在的格子，超出范围的会被夹到边上的格子
+    GLuint Column(GLfloat x) const;
+    GLuint Row(GLfloat y) const;
+    GLuint Cell(glm::vec2 position) const;
+
+private:
+    std::vector<GLuint> CellStart;// 每个格子在 Items 里的起始位置，长度是格子数 + 1
+    std::vector<GLuint> Items;// 按格子排序后的元素下标
+    std::vector<GLuint> ItemCells;// 每个元素所在的格子
+};
+
+#endif /* spatial_grid_h */
@@ -0,0 +1,71 @@
+//
+//  spsc_ring.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/22.
+//
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+
+#include <glad/glad.h>
+
+// 单生产者单消费者环形队列，无锁且不会等待
+// 生产者只写 Tail，消费者只写 Head，队列满了 TryPush 直接返回失败
+// Capacity 必须是 2 的幂
+template <typename T, GLuint Capacity>
+class SPSCRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    SPSCRing() : Head(0), Tail(0) { }
+
+    // 生产者：放入一个元素，队列满了返回 false
+    GLboolean TryPush(const T &item)
+    {
+        GLuint tail = this->Tail.load(std::memory_order_relaxed);
+        if (tail - this->Head.load(std::memory_order_acquire) == Capacity) {
+            return GL_FALSE;
+        }
+        this->Items[tail & (Capacity - 1)] = item;
+        this->Tail.store(tail + 1, std::memory_order_release);
+        return GL_TRUE;
+    }
+
+    // 消费者：查看队头元素但不取出，队列为空返回 false
+    GLboolean Peek(T &item) const
+    {
+        GLuint head = this->Head.load(std::memory_order_relaxed);
+        if (head == this->Tail.load(std::memory_order_acquire)) {
+            return GL_FALSE;
+        }
+        item = this->Items[head & (Capacity - 1)];
+        return GL_TRUE;
+    }
+
+    // 消费者：丢掉队头元素，必须在 Peek 成功之后调用
+    void Pop()
+    {
+        this->Head.store(this->Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // 消费者：取出队头元素，队列为空返回 false
+    GLboolean TryPop(T &item)
+    {
+        if (!this->Peek(item)) {
+            return GL_FALSE;
+        }
+        this->Pop();
+        return GL_TRUE;
+    }
+
+private:
+    T                   Items[Capacity];
+    std::atomic<GLuint> Head;// 下一个要读的位置，只有消费者修改
+    std::atomic<GLuint> Tail;// 下一个要写的位置，只有生产者修改
+};
+
+#endif /* spsc_ring_h */
@@ -0,0 +1,56 @@
+//
+//  triple_buffer.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/21.
+//
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+#include <glad/glad.h>
+
+// 无锁三缓冲，一个线程写，一个线程读
+// 写线程一直写后台缓冲，写完后和中间缓冲交换；读线程在有新数据时把前台缓冲和中间缓冲交换。
+// 两边都不会等待对方，读线程总是拿到最新发布的完整数据，写得比读得快时，中间的数据会被直接覆盖。
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : Middle(1), Back(0), Front(2) { }
+
+    // 写线程：拿到后台缓冲写数据
+    T &Write() { return this->Buffers[this->Back]; }
+    // 写线程：发布后台缓冲，之后 Write 返回另一个缓冲
+    void Publish()
+    {
+        GLuint previous = this->Middle.exchange(this->Back | DirtyBit, std::memory_order_acq_rel);
+        this->Back = previous & IndexMask;
+    }
+
+    // 读线程：如果有新发布的数据，切换到新数据，返回是否切换了
+    GLboolean Update()
+    {
+        if ((this->Middle.load(std::memory_order_relaxed) & DirtyBit) == 0) {
+            return GL_FALSE;
+        }
+        GLuint previous = this->Middle.exchange(this->Front, std::memory_order_acq_rel);
+        this->Front = previous & IndexMask;
+        return GL_TRUE;
+    }
+    // 读线程：读取前台缓冲，在下一次 Update 之前内容不会变
+    const T &Read() const { return this->Buffers[this->Front]; }
+
+private:
+    static const GLuint DirtyBit = 4;// 中间缓冲有没被读过的新数据
+    static const GLuint IndexMask = 3;
+
+    T                   Buffers[3];
+    std::atomic<GLuint> Middle;// 中间缓冲的下标和 DirtyBit，读写两边只通过它交换缓冲
+    GLuint              Back;// 只有写线程访问
+    GLuint              Front;// 只有读线程访问
+};
+
+#endif /* triple_buffer_h */
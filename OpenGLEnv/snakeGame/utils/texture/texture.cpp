@@ -8,11 +8,13 @@
 #include <iostream>
 
 #include "texture.h"
+#include "render_stats.h"
+#include "gpu_memory.h"
 
 Texture2D::Texture2D()
-    : Width(0), Height(0), Internal_Format(GL_RGB), Image_Format(GL_RGB), Wrap_S(GL_REPEAT), Wrap_T(GL_REPEAT), Filter_Min(GL_LINEAR), Filter_Max(GL_LINEAR), EmptyTexture(GL_FALSE)
+    : ID(0), Width(0), Height(0), Internal_Format(GL_RGB), Image_Format(GL_RGB), Wrap_S(GL_REPEAT), Wrap_T(GL_REPEAT), Filter_Min(GL_LINEAR), Filter_Max(GL_LINEAR), EmptyTexture(GL_FALSE)
 {
-    glGenTextures(1, &this->ID);
+    // 纹理对象在 Generate 时才创建，这样可以在没有 OpenGL 上下文的线程里创建 Texture2D
 }
 
 void Texture2D::Generate(GLuint width, GLuint height, unsigned char* data)
@@ -20,9 +22,16 @@ void Texture2D::Generate(GLuint width, GLuint height, unsigned char* data)
     this->Width = width;
     this->Height = height;
     // Create Texture
+    if (this->ID == 0)
+        glGenTextures(1, &this->ID);
     glBindTexture(GL_TEXTURE_2D, this->ID);
     glTexImage2D(GL_TEXTURE_2D, 0, this->Internal_Format, width, height, 0, this->Image_Format, GL_UNSIGNED_BYTE, data);
+    if (data) {
+        GLuint channels = this->Image_Format == GL_RGBA ? 4 : (this->Image_Format == GL_RGB ? 3 : 1);
+        RenderStats::CountTextureUpload(width * height * channels);
+    }
     glGenerateMipmap(GL_TEXTURE_2D);
+    GPUMemory::Track(GPU_TEXTURE, this->ID, GPUMemory::ImageBytes(this->Internal_Format, width, height, GL_TRUE));
     // Set Texture wrap and filter modes
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->Wrap_S);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->Wrap_T);
@@ -32,7 +41,36 @@ void Texture2D::Generate(GLuint width, GLuint height, unsigned char* data)
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void Texture2D::GenerateLevels(GLuint width, GLuint height, GLuint levels, const unsigned char* data)
+{
+    this->Width = width;
+    this->Height = height;
+    if (this->ID == 0)
+        glGenTextures(1, &this->ID);
+    glBindTexture(GL_TEXTURE_2D, this->ID);
+    GLuint channels = this->Image_Format == GL_RGBA ? 4 : (this->Image_Format == GL_RGB ? 3 : 1);
+    size_t offset = 0;
+    GLuint levelWidth = width, levelHeight = height;
+    for (GLuint level = 0; level < levels; level++) {
+        glTexImage2D(GL_TEXTURE_2D, level, this->Internal_Format, levelWidth, levelHeight, 0, this->Image_Format, GL_UNSIGNED_BYTE, data + offset);
+        offset += static_cast<size_t>(levelWidth) * levelHeight * channels;
+        levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+        levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+    }
+    RenderStats::CountTextureUpload(offset);
+    // 只有这些级，采样时不会去找不存在的级
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    GPUMemory::Track(GPU_TEXTURE, this->ID, GPUMemory::ImageBytes(this->Internal_Format, width, height, levels > 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->Wrap_S);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->Wrap_T);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->Filter_Min);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->Filter_Max);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 void Texture2D::Bind() const
 {
     glBindTexture(GL_TEXTURE_2D, this->ID);
+    RenderStats::CountStateChange();
 }
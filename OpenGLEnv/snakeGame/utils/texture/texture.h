@@ -16,6 +16,7 @@ class Texture2D
 {
 public:
     // Holds the ID of the texture object, used for all texture operations to reference to this particlar texture
+    // 在第一次 Generate 之前是 0
     GLuint ID;
     // Texture image dimensions
     GLuint Width, Height; // Width and height of loaded image in pixels
@@ -32,6 +33,9 @@ public:
     Texture2D();
     // Generates texture from image data
     void Generate(GLuint width, GLuint height, unsigned char* data);
+    // 上传整条 mipmap 链，各级从第 0 级开始紧挨着存放，格式是 Image_Format，不再调用 glGenerateMipmap
+    // 绑定了 GL_PIXEL_UNPACK_BUFFER 时 data 是缓冲区里的偏移
+    void GenerateLevels(GLuint width, GLuint height, GLuint levels, const unsigned char* data);
     // Binds the texture as the current active GL_TEXTURE_2D texture object
     void Bind() const;
 };
@@ -0,0 +1,179 @@
+//
+//  texture_cache.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char       TEXTURE_CACHE_MAGIC[4] = { 'S', 'N', 'K', 'T' };
+static const uint32_t   TEXTURE_CACHE_VERSION = 1;
+static_assert(sizeof(TextureCacheHeader) == 32, "texture cache header layout changed");
+
+std::string TextureCache::Directory = "texture_cache";
+GLboolean TextureCache::Enabled = GL_TRUE;
+
+TextureCacheFile::TextureCacheFile() : Header(nullptr), Pixels(nullptr), Mapping(nullptr), MappingSize(0)
+{
+
+}
+
+TextureCacheFile::~TextureCacheFile()
+{
+    this->Close();
+}
+
+GLboolean TextureCacheFile::Open(const std::string &path, uint64_t sourceHash, uint32_t flags)
+{
+    this->Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return GL_FALSE;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(TextureCacheHeader)) {
+        close(fd);
+        return GL_FALSE;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后文件描述符就不需要了
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return GL_FALSE;
+    }
+    this->Mapping = mapping;
+    this->MappingSize = size;
+
+    const TextureCacheHeader *header = static_cast<const TextureCacheHeader *>(mapping);
+    if (memcmp(header->Magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC)) != 0
+        || header->Version != TEXTURE_CACHE_VERSION
+        || header->SourceHash != sourceHash
+        || header->Flags != flags
+        || header->Levels != TextureCache::LevelCount(header->Width, header->Height)
+        || size != sizeof(TextureCacheHeader) + TextureCache::ChainBytes(header->Width, header->Height, header->Levels)) {
+        this->Close();
+        return GL_FALSE;
+    }
+    this->Header = header;
+    this->Pixels = static_cast<const unsigned char *>(mapping) + sizeof(TextureCacheHeader);
+    return GL_TRUE;
+}
+
+void TextureCacheFile::Close()
+{
+    if (this->Mapping) {
+        munmap(this->Mapping, this->MappingSize);
+    }
+    this->Mapping = nullptr;
+    this->MappingSize = 0;
+    this->Header = nullptr;
+    this->Pixels = nullptr;
+}
+
+std::string TextureCache::PathFor(const std::string &file)
+{
+    // 只用文件名，资源都在同一个目录里
+    size_t slash = file.find_last_of('/');
+    std::string name = slash == std::string::npos ? file : file.substr(slash + 1);
+    return Directory + "/" + name + ".tex";
+}
+
+uint64_t TextureCache::Hash(const void *data, size_t size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+GLuint TextureCache::LevelCount(GLuint width, GLuint height)
+{
+    GLuint levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels++;
+    }
+    return levels;
+}
+
+size_t TextureCache::ChainBytes(GLuint width, GLuint height, GLuint levels)
+{
+    size_t bytes = 0;
+    for (GLuint level = 0; level < levels; level++) {
+        bytes += static_cast<size_t>(width) * height * 4;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return bytes;
+}
+
+void TextureCache::BuildMipChain(unsigned char *chain, GLuint width, GLuint height, GLuint levels)
+{
+    unsigned char *source = chain;
+    for (GLuint level = 1; level < levels; level++) {
+        unsigned char *target = source + static_cast<size_t>(width) * height * 4;
+        GLuint targetWidth = std::max(width / 2, 1u);
+        GLuint targetHeight = std::max(height / 2, 1u);
+        for (GLuint y = 0; y < targetHeight; y++) {
+            // 奇数边长时最后一行（列）和自己平均
+            GLuint y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (GLuint x = 0; x < targetWidth; x++) {
+                GLuint x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                for (GLuint c = 0; c < 4; c++) {
+                    GLuint sum = source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c]
+                               + source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c];
+                    target[(y * targetWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        source = target;
+        width = targetWidth;
+        height = targetHeight;
+    }
+}
+
+GLboolean TextureCache::Write(const std::string &path, const TextureCacheHeader &header, const unsigned char *chain)
+{
+    // 目录已经存在时 mkdir 失败，不影响后面的写入
+    mkdir(Directory.c_str(), 0755);
+    std::string temporary = path + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return GL_FALSE;
+    }
+    size_t bytes = ChainBytes(header.Width, header.Height, header.Levels);
+    GLboolean written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(chain, 1, bytes, file) == bytes;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
+
+TextureCacheHeader TextureCache::MakeHeader(uint64_t sourceHash, GLuint width, GLuint height, uint32_t flags)
+{
+    TextureCacheHeader header;
+    memcpy(header.Magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC));
+    header.Version = TEXTURE_CACHE_VERSION;
+    header.SourceHash = sourceHash;
+    header.Width = width;
+    header.Height = height;
+    header.Levels = LevelCount(width, height);
+    header.Flags = flags;
+    return header;
+}
@@ -0,0 +1,91 @@
+//
+//  texture_cache.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <glad/glad.h>
+
+/**
+ 解码好的纹理缓存文件，启动时映射到内存直接上传，不用再解压 PNG
+
+ 文件头（小端，32 字节）：
+    4 字节魔数 "SNKT"
+    uint32 版本
+    uint64 源 PNG 文件内容的哈希（FNV-1a 64），PNG 改了哈希对不上，回退到解码
+    uint32 宽、高
+    uint32 mipmap 级数
+    uint32 标志（TEXTURE_CACHE_FLIPPED：上下翻转过）
+ 然后是整条 mipmap 链，RGBA8，从第 0 级开始一级紧挨着一级，每一级宽高减半直到 1x1
+ */
+struct TextureCacheHeader {
+    char        Magic[4];
+    uint32_t    Version;
+    uint64_t    SourceHash;
+    uint32_t    Width, Height;
+    uint32_t    Levels;
+    uint32_t    Flags;
+};
+
+enum TextureCacheFlag {
+    TEXTURE_CACHE_FLIPPED = 1
+};
+
+// 只读映射的缓存文件，映射在析构时解除
+class TextureCacheFile
+{
+public:
+    const TextureCacheHeader    *Header;// 没有打开时是空
+    const unsigned char         *Pixels;// mipmap 链的起点
+
+    TextureCacheFile();
+    ~TextureCacheFile();
+
+    // 映射缓存文件，文件不存在、格式不对、大小不对或者哈希、标志对不上时返回 false
+    GLboolean Open(const std::string &path, uint64_t sourceHash, uint32_t flags);
+    void Close();
+
+private:
+    void        *Mapping;
+    size_t      MappingSize;
+
+    TextureCacheFile(const TextureCacheFile &);
+    TextureCacheFile &operator=(const TextureCacheFile &);
+};
+
+// 缓存文件的读写工具
+class TextureCache
+{
+public:
+    // 缓存目录，相对于工作目录，第一次写入时创建
+    static std::string Directory;
+    // 为 false 时不读也不写缓存，每次都解码 PNG
+    static GLboolean Enabled;
+
+    // 源文件对应的缓存文件路径
+    static std::string PathFor(const std::string &file);
+    // 源文件内容的哈希
+    static uint64_t Hash(const void *data, size_t size);
+    // 宽高对应的 mipmap 级数和整条链的字节数
+    static GLuint LevelCount(GLuint width, GLuint height);
+    static size_t ChainBytes(GLuint width, GLuint height, GLuint levels);
+    // 从第 0 级（RGBA8）用 2x2 平均生成后面的各级，chain 的前面已经放好了第 0 级
+    static void BuildMipChain(unsigned char *chain, GLuint width, GLuint height, GLuint levels);
+    // 写缓存文件，先写临时文件再改名，其他进程不会读到写了一半的文件
+    static GLboolean Write(const std::string &path, const TextureCacheHeader &header, const unsigned char *chain);
+    // 填好除了哈希、宽高以外的固定字段
+    static TextureCacheHeader MakeHeader(uint64_t sourceHash, GLuint width, GLuint height, uint32_t flags);
+
+private:
+    TextureCache() { }
+};
+
+#endif /* texture_cache_h */
@@ -0,0 +1,228 @@
+//
+//  archive.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "archive.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+static const char       ARCHIVE_MAGIC[4] = { 'S', 'N', 'K', 'P' };
+static const uint32_t   ARCHIVE_VERSION = 1;
+static_assert(sizeof(ArchiveHeader) == 32, "archive header layout changed");
+static_assert(sizeof(ArchiveEntry) == 32, "archive entry layout changed");
+
+Archive::Archive() : File(-1)
+{
+
+}
+
+Archive::~Archive()
+{
+    this->Close();
+}
+
+GLboolean Archive::Open(const std::string &path)
+{
+    this->Close();
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        return GL_FALSE;
+    }
+    this->File = file;
+
+    // 文件头和目录都读进内存，之后查找不用再访问文件
+    ArchiveHeader header;
+    if (this->ReadRaw(0, &header, sizeof(header)) != sizeof(header)
+        || memcmp(header.Magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0
+        || header.Version != ARCHIVE_VERSION) {
+        std::cout << "ERROR::ARCHIVE: Not an asset archive: " << path << std::endl;
+        this->Close();
+        return GL_FALSE;
+    }
+    this->Entries.resize(header.EntryCount);
+    this->Names.resize(header.NamesSize);
+    size_t tocBytes = sizeof(ArchiveEntry) * header.EntryCount;
+    if (this->ReadRaw(header.TocOffset, this->Entries.data(), tocBytes) != tocBytes
+        || this->ReadRaw(header.TocOffset + tocBytes, &this->Names[0], header.NamesSize) != header.NamesSize) {
+        std::cout << "ERROR::ARCHIVE: Truncated asset archive: " << path << std::endl;
+        this->Close();
+        return GL_FALSE;
+    }
+    for (const ArchiveEntry &entry : this->Entries) {
+        if (static_cast<uint64_t>(entry.NameOffset) + entry.NameLength > header.NamesSize
+            || entry.Offset + entry.StoredSize > header.TocOffset) {
+            std::cout << "ERROR::ARCHIVE: Corrupted asset archive: " << path << std::endl;
+            this->Close();
+            return GL_FALSE;
+        }
+    }
+    return GL_TRUE;
+}
+
+void Archive::Close()
+{
+    if (this->File >= 0) {
+        close(this->File);
+    }
+    this->File = -1;
+    this->Entries.clear();
+    this->Names.clear();
+}
+
+const ArchiveEntry *Archive::Find(const std::string &name) const
+{
+    std::string key = EntryKey(name);
+    // 目录按名字排序
+    size_t low = 0, high = this->Entries.size();
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        const ArchiveEntry &entry = this->Entries[middle];
+        int order = this->Names.compare(entry.NameOffset, entry.NameLength, key);
+        if (order == 0) {
+            return &entry;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return nullptr;
+}
+
+size_t Archive::ReadRaw(uint64_t offset, void *buffer, size_t size) const
+{
+    // pread 不改变文件位置，多个线程共用一个文件描述符
+    size_t read = 0;
+    while (read < size) {
+        ssize_t result = pread(this->File, static_cast<char *>(buffer) + read, size - read, static_cast<off_t>(offset + read));
+        if (result <= 0) {
+            break;
+        }
+        read += static_cast<size_t>(result);
+    }
+    return read;
+}
+
+std::string Archive::EntryName(GLuint index) const
+{
+    const ArchiveEntry &entry = this->Entries[index];
+    return this->Names.substr(entry.NameOffset, entry.NameLength);
+}
+
+std::string Archive::EntryKey(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    std::string key = slash == std::string::npos ? path : path.substr(slash + 1);
+    // macOS 的文件系统不区分大小写，代码里有 "OCRAEXT.TTF" 这样的写法
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return key;
+}
+
+// 读出整个文件
+static GLboolean ReadWholeFile(const std::string &path, std::vector<unsigned char> &bytes)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return GL_FALSE;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    bytes.resize(size > 0 ? size : 0);
+    GLboolean read = size >= 0 && fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+    return read;
+}
+
+GLboolean Archive::Write(const std::string &path, const std::vector<std::string> &files)
+{
+    // 1. 按名字排序，名字重复说明两个资源会互相覆盖
+    std::vector<std::pair<std::string, std::string>> sorted;
+    for (const std::string &file : files) {
+        sorted.push_back(std::make_pair(EntryKey(file), file));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 1; i < sorted.size(); i++) {
+        if (sorted[i].first == sorted[i - 1].first) {
+            std::cout << "ERROR::ARCHIVE: Duplicate entry " << sorted[i].first << ": " << sorted[i - 1].second << ", " << sorted[i].second << std::endl;
+            return GL_FALSE;
+        }
+    }
+
+    std::string temporary = path + ".tmp";
+    FILE *out = fopen(temporary.c_str(), "wb");
+    if (!out) {
+        std::cout << "ERROR::ARCHIVE: Failed to create " << temporary << std::endl;
+        return GL_FALSE;
+    }
+
+    // 2. 文件头先占位，数据写完后再回来填目录偏移
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.Version = ARCHIVE_VERSION;
+    header.EntryCount = static_cast<uint32_t>(sorted.size());
+    GLboolean written = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    std::vector<ArchiveEntry> entries;
+    std::string names;
+    uint64_t offset = sizeof(header);
+    std::vector<unsigned char> source, compressed;
+    for (size_t i = 0; i < sorted.size() && written; i++) {
+        if (!ReadWholeFile(sorted[i].second, source)) {
+            std::cout << "ERROR::ARCHIVE: Failed to read " << sorted[i].second << std::endl;
+            written = GL_FALSE;
+            break;
+        }
+        ArchiveEntry entry;
+        entry.NameOffset = static_cast<uint32_t>(names.size());
+        entry.NameLength = static_cast<uint32_t>(sorted[i].first.size());
+        entry.Offset = offset;
+        entry.Size = static_cast<uint32_t>(source.size());
+        entry.CRC = static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0), source.data(), static_cast<uInt>(source.size())));
+        names += sorted[i].first;
+
+        // 3. 压缩后小于原来的 95% 才值得解压的开销
+        uLongf compressedSize = compressBound(static_cast<uLong>(source.size()));
+        compressed.resize(compressedSize);
+        const unsigned char *data = source.data();
+        entry.Method = ARCHIVE_STORED;
+        entry.StoredSize = entry.Size;
+        if (compress2(compressed.data(), &compressedSize, source.data(), static_cast<uLong>(source.size()), Z_BEST_COMPRESSION) == Z_OK
+            && compressedSize < source.size() - source.size() / 20) {
+            entry.Method = ARCHIVE_DEFLATE;
+            entry.StoredSize = static_cast<uint32_t>(compressedSize);
+            data = compressed.data();
+        }
+        written = fwrite(data, 1, entry.StoredSize, out) == entry.StoredSize;
+        offset += entry.StoredSize;
+        entries.push_back(entry);
+    }
+
+    // 4. 目录和名字区放在最后
+    header.TocOffset = offset;
+    header.NamesSize = static_cast<uint32_t>(names.size());
+    written = written
+        && fwrite(entries.data(), sizeof(ArchiveEntry), entries.size(), out) == entries.size()
+        && fwrite(names.data(), 1, names.size(), out) == names.size()
+        && fseek(out, 0, SEEK_SET) == 0
+        && fwrite(&header, sizeof(header), 1, out) == 1;
+    written = fclose(out) == 0 && written;
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return GL_FALSE;
+    }
+    return GL_TRUE;
+}
@@ -0,0 +1,88 @@
+//
+//  archive.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+/**
+ 资源包文件，所有资源打成一个文件，启动时只打开一次
+
+ 文件布局（小端）：
+    32 字节文件头：4 字节魔数 "SNKP"、uint32 版本、uint32 条目数、uint32 名字区字节数、uint64 目录偏移、8 字节保留
+    各条目的数据，一个接一个
+    目录：每个条目 32 字节（ArchiveEntry），按名字排序，查找时二分
+    名字区：所有条目的名字紧挨着存放，不带结尾的 0
+
+ 名字是资源的文件名（不带目录，小写），和 Xcode 把资源平铺复制到 bundle 里的方式一致。
+ 每个条目单独选择存储方式：着色器、字体这些文本类的数据用 zlib 压缩，PNG、MP3 这些本身已经压缩过的、
+ 压缩后变小不到 1/20 的直接存储。
+ */
+struct ArchiveHeader {
+    char        Magic[4];
+    uint32_t    Version;
+    uint32_t    EntryCount;
+    uint32_t    NamesSize;
+    uint64_t    TocOffset;
+    uint64_t    Reserved;
+};
+
+enum ArchiveMethod {
+    ARCHIVE_STORED = 0,// 原样存储
+    ARCHIVE_DEFLATE = 1// zlib 压缩
+};
+
+struct ArchiveEntry {
+    uint32_t    NameOffset;// 在名字区里的偏移
+    uint32_t    NameLength;
+    uint64_t    Offset;// 数据在文件里的偏移
+    uint32_t    StoredSize;// 文件里的字节数
+    uint32_t    Size;// 解压后的字节数
+    uint32_t    Method;
+    uint32_t    CRC;// 解压后数据的 CRC32，读完时校验
+};
+
+// 只读打开的资源包，目录读进内存，数据用 pread 按需读取，多个线程可以同时读
+class Archive
+{
+public:
+    Archive();
+    ~Archive();
+
+    // 打开资源包并读入目录，文件不存在或者格式不对时返回 false
+    GLboolean Open(const std::string &path);
+    void Close();
+    GLboolean IsOpen() const { return this->File >= 0; }
+    // 按名字查找条目，名字不区分大小写，也可以带目录；找不到返回空
+    const ArchiveEntry *Find(const std::string &name) const;
+    // 从 offset 开始读 size 字节的原始数据，返回读到的字节数
+    size_t ReadRaw(uint64_t offset, void *buffer, size_t size) const;
+    GLuint EntryCount() const { return static_cast<GLuint>(this->Entries.size()); }
+    std::string EntryName(GLuint index) const;
+    const ArchiveEntry &Entry(GLuint index) const { return this->Entries[index]; }
+
+    // 条目名字：去掉目录，转成小写
+    static std::string EntryKey(const std::string &path);
+    // 把 files 打成资源包，名字重复或者文件读不出来时返回 false
+    static GLboolean Write(const std::string &path, const std::vector<std::string> &files);
+
+private:
+    int                         File;
+    std::vector<ArchiveEntry>   Entries;
+    std::string                 Names;
+
+    Archive(const Archive &);
+    Archive &operator=(const Archive &);
+};
+
+#endif /* archive_h */
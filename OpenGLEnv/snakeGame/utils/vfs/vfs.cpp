@@ -0,0 +1,157 @@
+//
+//  vfs.cpp
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#include "vfs.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+Archive VFS::Pak;
+
+VFSFile::VFSFile() : Loose(nullptr), Entry(nullptr), FileSize(0), Produced(0), Consumed(0), CRC(0), Error(GL_FALSE), Inflating(GL_FALSE)
+{
+    memset(&this->Stream, 0, sizeof(this->Stream));
+}
+
+VFSFile::~VFSFile()
+{
+    this->Close();
+}
+
+GLboolean VFSFile::Open(const std::string &path)
+{
+    this->Close();
+    if (VFS::Pak.IsOpen()) {
+        this->Entry = VFS::Pak.Find(path);
+    }
+    if (this->Entry) {
+        this->FileSize = this->Entry->Size;
+        this->CRC = static_cast<uint32_t>(crc32(0L, Z_NULL, 0));
+        if (this->Entry->Method == ARCHIVE_DEFLATE) {
+            if (inflateInit(&this->Stream) != Z_OK) {
+                this->Entry = nullptr;
+                return GL_FALSE;
+            }
+            this->Inflating = GL_TRUE;
+        }
+        return GL_TRUE;
+    }
+
+    this->Loose = fopen(path.c_str(), "rb");
+    if (!this->Loose) {
+        return GL_FALSE;
+    }
+    fseek(this->Loose, 0, SEEK_END);
+    long size = ftell(this->Loose);
+    fseek(this->Loose, 0, SEEK_SET);
+    this->FileSize = size > 0 ? static_cast<size_t>(size) : 0;
+    return GL_TRUE;
+}
+
+void VFSFile::Close()
+{
+    if (this->Loose) {
+        fclose(this->Loose);
+    }
+    if (this->Inflating) {
+        inflateEnd(&this->Stream);
+    }
+    memset(&this->Stream, 0, sizeof(this->Stream));
+    this->Loose = nullptr;
+    this->Entry = nullptr;
+    this->FileSize = 0;
+    this->Produced = 0;
+    this->Consumed = 0;
+    this->Error = GL_FALSE;
+    this->Inflating = GL_FALSE;
+}
+
+size_t VFSFile::Read(void *buffer, size_t size)
+{
+    if (this->Loose) {
+        return fread(buffer, 1, size, this->Loose);
+    }
+    if (!this->Entry || this->Error) {
+        return 0;
+    }
+    size = std::min(size, this->FileSize - this->Produced);
+    size_t produced = 0;
+    if (this->Entry->Method == ARCHIVE_STORED) {
+        produced = VFS::Pak.ReadRaw(this->Entry->Offset + this->Consumed, buffer, size);
+        this->Consumed += produced;
+        this->Error = produced != size;
+    } else {
+        // 输入缓冲区读空了就从资源包里再读一段，直到填满调用者的缓冲区或者压缩流结束
+        this->Stream.next_out = static_cast<Bytef *>(buffer);
+        this->Stream.avail_out = static_cast<uInt>(size);
+        while (this->Stream.avail_out > 0) {
+            if (this->Stream.avail_in == 0) {
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(sizeof(this->Input), this->Entry->StoredSize - this->Consumed));
+                if (chunk == 0 || VFS::Pak.ReadRaw(this->Entry->Offset + this->Consumed, this->Input, chunk) != chunk) {
+                    this->Error = GL_TRUE;
+                    break;
+                }
+                this->Consumed += chunk;
+                this->Stream.next_in = this->Input;
+                this->Stream.avail_in = static_cast<uInt>(chunk);
+            }
+            int result = inflate(&this->Stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                break;
+            }
+            if (result != Z_OK) {
+                this->Error = GL_TRUE;
+                break;
+            }
+        }
+        produced = size - this->Stream.avail_out;
+        this->Error = this->Error || produced != size;
+    }
+    this->CRC = static_cast<uint32_t>(crc32(this->CRC, static_cast<const Bytef *>(buffer), static_cast<uInt>(produced)));
+    this->Produced += produced;
+    if (this->Produced == this->FileSize && this->CRC != this->Entry->CRC) {
+        this->Error = GL_TRUE;
+    }
+    if (this->Error) {
+        std::cout << "ERROR::VFS: Corrupted archive entry " << VFS::Pak.EntryName(static_cast<GLuint>(this->Entry - &VFS::Pak.Entry(0))) << std::endl;
+        return 0;
+    }
+    return produced;
+}
+
+GLboolean VFS::Mount(const std::string &archivePath)
+{
+    return Pak.Open(archivePath);
+}
+
+void VFS::Unmount()
+{
+    Pak.Close();
+}
+
+GLboolean VFS::ReadFile(const std::string &path, std::vector<unsigned char> &bytes)
+{
+    VFSFile file;
+    if (!file.Open(path)) {
+        bytes.clear();
+        return GL_FALSE;
+    }
+    bytes.resize(file.Size());
+    return file.Read(bytes.data(), bytes.size()) == bytes.size() && !file.Failed();
+}
+
+GLboolean VFS::ReadText(const std::string &path, std::string &text)
+{
+    VFSFile file;
+    if (!file.Open(path)) {
+        text.clear();
+        return GL_FALSE;
+    }
+    text.resize(file.Size());
+    return file.Read(&text[0], text.size()) == text.size() && !file.Failed();
+}
@@ -0,0 +1,76 @@
+//
+//  vfs.h
+//  OpenGLEnv
+//
+//  Created by karos li on 2021/7/31.
+//
+
+#ifndef VFS_H
+#define VFS_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <zlib.h>
+
+#include "archive.h"
+
+// 虚拟文件系统里打开的一个文件，从资源包里读时边读边解压，不用先把整个条目读进内存
+// 一个对象只能在一个线程里用，不同的对象可以在不同的线程里同时读
+class VFSFile
+{
+public:
+    VFSFile();
+    ~VFSFile();
+
+    // 先在挂载的资源包里找，找不到再打开散放的文件
+    GLboolean Open(const std::string &path);
+    void Close();
+    // 解压后的总字节数
+    size_t Size() const { return this->FileSize; }
+    // 读最多 size 字节，返回读到的字节数，读到结尾或者出错时返回 0
+    size_t Read(void *buffer, size_t size);
+    // 数据损坏（解压失败或者 CRC 对不上）
+    GLboolean Failed() const { return this->Error; }
+
+private:
+    FILE                *Loose;
+    const ArchiveEntry  *Entry;
+    size_t              FileSize;
+    size_t              Produced;// 已经交给调用者的字节数
+    uint64_t            Consumed;// 已经从资源包里读出的原始字节数
+    uint32_t            CRC;
+    GLboolean           Error;
+    GLboolean           Inflating;
+    z_stream            Stream;
+    unsigned char       Input[16 * 1024];
+
+    VFSFile(const VFSFile &);
+    VFSFile &operator=(const VFSFile &);
+};
+
+// 资源文件的读取入口，着色器、纹理、字体都通过它读
+// 挂载了资源包时资源都从资源包里读，整个游戏只打开一次文件；没有的（比如开发时新加的）再去找散放的文件
+// 挂载和卸载要在没有加载任务的时候做，读取可以在任何线程
+class VFS
+{
+public:
+    // 挂载资源包，返回是否成功，失败时继续读散放的文件
+    static GLboolean Mount(const std::string &archivePath);
+    static void Unmount();
+    static const Archive &Mounted() { return Pak; }
+    // 读出整个文件
+    static GLboolean ReadFile(const std::string &path, std::vector<unsigned char> &bytes);
+    static GLboolean ReadText(const std::string &path, std::string &text);
+
+private:
+    static Archive Pak;
+
+    VFS() { }
+
+    friend class VFSFile;
+};
+
+#endif /* vfs_h */